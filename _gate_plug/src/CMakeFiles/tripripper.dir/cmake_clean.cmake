@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/tripripper.dir/main.cpp.o"
+  "CMakeFiles/tripripper.dir/main.cpp.o.d"
+  "tripripper"
+  "tripripper.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/tripripper.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
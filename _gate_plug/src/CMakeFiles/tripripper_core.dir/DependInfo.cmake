@@ -0,0 +1,51 @@
+
+# Consider dependencies only in project.
+set(CMAKE_DEPENDS_IN_PROJECT_ONLY OFF)
+
+# The set of languages for which implicit dependencies are needed:
+set(CMAKE_DEPENDS_LANGUAGES
+  )
+
+# The set of dependency files which are needed:
+set(CMAKE_DEPENDS_DEPENDENCY_FILES
+  "/root/repo/src/allocationTracker.cpp" "src/CMakeFiles/tripripper_core.dir/allocationTracker.cpp.o" "gcc" "src/CMakeFiles/tripripper_core.dir/allocationTracker.cpp.o.d"
+  "/root/repo/src/atomicPoolCounter.cpp" "src/CMakeFiles/tripripper_core.dir/atomicPoolCounter.cpp.o" "gcc" "src/CMakeFiles/tripripper_core.dir/atomicPoolCounter.cpp.o.d"
+  "/root/repo/src/autotuner.cpp" "src/CMakeFiles/tripripper_core.dir/autotuner.cpp.o" "gcc" "src/CMakeFiles/tripripper_core.dir/autotuner.cpp.o.d"
+  "/root/repo/src/checkpoint.cpp" "src/CMakeFiles/tripripper_core.dir/checkpoint.cpp.o" "gcc" "src/CMakeFiles/tripripper_core.dir/checkpoint.cpp.o.d"
+  "/root/repo/src/engineSelector.cpp" "src/CMakeFiles/tripripper_core.dir/engineSelector.cpp.o" "gcc" "src/CMakeFiles/tripripper_core.dir/engineSelector.cpp.o.d"
+  "/root/repo/src/keyMask.cpp" "src/CMakeFiles/tripripper_core.dir/keyMask.cpp.o" "gcc" "src/CMakeFiles/tripripper_core.dir/keyMask.cpp.o.d"
+  "/root/repo/src/keyspace.cpp" "src/CMakeFiles/tripripper_core.dir/keyspace.cpp.o" "gcc" "src/CMakeFiles/tripripper_core.dir/keyspace.cpp.o.d"
+  "/root/repo/src/keyspaceDispatcher.cpp" "src/CMakeFiles/tripripper_core.dir/keyspaceDispatcher.cpp.o" "gcc" "src/CMakeFiles/tripripper_core.dir/keyspaceDispatcher.cpp.o.d"
+  "/root/repo/src/keyspaceFactory.cpp" "src/CMakeFiles/tripripper_core.dir/keyspaceFactory.cpp.o" "gcc" "src/CMakeFiles/tripripper_core.dir/keyspaceFactory.cpp.o.d"
+  "/root/repo/src/linearKeyspace.cpp" "src/CMakeFiles/tripripper_core.dir/linearKeyspace.cpp.o" "gcc" "src/CMakeFiles/tripripper_core.dir/linearKeyspace.cpp.o.d"
+  "/root/repo/src/logger.cpp" "src/CMakeFiles/tripripper_core.dir/logger.cpp.o" "gcc" "src/CMakeFiles/tripripper_core.dir/logger.cpp.o.d"
+  "/root/repo/src/manglingKeyspace.cpp" "src/CMakeFiles/tripripper_core.dir/manglingKeyspace.cpp.o" "gcc" "src/CMakeFiles/tripripper_core.dir/manglingKeyspace.cpp.o.d"
+  "/root/repo/src/manglingRules.cpp" "src/CMakeFiles/tripripper_core.dir/manglingRules.cpp.o" "gcc" "src/CMakeFiles/tripripper_core.dir/manglingRules.cpp.o.d"
+  "/root/repo/src/maskKeyspace.cpp" "src/CMakeFiles/tripripper_core.dir/maskKeyspace.cpp.o" "gcc" "src/CMakeFiles/tripripper_core.dir/maskKeyspace.cpp.o.d"
+  "/root/repo/src/matchLog.cpp" "src/CMakeFiles/tripripper_core.dir/matchLog.cpp.o" "gcc" "src/CMakeFiles/tripripper_core.dir/matchLog.cpp.o.d"
+  "/root/repo/src/matchingAlgorithm.cpp" "src/CMakeFiles/tripripper_core.dir/matchingAlgorithm.cpp.o" "gcc" "src/CMakeFiles/tripripper_core.dir/matchingAlgorithm.cpp.o.d"
+  "/root/repo/src/nodeDispatcher.cpp" "src/CMakeFiles/tripripper_core.dir/nodeDispatcher.cpp.o" "gcc" "src/CMakeFiles/tripripper_core.dir/nodeDispatcher.cpp.o.d"
+  "/root/repo/src/openSSLTripcode.cpp" "src/CMakeFiles/tripripper_core.dir/openSSLTripcode.cpp.o" "gcc" "src/CMakeFiles/tripripper_core.dir/openSSLTripcode.cpp.o.d"
+  "/root/repo/src/perfCounters.cpp" "src/CMakeFiles/tripripper_core.dir/perfCounters.cpp.o" "gcc" "src/CMakeFiles/tripripper_core.dir/perfCounters.cpp.o.d"
+  "/root/repo/src/poolRequester.cpp" "src/CMakeFiles/tripripper_core.dir/poolRequester.cpp.o" "gcc" "src/CMakeFiles/tripripper_core.dir/poolRequester.cpp.o.d"
+  "/root/repo/src/poolTracker.cpp" "src/CMakeFiles/tripripper_core.dir/poolTracker.cpp.o" "gcc" "src/CMakeFiles/tripripper_core.dir/poolTracker.cpp.o.d"
+  "/root/repo/src/rangeSet.cpp" "src/CMakeFiles/tripripper_core.dir/rangeSet.cpp.o" "gcc" "src/CMakeFiles/tripripper_core.dir/rangeSet.cpp.o.d"
+  "/root/repo/src/shardKeyspace.cpp" "src/CMakeFiles/tripripper_core.dir/shardKeyspace.cpp.o" "gcc" "src/CMakeFiles/tripripper_core.dir/shardKeyspace.cpp.o.d"
+  "/root/repo/src/strategyFactory.cpp" "src/CMakeFiles/tripripper_core.dir/strategyFactory.cpp.o" "gcc" "src/CMakeFiles/tripripper_core.dir/strategyFactory.cpp.o.d"
+  "/root/repo/src/strcmpMatching.cpp" "src/CMakeFiles/tripripper_core.dir/strcmpMatching.cpp.o" "gcc" "src/CMakeFiles/tripripper_core.dir/strcmpMatching.cpp.o.d"
+  "/root/repo/src/telemetry.cpp" "src/CMakeFiles/tripripper_core.dir/telemetry.cpp.o" "gcc" "src/CMakeFiles/tripripper_core.dir/telemetry.cpp.o.d"
+  "/root/repo/src/terminationBarrier.cpp" "src/CMakeFiles/tripripper_core.dir/terminationBarrier.cpp.o" "gcc" "src/CMakeFiles/tripripper_core.dir/terminationBarrier.cpp.o.d"
+  "/root/repo/src/tracer.cpp" "src/CMakeFiles/tripripper_core.dir/tracer.cpp.o" "gcc" "src/CMakeFiles/tripripper_core.dir/tracer.cpp.o.d"
+  "/root/repo/src/tripcodeAlgorithm.cpp" "src/CMakeFiles/tripripper_core.dir/tripcodeAlgorithm.cpp.o" "gcc" "src/CMakeFiles/tripripper_core.dir/tripcodeAlgorithm.cpp.o.d"
+  "/root/repo/src/tripcodeContainer.cpp" "src/CMakeFiles/tripripper_core.dir/tripcodeContainer.cpp.o" "gcc" "src/CMakeFiles/tripripper_core.dir/tripcodeContainer.cpp.o.d"
+  "/root/repo/src/tripcodeCrawler.cpp" "src/CMakeFiles/tripripper_core.dir/tripcodeCrawler.cpp.o" "gcc" "src/CMakeFiles/tripripper_core.dir/tripcodeCrawler.cpp.o.d"
+  "/root/repo/src/tripcodeSearchResult.cpp" "src/CMakeFiles/tripripper_core.dir/tripcodeSearchResult.cpp.o" "gcc" "src/CMakeFiles/tripripper_core.dir/tripcodeSearchResult.cpp.o.d"
+  "/root/repo/src/wordlistKeyspace.cpp" "src/CMakeFiles/tripripper_core.dir/wordlistKeyspace.cpp.o" "gcc" "src/CMakeFiles/tripripper_core.dir/wordlistKeyspace.cpp.o.d"
+  )
+
+# Targets to which this target links.
+set(CMAKE_TARGET_LINKED_INFO_FILES
+  )
+
+# Fortran module output directory.
+set(CMAKE_Fortran_TARGET_MODULE_DIR "")
@@ -0,0 +1,75 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/tripripper_core.dir/allocationTracker.cpp.o"
+  "CMakeFiles/tripripper_core.dir/allocationTracker.cpp.o.d"
+  "CMakeFiles/tripripper_core.dir/atomicPoolCounter.cpp.o"
+  "CMakeFiles/tripripper_core.dir/atomicPoolCounter.cpp.o.d"
+  "CMakeFiles/tripripper_core.dir/autotuner.cpp.o"
+  "CMakeFiles/tripripper_core.dir/autotuner.cpp.o.d"
+  "CMakeFiles/tripripper_core.dir/checkpoint.cpp.o"
+  "CMakeFiles/tripripper_core.dir/checkpoint.cpp.o.d"
+  "CMakeFiles/tripripper_core.dir/engineSelector.cpp.o"
+  "CMakeFiles/tripripper_core.dir/engineSelector.cpp.o.d"
+  "CMakeFiles/tripripper_core.dir/keyMask.cpp.o"
+  "CMakeFiles/tripripper_core.dir/keyMask.cpp.o.d"
+  "CMakeFiles/tripripper_core.dir/keyspace.cpp.o"
+  "CMakeFiles/tripripper_core.dir/keyspace.cpp.o.d"
+  "CMakeFiles/tripripper_core.dir/keyspaceDispatcher.cpp.o"
+  "CMakeFiles/tripripper_core.dir/keyspaceDispatcher.cpp.o.d"
+  "CMakeFiles/tripripper_core.dir/keyspaceFactory.cpp.o"
+  "CMakeFiles/tripripper_core.dir/keyspaceFactory.cpp.o.d"
+  "CMakeFiles/tripripper_core.dir/linearKeyspace.cpp.o"
+  "CMakeFiles/tripripper_core.dir/linearKeyspace.cpp.o.d"
+  "CMakeFiles/tripripper_core.dir/logger.cpp.o"
+  "CMakeFiles/tripripper_core.dir/logger.cpp.o.d"
+  "CMakeFiles/tripripper_core.dir/manglingKeyspace.cpp.o"
+  "CMakeFiles/tripripper_core.dir/manglingKeyspace.cpp.o.d"
+  "CMakeFiles/tripripper_core.dir/manglingRules.cpp.o"
+  "CMakeFiles/tripripper_core.dir/manglingRules.cpp.o.d"
+  "CMakeFiles/tripripper_core.dir/maskKeyspace.cpp.o"
+  "CMakeFiles/tripripper_core.dir/maskKeyspace.cpp.o.d"
+  "CMakeFiles/tripripper_core.dir/matchLog.cpp.o"
+  "CMakeFiles/tripripper_core.dir/matchLog.cpp.o.d"
+  "CMakeFiles/tripripper_core.dir/matchingAlgorithm.cpp.o"
+  "CMakeFiles/tripripper_core.dir/matchingAlgorithm.cpp.o.d"
+  "CMakeFiles/tripripper_core.dir/nodeDispatcher.cpp.o"
+  "CMakeFiles/tripripper_core.dir/nodeDispatcher.cpp.o.d"
+  "CMakeFiles/tripripper_core.dir/openSSLTripcode.cpp.o"
+  "CMakeFiles/tripripper_core.dir/openSSLTripcode.cpp.o.d"
+  "CMakeFiles/tripripper_core.dir/perfCounters.cpp.o"
+  "CMakeFiles/tripripper_core.dir/perfCounters.cpp.o.d"
+  "CMakeFiles/tripripper_core.dir/poolRequester.cpp.o"
+  "CMakeFiles/tripripper_core.dir/poolRequester.cpp.o.d"
+  "CMakeFiles/tripripper_core.dir/poolTracker.cpp.o"
+  "CMakeFiles/tripripper_core.dir/poolTracker.cpp.o.d"
+  "CMakeFiles/tripripper_core.dir/rangeSet.cpp.o"
+  "CMakeFiles/tripripper_core.dir/rangeSet.cpp.o.d"
+  "CMakeFiles/tripripper_core.dir/shardKeyspace.cpp.o"
+  "CMakeFiles/tripripper_core.dir/shardKeyspace.cpp.o.d"
+  "CMakeFiles/tripripper_core.dir/strategyFactory.cpp.o"
+  "CMakeFiles/tripripper_core.dir/strategyFactory.cpp.o.d"
+  "CMakeFiles/tripripper_core.dir/strcmpMatching.cpp.o"
+  "CMakeFiles/tripripper_core.dir/strcmpMatching.cpp.o.d"
+  "CMakeFiles/tripripper_core.dir/telemetry.cpp.o"
+  "CMakeFiles/tripripper_core.dir/telemetry.cpp.o.d"
+  "CMakeFiles/tripripper_core.dir/terminationBarrier.cpp.o"
+  "CMakeFiles/tripripper_core.dir/terminationBarrier.cpp.o.d"
+  "CMakeFiles/tripripper_core.dir/tracer.cpp.o"
+  "CMakeFiles/tripripper_core.dir/tracer.cpp.o.d"
+  "CMakeFiles/tripripper_core.dir/tripcodeAlgorithm.cpp.o"
+  "CMakeFiles/tripripper_core.dir/tripcodeAlgorithm.cpp.o.d"
+  "CMakeFiles/tripripper_core.dir/tripcodeContainer.cpp.o"
+  "CMakeFiles/tripripper_core.dir/tripcodeContainer.cpp.o.d"
+  "CMakeFiles/tripripper_core.dir/tripcodeCrawler.cpp.o"
+  "CMakeFiles/tripripper_core.dir/tripcodeCrawler.cpp.o.d"
+  "CMakeFiles/tripripper_core.dir/tripcodeSearchResult.cpp.o"
+  "CMakeFiles/tripripper_core.dir/tripcodeSearchResult.cpp.o.d"
+  "CMakeFiles/tripripper_core.dir/wordlistKeyspace.cpp.o"
+  "CMakeFiles/tripripper_core.dir/wordlistKeyspace.cpp.o.d"
+  "libtripripper_core.a"
+  "libtripripper_core.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/tripripper_core.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
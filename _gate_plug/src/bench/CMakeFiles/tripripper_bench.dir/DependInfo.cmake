@@ -0,0 +1,21 @@
+
+# Consider dependencies only in project.
+set(CMAKE_DEPENDS_IN_PROJECT_ONLY OFF)
+
+# The set of languages for which implicit dependencies are needed:
+set(CMAKE_DEPENDS_LANGUAGES
+  )
+
+# The set of dependency files which are needed:
+set(CMAKE_DEPENDS_DEPENDENCY_FILES
+  "/root/repo/src/bench/benchmark.cpp" "src/bench/CMakeFiles/tripripper_bench.dir/benchmark.cpp.o" "gcc" "src/bench/CMakeFiles/tripripper_bench.dir/benchmark.cpp.o.d"
+  "/root/repo/src/bench/tripripperBench.cpp" "src/bench/CMakeFiles/tripripper_bench.dir/tripripperBench.cpp.o" "gcc" "src/bench/CMakeFiles/tripripper_bench.dir/tripripperBench.cpp.o.d"
+  )
+
+# Targets to which this target links.
+set(CMAKE_TARGET_LINKED_INFO_FILES
+  "/root/repo/_gate_plug/src/CMakeFiles/tripripper_core.dir/DependInfo.cmake"
+  )
+
+# Fortran module output directory.
+set(CMAKE_Fortran_TARGET_MODULE_DIR "")
@@ -0,0 +1,13 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/tripripper_bench.dir/benchmark.cpp.o"
+  "CMakeFiles/tripripper_bench.dir/benchmark.cpp.o.d"
+  "CMakeFiles/tripripper_bench.dir/tripripperBench.cpp.o"
+  "CMakeFiles/tripripper_bench.dir/tripripperBench.cpp.o.d"
+  "tripripper_bench"
+  "tripripper_bench.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/tripripper_bench.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,21 @@
+
+# Consider dependencies only in project.
+set(CMAKE_DEPENDS_IN_PROJECT_ONLY OFF)
+
+# The set of languages for which implicit dependencies are needed:
+set(CMAKE_DEPENDS_LANGUAGES
+  )
+
+# The set of dependency files which are needed:
+set(CMAKE_DEPENDS_DEPENDENCY_FILES
+  "/root/repo/src/bench/dispatchSimulator.cpp" "src/bench/CMakeFiles/tripripper_dispatch_sim.dir/dispatchSimulator.cpp.o" "gcc" "src/bench/CMakeFiles/tripripper_dispatch_sim.dir/dispatchSimulator.cpp.o.d"
+  "/root/repo/src/bench/tripripperDispatchSim.cpp" "src/bench/CMakeFiles/tripripper_dispatch_sim.dir/tripripperDispatchSim.cpp.o" "gcc" "src/bench/CMakeFiles/tripripper_dispatch_sim.dir/tripripperDispatchSim.cpp.o.d"
+  )
+
+# Targets to which this target links.
+set(CMAKE_TARGET_LINKED_INFO_FILES
+  "/root/repo/_gate_plug/src/CMakeFiles/tripripper_core.dir/DependInfo.cmake"
+  )
+
+# Fortran module output directory.
+set(CMAKE_Fortran_TARGET_MODULE_DIR "")
@@ -0,0 +1,13 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/tripripper_dispatch_sim.dir/dispatchSimulator.cpp.o"
+  "CMakeFiles/tripripper_dispatch_sim.dir/dispatchSimulator.cpp.o.d"
+  "CMakeFiles/tripripper_dispatch_sim.dir/tripripperDispatchSim.cpp.o"
+  "CMakeFiles/tripripper_dispatch_sim.dir/tripripperDispatchSim.cpp.o.d"
+  "tripripper_dispatch_sim"
+  "tripripper_dispatch_sim.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/tripripper_dispatch_sim.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,13 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/strcmp-avx2.dir/__/strcmpMatching.cpp.o"
+  "CMakeFiles/strcmp-avx2.dir/__/strcmpMatching.cpp.o.d"
+  "CMakeFiles/strcmp-avx2.dir/strcmpPlugin.cpp.o"
+  "CMakeFiles/strcmp-avx2.dir/strcmpPlugin.cpp.o.d"
+  "strcmp.avx2.pdb"
+  "strcmp.avx2.so"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/strcmp-avx2.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
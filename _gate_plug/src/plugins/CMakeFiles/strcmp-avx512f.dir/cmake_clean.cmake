@@ -0,0 +1,13 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/strcmp-avx512f.dir/__/strcmpMatching.cpp.o"
+  "CMakeFiles/strcmp-avx512f.dir/__/strcmpMatching.cpp.o.d"
+  "CMakeFiles/strcmp-avx512f.dir/strcmpPlugin.cpp.o"
+  "CMakeFiles/strcmp-avx512f.dir/strcmpPlugin.cpp.o.d"
+  "strcmp.avx512f.pdb"
+  "strcmp.avx512f.so"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/strcmp-avx512f.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
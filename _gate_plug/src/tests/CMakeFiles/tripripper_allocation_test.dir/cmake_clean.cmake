@@ -0,0 +1,13 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/tripripper_allocation_test.dir/__/allocationHooks.cpp.o"
+  "CMakeFiles/tripripper_allocation_test.dir/__/allocationHooks.cpp.o.d"
+  "CMakeFiles/tripripper_allocation_test.dir/tripripperAllocationTest.cpp.o"
+  "CMakeFiles/tripripper_allocation_test.dir/tripripperAllocationTest.cpp.o.d"
+  "tripripper_allocation_test"
+  "tripripper_allocation_test.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/tripripper_allocation_test.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,14 @@
+# CMake generated Testfile for 
+# Source directory: /root/repo/src/tests
+# Build directory: /root/repo/_gate_plug/src/tests
+# 
+# This file includes the relevant testing commands required for 
+# testing this directory and lists subdirectories to be tested as well.
+add_test(simple_test "/usr/bin/mpiexec" "-n" "32" "/root/repo/_gate_plug/src/tripripper" "--keyspace-mapping=linear" "--tripcode-algorithm=openssl" "--matching-algorithm=strcmp")
+set_tests_properties(simple_test PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/src/tests/CMakeLists.txt;13;add_test;/root/repo/src/tests/CMakeLists.txt;0;")
+add_test(bench_test "/root/repo/_gate_plug/src/bench/tripripper_bench" "--quick")
+set_tests_properties(bench_test PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/src/tests/CMakeLists.txt;22;add_test;/root/repo/src/tests/CMakeLists.txt;0;")
+add_test(dispatch_sim_test "/root/repo/_gate_plug/src/bench/tripripper_dispatch_sim" "--quick")
+set_tests_properties(dispatch_sim_test PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/src/tests/CMakeLists.txt;27;add_test;/root/repo/src/tests/CMakeLists.txt;0;")
+add_test(allocation_test "/root/repo/_gate_plug/src/tests/tripripper_allocation_test")
+set_tests_properties(allocation_test PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/src/tests/CMakeLists.txt;31;add_test;/root/repo/src/tests/CMakeLists.txt;0;")
@@ -0,0 +1,110 @@
+/*******************************************************************************
+ * Copyright 2012 Jonathan Glines <auntieNeo@gmail.com>                        *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ ******************************************************************************/
+
+/**
+ * Replacements of the global operator new and operator delete that count
+ * every allocation and free with the AllocationTracker. Linking this file
+ * into an executable turns the tracker on; see AllocationTracker.
+ */
+
+#include "allocationTracker.h"
+
+#include <cstdlib>
+#include <new>
+
+using TripRipper::AllocationTracker;
+
+namespace
+{
+  void *trackedAllocate(std::size_t size)
+  {
+    AllocationTracker::setActive();
+    AllocationTracker::recordAllocation(size);
+    return malloc(size > 0 ? size : 1);
+  }
+
+  void trackedFree(void *pointer)
+  {
+    if(pointer == NULL)
+      return;
+    AllocationTracker::recordFree();
+    free(pointer);
+  }
+}
+
+void *operator new(std::size_t size)
+{
+  void *pointer = trackedAllocate(size);
+  if(pointer == NULL)
+    throw std::bad_alloc();
+  return pointer;
+}
+
+void *operator new[](std::size_t size)
+{
+  void *pointer = trackedAllocate(size);
+  if(pointer == NULL)
+    throw std::bad_alloc();
+  return pointer;
+}
+
+void *operator new(std::size_t size, const std::nothrow_t &) throw()
+{
+  return trackedAllocate(size);
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &) throw()
+{
+  return trackedAllocate(size);
+}
+
+void operator delete(void *pointer) throw()
+{
+  trackedFree(pointer);
+}
+
+void operator delete[](void *pointer) throw()
+{
+  trackedFree(pointer);
+}
+
+void operator delete(void *pointer, const std::nothrow_t &) throw()
+{
+  trackedFree(pointer);
+}
+
+void operator delete[](void *pointer, const std::nothrow_t &) throw()
+{
+  trackedFree(pointer);
+}
+
+#ifdef __cpp_sized_deallocation
+void operator delete(void *pointer, std::size_t) throw()
+{
+  trackedFree(pointer);
+}
+
+void operator delete[](void *pointer, std::size_t) throw()
+{
+  trackedFree(pointer);
+}
+#endif
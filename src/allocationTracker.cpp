@@ -0,0 +1,89 @@
+/*******************************************************************************
+ * Copyright 2012 Jonathan Glines <auntieNeo@gmail.com>                        *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ ******************************************************************************/
+
+#include "allocationTracker.h"
+
+#include <cstdio>
+#include <sstream>
+
+namespace TripRipper
+{
+  __thread int AllocationTracker::s_stage = AllocationTracker::OTHER;
+  __thread bool AllocationTracker::s_steady = false;
+  volatile uint64_t AllocationTracker::s_counts[AllocationTracker::NUM_STAGES][AllocationTracker::NUM_COUNTERS];
+  volatile uint64_t AllocationTracker::s_pools = 0;
+  volatile uint64_t AllocationTracker::s_blocks = 0;
+  volatile uint64_t AllocationTracker::s_steadyAllocations = 0;
+  bool AllocationTracker::s_active = false;
+
+  const char *AllocationTracker::stageName(Stage stage)
+  {
+    static const char *NAMES[NUM_STAGES] = {
+      "other", "pool request", "key generation", "tripcodes", "matching", "results"
+    };
+    return NAMES[stage];
+  }
+
+  /**
+   * Clears the counts, such as after the allocations of setting up the
+   * search.
+   */
+  void AllocationTracker::reset()
+  {
+    for(int i = 0; i < NUM_STAGES; ++i)
+    {
+      for(int j = 0; j < NUM_COUNTERS; ++j)
+        s_counts[i][j] = 0;
+    }
+    s_pools = s_blocks = s_steadyAllocations = 0;
+  }
+
+  /**
+   * Formats the allocations, bytes allocated and frees of each stage, in
+   * total and per pool and KeyBlock, and the allocations of the steady state.
+   */
+  std::string AllocationTracker::describe(const uint64_t counts[NUM_STAGES][NUM_COUNTERS], uint64_t pools, uint64_t blocks, uint64_t steadyAllocations)
+  {
+    std::ostringstream out;
+    char line[160];
+    snprintf(line, sizeof(line), "  %-16s %12s %14s %12s %12s %12s\n",
+        "stage", "allocations", "bytes", "frees", "per pool", "per block");
+    out << line;
+    for(int i = 0; i < NUM_STAGES; ++i)
+    {
+      const uint64_t *stage = counts[i];
+      if(stage[ALLOCATIONS] == 0 && stage[FREES] == 0)
+        continue;
+      snprintf(line, sizeof(line), "  %-16s %12llu %14llu %12llu %12.2f %12.4f\n",
+          stageName(static_cast<Stage>(i)), static_cast<unsigned long long>(stage[ALLOCATIONS]),
+          static_cast<unsigned long long>(stage[BYTES]), static_cast<unsigned long long>(stage[FREES]),
+          pools > 0 ? static_cast<double>(stage[ALLOCATIONS]) / pools : 0.0,
+          blocks > 0 ? static_cast<double>(stage[ALLOCATIONS]) / blocks : 0.0);
+      out << line;
+    }
+    snprintf(line, sizeof(line), "  %llu pools, %llu blocks, %llu allocations after the first pool\n",
+        static_cast<unsigned long long>(pools), static_cast<unsigned long long>(blocks),
+        static_cast<unsigned long long>(steadyAllocations));
+    out << line;
+    return out.str();
+  }
+}
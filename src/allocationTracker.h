@@ -0,0 +1,109 @@
+/*******************************************************************************
+ * Copyright 2012 Jonathan Glines <auntieNeo@gmail.com>                        *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ ******************************************************************************/
+
+#ifndef ALLOCATION_TRACKER_H_
+#define ALLOCATION_TRACKER_H_
+
+#include "common.h"
+
+namespace TripRipper
+{
+  /**
+   * The AllocationTracker class counts the allocations made by each stage of
+   * the search, to keep the search loop free of calls to the allocator,
+   * whose locks are what limit the number of threads a rank can search
+   * with.
+   *
+   * Allocations are only counted when the replacements of the global
+   * operator new and operator delete in allocationHooks.cpp are linked in,
+   * as they are in builds with TRIPRIPPER_TRACK_ALLOCATIONS; otherwise
+   * active() returns false. The stage of each thread is set with an
+   * AllocationStage for the extent of a scope, and allocations are counted
+   * against it.
+   *
+   * TripcodeCrawler::doSearch() counts each pool and KeyBlock searched, and
+   * TripcodeCrawler::runWorker() marks everything after its first pool as
+   * the steady state of the search: requesting pools, generating keys,
+   * computing and matching tripcodes and storing the results. The first
+   * pool may size the buffers that the rest reuse, but the steady state must
+   * not allocate at all. The loops of node leaders and of ATOMIC_DISPATCH
+   * mode are not covered.
+   */
+  class AllocationTracker
+  {
+    public:
+      enum Stage { OTHER, POOL_REQUEST, KEY_GENERATION, TRIPCODES, MATCHING, RESULTS, NUM_STAGES };
+      enum Counter { ALLOCATIONS, BYTES, FREES, NUM_COUNTERS };
+
+      static const char *stageName(Stage stage);
+
+      static Stage stage() { return static_cast<Stage>(s_stage); }
+      static void setStage(Stage stage) { s_stage = stage; }
+      static void setSteadyState(bool steady) { s_steady = steady; }
+
+      static void countPool() { __sync_fetch_and_add(&s_pools, 1); }
+      static void countBlock() { __sync_fetch_and_add(&s_blocks, 1); }
+
+      static void recordAllocation(size_t size)
+      {
+        __sync_fetch_and_add(&s_counts[s_stage][ALLOCATIONS], 1);
+        __sync_fetch_and_add(&s_counts[s_stage][BYTES], size);
+        if(s_steady)
+          __sync_fetch_and_add(&s_steadyAllocations, 1);
+      }
+      static void recordFree() { __sync_fetch_and_add(&s_counts[s_stage][FREES], 1); }
+
+      static bool active() { return s_active; }
+      static void setActive() { s_active = true; }
+
+      static uint64_t count(Stage stage, Counter counter) { return s_counts[stage][counter]; }
+      static uint64_t pools() { return s_pools; }
+      static uint64_t blocks() { return s_blocks; }
+      static uint64_t steadyAllocations() { return s_steadyAllocations; }
+      static void reset();
+
+      static std::string describe(const uint64_t counts[NUM_STAGES][NUM_COUNTERS], uint64_t pools, uint64_t blocks, uint64_t steadyAllocations);
+
+    private:
+      static __thread int s_stage;
+      static __thread bool s_steady;
+      static volatile uint64_t s_counts[NUM_STAGES][NUM_COUNTERS];
+      static volatile uint64_t s_pools, s_blocks, s_steadyAllocations;
+      static bool s_active;
+  };
+
+  /**
+   * Sets the AllocationTracker stage of the calling thread until the end of
+   * the scope.
+   */
+  class AllocationStage
+  {
+    public:
+      AllocationStage(AllocationTracker::Stage stage) : m_previous(AllocationTracker::stage()) { AllocationTracker::setStage(stage); }
+      ~AllocationStage() { AllocationTracker::setStage(m_previous); }
+
+    private:
+      AllocationTracker::Stage m_previous;
+  };
+}
+
+#endif
@@ -0,0 +1,72 @@
+/*******************************************************************************
+ * Copyright 2012 Jonathan Glines <auntieNeo@gmail.com>                        *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ ******************************************************************************/
+
+#include "atomicPoolCounter.h"
+
+namespace TripRipper
+{
+  /**
+   * Allocates the window holding the counter on hostRank and sets it to
+   * initialValue. The counter can be used by all ranks of comm once the
+   * constructor returns.
+   */
+  AtomicPoolCounter::AtomicPoolCounter(MPI_Comm comm, int hostRank, uint64_t initialValue) :
+    m_comm(comm),
+    m_hostRank(hostRank),
+    m_counter(NULL)
+  {
+    int rank;
+    MPI_Comm_rank(m_comm, &rank);
+    MPI_Aint windowSize = (rank == m_hostRank) ? sizeof(uint64_t) : 0;
+    MPI_Win_allocate(windowSize, sizeof(uint64_t), MPI_INFO_NULL, m_comm, &m_counter, &m_window);
+
+    if(rank == m_hostRank)
+    {
+      MPI_Win_lock(MPI_LOCK_EXCLUSIVE, m_hostRank, 0, m_window);
+      MPI_Put(&initialValue, 1, MPI_UINT64_T, m_hostRank, 0, 1, MPI_UINT64_T, m_window);
+      MPI_Win_unlock(m_hostRank, m_window);
+    }
+    MPI_Barrier(m_comm);
+
+    // a passive target epoch is held open for the lifetime of the counter
+    MPI_Win_lock_all(MPI_MODE_NOCHECK, m_window);
+  }
+
+  AtomicPoolCounter::~AtomicPoolCounter()
+  {
+    MPI_Win_unlock_all(m_window);
+    MPI_Win_free(&m_window);
+  }
+
+  /**
+   * Atomically adds count to the counter and returns the value the counter
+   * held before the addition. The caller has claimed the pools from the
+   * returned value up to, but not including, the returned value plus count.
+   */
+  uint64_t AtomicPoolCounter::fetchAndAdd(uint64_t count)
+  {
+    uint64_t previous;
+    MPI_Fetch_and_op(&count, &previous, MPI_UINT64_T, m_hostRank, 0, MPI_SUM, m_window);
+    MPI_Win_flush(m_hostRank, m_window);
+    return previous;
+  }
+}
@@ -0,0 +1,62 @@
+/*******************************************************************************
+ * Copyright 2012 Jonathan Glines <auntieNeo@gmail.com>                        *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ ******************************************************************************/
+
+#ifndef ATOMIC_POOL_COUNTER_H_
+#define ATOMIC_POOL_COUNTER_H_
+
+#include "common.h"
+
+#include <mpi.h>
+
+namespace TripRipper
+{
+  /**
+   * The AtomicPoolCounter class is a shared counter of pool indices that
+   * lives in an MPI-3 RMA window on a single host rank. Ranks claim ranges of
+   * pools by atomically adding to the counter with MPI_Fetch_and_op(), so no
+   * two-sided messages are exchanged with the host and the host needs no
+   * dispatcher loop. With hardware that supports network atomics, the host's
+   * CPU is not involved at all.
+   *
+   * This only works for mappings in which a pool is fully described by its
+   * index, i.e. mappings that implement KeyspaceMapping::createPool().
+   *
+   * Both the constructor and the destructor are collective over the given
+   * communicator.
+   */
+  class AtomicPoolCounter
+  {
+    public:
+      AtomicPoolCounter(MPI_Comm comm, int hostRank, uint64_t initialValue);
+      ~AtomicPoolCounter();
+
+      uint64_t fetchAndAdd(uint64_t count);
+
+    private:
+      MPI_Comm m_comm;
+      int m_hostRank;
+      MPI_Win m_window;
+      uint64_t *m_counter;
+  };
+}
+
+#endif
@@ -0,0 +1,165 @@
+/*******************************************************************************
+ * Copyright 2012 Jonathan Glines <auntieNeo@gmail.com>                        *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ ******************************************************************************/
+
+#include "autotuner.h"
+#include "engineSelector.h"
+#include "keyspace.h"
+#include "keyspaceFactory.h"
+#include "matchingAlgorithm.h"
+#include "tripcodeAlgorithm.h"
+#include "tripcodeContainer.h"
+
+#include <sstream>
+#include <time.h>
+
+namespace TripRipper
+{
+  const size_t Autotuner::MIN_BLOCK_KEYS;
+  const size_t Autotuner::MAX_BLOCK_KEYS;
+  const double Autotuner::TRIAL_TIME = 0.1;
+
+  // the name of the cache file of the profiles
+  static const char PROFILE_CACHE[] = "profile";
+
+  static double now()
+  {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec + time.tv_nsec * 1e-9;
+  }
+
+  /**
+   * The algorithms are not owned by the Autotuner.
+   */
+  Autotuner::Autotuner(TripcodeAlgorithm *tripcodeAlgorithm, MatchingAlgorithm *matchingAlgorithm) :
+    m_tripcodeAlgorithm(tripcodeAlgorithm),
+    m_matchingAlgorithm(matchingAlgorithm)
+  {
+  }
+
+  Autotuner::~Autotuner()
+  {
+  }
+
+  /**
+   * Returns the number of keys per block that goes through the keyspace
+   * fastest, measured on the serialized pool in poolData. The keys per second
+   * at that block size are returned in rate. Returns 0 if the tripcode
+   * algorithm fails its selfTest(), since its speed is meaningless.
+   */
+  size_t Autotuner::tuneBlockKeys(const uint8_t *poolData, size_t poolSize, double *rate)
+  {
+    size_t bestBlockKeys = 0;
+    *rate = 0.0;
+    if(!m_tripcodeAlgorithm->selfTest())
+      return 0;
+    // the first trial warms up caches and lazily initialized tables
+    measure(poolData, poolSize, MIN_BLOCK_KEYS);
+    for(int round = 0; round < TRIAL_ROUNDS; ++round)
+    {
+      for(size_t blockKeys = MIN_BLOCK_KEYS; blockKeys <= MAX_BLOCK_KEYS; blockKeys *= 2)
+      {
+        double trialRate = measure(poolData, poolSize, blockKeys);
+        if(trialRate > *rate)
+        {
+          *rate = trialRate;
+          bestBlockKeys = blockKeys;
+        }
+      }
+    }
+    return bestBlockKeys;
+  }
+
+  /**
+   * Searches copies of the serialized pool in poolData with blocks of the
+   * given number of keys for TRIAL_TIME seconds, and returns the keys per
+   * second. Returns 0 if the pool cannot be read or is empty.
+   */
+  double Autotuner::measure(const uint8_t *poolData, size_t poolSize, size_t blockKeys)
+  {
+    TripcodeContainer tripcodes, matches;
+    uint64_t keys = 0;
+    double start = now(), elapsed = 0.0;
+    while(elapsed < TRIAL_TIME)
+    {
+      KeyspacePool *pool = KeyspaceFactory::deserializeKeyspacePool(poolData, poolSize);
+      if(pool == NULL)
+        return 0.0;
+      pool->setBlockKeys(blockKeys);
+      pool->setOutputAlignment(m_tripcodeAlgorithm->inputAlignment());
+      pool->setOutputStride(m_tripcodeAlgorithm->inputStride());
+      uint64_t poolKeys = 0;
+      KeyBlock *block;
+      while(elapsed < TRIAL_TIME && (block = pool->getNextBlock()) != NULL)
+      {
+        m_tripcodeAlgorithm->computeTripcodes(block, &tripcodes);
+        m_matchingAlgorithm->matchTripcodes(&tripcodes, &matches);
+        tripcodes.clear();
+        matches.clear();
+        poolKeys += block->numKeys();
+        elapsed = now() - start;
+      }
+      delete pool;
+      if(poolKeys == 0)
+        return 0.0;
+      keys += poolKeys;
+    }
+    return keys / elapsed;
+  }
+
+  /**
+   * Returns the key of the profile of the given algorithms searching the
+   * given keyspace strategy. Only the name of the keyspace mapping counts,
+   * not its arguments.
+   */
+  std::string Autotuner::profileKey(const std::string &tripcodeAlgorithm, const std::string &matchingAlgorithm, const std::string &keyspaceStrategy)
+  {
+    return tripcodeAlgorithm + " " + matchingAlgorithm + " " + keyspaceStrategy.substr(0, keyspaceStrategy.find(':'));
+  }
+
+  /**
+   * Returns the number of keys per block stored in the profile of this host
+   * under the given key, or 0 if none has been measured.
+   */
+  size_t Autotuner::loadBlockKeys(const std::string &key)
+  {
+    std::string value;
+    if(!EngineSelector::readCache(PROFILE_CACHE, key, &value))
+      return 0;
+    std::istringstream profile(value);
+    size_t blockKeys;
+    if(!(profile >> blockKeys) || blockKeys < MIN_BLOCK_KEYS || blockKeys > MAX_BLOCK_KEYS)
+      return 0;
+    return blockKeys;
+  }
+
+  /**
+   * Stores the number of keys per block in the profile of this host under
+   * the given key, along with the keys per second measured with it.
+   */
+  void Autotuner::saveBlockKeys(const std::string &key, size_t blockKeys, double rate)
+  {
+    std::ostringstream value;
+    value << blockKeys << " " << static_cast<uint64_t>(rate);
+    EngineSelector::writeCache(PROFILE_CACHE, key, value.str());
+  }
+}
@@ -0,0 +1,76 @@
+/*******************************************************************************
+ * Copyright 2012 Jonathan Glines <auntieNeo@gmail.com>                        *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ ******************************************************************************/
+
+#ifndef AUTOTUNER_H_
+#define AUTOTUNER_H_
+
+#include "common.h"
+
+namespace TripRipper
+{
+  class TripcodeAlgorithm;
+  class MatchingAlgorithm;
+
+  /**
+   * The Autotuner class measures the number of keys per KeyBlock at which a
+   * TripcodeAlgorithm and MatchingAlgorithm go through a keyspace fastest on
+   * the host it runs on. Small blocks spend more time per key in the calls
+   * between the pool and the algorithms, while blocks that no longer fit in
+   * the caches of the core spend it waiting for memory, and where the
+   * optimum lies depends on the algorithms, the keyspace mapping and the CPU.
+   *
+   * Each power of two from MIN_BLOCK_KEYS to MAX_BLOCK_KEYS is measured for
+   * TRIAL_TIME seconds, TRIAL_ROUNDS times, on a pool of the keyspace being
+   * searched, and the best measurement of each counts.
+   *
+   * The result is stored in a profile, a cache file of the EngineSelector
+   * kept per host, under the names of the algorithms and the keyspace
+   * mapping it was measured for. The TripcodeCrawler loads the profile at
+   * the start of every search, so every node searches with the block size
+   * measured on it, and the defaults of the pools are used where there is no
+   * profile.
+   */
+  class Autotuner
+  {
+    public:
+      static const size_t MIN_BLOCK_KEYS = 64;
+      static const size_t MAX_BLOCK_KEYS = 1 << 16;
+      static const double TRIAL_TIME;
+      static const int TRIAL_ROUNDS = 2;
+
+      Autotuner(TripcodeAlgorithm *tripcodeAlgorithm, MatchingAlgorithm *matchingAlgorithm);
+      ~Autotuner();
+
+      size_t tuneBlockKeys(const uint8_t *poolData, size_t poolSize, double *rate);
+      double measure(const uint8_t *poolData, size_t poolSize, size_t blockKeys);
+
+      static std::string profileKey(const std::string &tripcodeAlgorithm, const std::string &matchingAlgorithm, const std::string &keyspaceStrategy);
+      static size_t loadBlockKeys(const std::string &key);
+      static void saveBlockKeys(const std::string &key, size_t blockKeys, double rate);
+
+    private:
+      TripcodeAlgorithm *m_tripcodeAlgorithm;
+      MatchingAlgorithm *m_matchingAlgorithm;
+  };
+}
+
+#endif
@@ -0,0 +1,191 @@
+/*******************************************************************************
+ * Copyright 2012 Jonathan Glines <auntieNeo@gmail.com>                        *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ ******************************************************************************/
+
+#include "benchmark.h"
+#include "perfCounters.h"
+
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <time.h>
+
+namespace TripRipper
+{
+  static double now()
+  {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec + time.tv_nsec * 1e-9;
+  }
+
+  /**
+   * Every stage is measured with the given number of samples, each of which
+   * runs the stage for at least sampleTime seconds.
+   */
+  Benchmark::Benchmark(double sampleTime, size_t samples) :
+    m_sampleTime(sampleTime),
+    m_samples(samples),
+    m_counters(NULL)
+  {
+    assert(samples >= 2);
+  }
+
+  Benchmark::~Benchmark()
+  {
+  }
+
+  /**
+   * Measures the rate of the given stage, prints it, and adds it to the
+   * results under the given name.
+   */
+  const Benchmark::Result &Benchmark::measure(const std::string &name, const std::string &unit, Stage *stage)
+  {
+    std::vector<double> rates;
+    uint64_t totalUnits = 0;
+    // the first sample warms up caches and lazily initialized tables
+    for(size_t sample = 0; sample <= m_samples; ++sample)
+    {
+      if(sample == 1 && m_counters != NULL)
+      {
+        m_counters->reset();
+        m_counters->start();
+      }
+      uint64_t units = 0;
+      double start = now(), elapsed;
+      do
+      {
+        units += stage->run();
+        elapsed = now() - start;
+      } while(elapsed < m_sampleTime);
+      if(sample > 0)
+      {
+        rates.push_back(units / elapsed);
+        totalUnits += units;
+      }
+    }
+    if(m_counters != NULL)
+      m_counters->stop();
+
+    double sum = 0.0;
+    for(size_t i = 0; i < rates.size(); ++i)
+      sum += rates[i];
+    double mean = sum / rates.size();
+    double squares = 0.0;
+    for(size_t i = 0; i < rates.size(); ++i)
+      squares += (rates[i] - mean) * (rates[i] - mean);
+    double deviation = sqrt(squares / (rates.size() - 1));
+
+    Result result;
+    result.name = name;
+    result.unit = unit;
+    result.mean = mean;
+    result.interval = studentT(rates.size() - 1) * deviation / sqrt(static_cast<double>(rates.size()));
+    m_results.push_back(result);
+
+    std::cout << std::left << std::setw(40) << name << std::right << std::fixed << std::setprecision(0)
+              << std::setw(16) << result.mean << " +- " << std::setw(12) << result.interval
+              << " " << unit << "/s" << std::endl;
+    if(m_counters != NULL)
+    {
+      uint64_t counts[PerfCounters::NUM_COUNTERS];
+      m_counters->read(counts);
+      std::cout << "  " << PerfCounters::describe(counts, totalUnits) << std::endl;
+    }
+    return m_results.back();
+  }
+
+  /**
+   * Writes the results to the file at the given path, for use as a baseline
+   * by compare(). Returns false if the file could not be written.
+   */
+  bool Benchmark::save(const std::string &path) const
+  {
+    std::ofstream file(path.c_str());
+    file << std::setprecision(12);
+    for(size_t i = 0; i < m_results.size(); ++i)
+      file << m_results[i].name << " " << m_results[i].mean << " " << m_results[i].interval << " " << m_results[i].unit << "\n";
+    file.close();
+    if(!file)
+    {
+      std::cerr << "Could not write " << path << std::endl;
+      return false;
+    }
+    return true;
+  }
+
+  /**
+   * Compares the results to the baseline in the file at the given path, and
+   * prints the stages that have regressed by more than the given fraction.
+   * Stages that are missing from either side are not compared. Returns false
+   * if any stage has regressed or the baseline could not be read.
+   */
+  bool Benchmark::compare(const std::string &path, double tolerance) const
+  {
+    std::ifstream file(path.c_str());
+    if(!file)
+    {
+      std::cerr << "Could not read baseline " << path << std::endl;
+      return false;
+    }
+    bool passed = true;
+    std::string line;
+    while(std::getline(file, line))
+    {
+      std::istringstream fields(line);
+      std::string name;
+      double baseline;
+      if(!(fields >> name >> baseline))
+        continue;
+      for(size_t i = 0; i < m_results.size(); ++i)
+      {
+        if(m_results[i].name != name)
+          continue;
+        if(m_results[i].mean + m_results[i].interval < baseline * (1.0 - tolerance))
+        {
+          std::cerr << "Regression in " << name << ": " << std::fixed << std::setprecision(0)
+                    << m_results[i].mean << " " << m_results[i].unit << "/s, down from " << baseline << std::endl;
+          passed = false;
+        }
+      }
+    }
+    return passed;
+  }
+
+  /**
+   * Returns the two-sided 95% critical value of Student's t distribution
+   * with the given degrees of freedom.
+   */
+  double Benchmark::studentT(size_t degrees)
+  {
+    static const double TABLE[] = {
+      12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+      2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+      2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042
+    };
+    assert(degrees > 0);
+    if(degrees <= sizeof(TABLE) / sizeof(TABLE[0]))
+      return TABLE[degrees - 1];
+    return 1.960;
+  }
+}
@@ -0,0 +1,93 @@
+/*******************************************************************************
+ * Copyright 2012 Jonathan Glines <auntieNeo@gmail.com>                        *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ ******************************************************************************/
+
+#ifndef BENCHMARK_H_
+#define BENCHMARK_H_
+
+#include "common.h"
+
+namespace TripRipper
+{
+  /**
+   * The Benchmark class measures the throughput of stages of the search
+   * pipeline in isolation, and checks the measurements against a baseline.
+   *
+   * Each stage is measured with a warm up sample followed by a number of
+   * samples of a fixed length of time. The result of a stage is the mean of
+   * the rates of its samples, in units, such as keys, per second, along with
+   * the half width of its 95% confidence interval according to Student's t
+   * distribution. Benchmarks run on a single thread, so the rates are per
+   * core.
+   *
+   * Results are saved as a text file with a line for each stage, which holds
+   * the name of the stage, the mean, the half width of the interval and the
+   * unit, separated by spaces. A stage has regressed from a baseline file if
+   * even the upper end of its interval falls short of the mean in the
+   * baseline by more than the given tolerance.
+   *
+   * If PerfCounters are set, the hardware events of the timed samples of
+   * each stage are printed per unit along with its rate.
+   */
+  class PerfCounters;
+
+  class Benchmark
+  {
+    public:
+      /**
+       * A Stage is one step of the pipeline set up to run in isolation.
+       * run() does a small, fixed amount of work, and returns the number of
+       * units it processed.
+       */
+      class Stage
+      {
+        public:
+          virtual ~Stage() {}
+          virtual uint64_t run() = 0;
+      };
+
+      struct Result
+      {
+        std::string name, unit;
+        double mean, interval;
+      };
+
+      Benchmark(double sampleTime, size_t samples);
+      ~Benchmark();
+
+      const Result &measure(const std::string &name, const std::string &unit, Stage *stage);
+      const std::vector<Result> &results() const { return m_results; }
+      void setPerfCounters(PerfCounters *counters) { m_counters = counters; }
+
+      bool save(const std::string &path) const;
+      bool compare(const std::string &path, double tolerance) const;
+
+      static double studentT(size_t degrees);
+
+    private:
+      double m_sampleTime;
+      size_t m_samples;
+      PerfCounters *m_counters;
+      std::vector<Result> m_results;
+  };
+}
+
+#endif
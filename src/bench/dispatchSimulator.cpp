@@ -0,0 +1,224 @@
+/*******************************************************************************
+ * Copyright 2012 Jonathan Glines <auntieNeo@gmail.com>                        *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ ******************************************************************************/
+
+#include "dispatchSimulator.h"
+#include "keyspace.h"
+#include "keyspaceDispatcher.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <deque>
+#include <functional>
+#include <queue>
+#include <time.h>
+
+namespace TripRipper
+{
+  // virtual seconds between calls to KeyspaceDispatcher::expireLeases(),
+  // which the root makes while polling for requests
+  static const double EXPIRY_INTERVAL = 1e-3;
+
+  namespace
+  {
+    // a request for a pool, which arrives at the root at the given time
+    struct Request
+    {
+      double arrival, sent;
+      int rank;
+      bool operator>(const Request &other) const { return arrival > other.arrival; }
+    };
+
+    double percentile(const std::vector<double> &sorted, double fraction)
+    {
+      if(sorted.empty())
+        return 0.0;
+      size_t index = static_cast<size_t>(fraction * (sorted.size() - 1) + 0.5);
+      return sorted[index];
+    }
+  }
+
+  DispatchSimulator::DispatchSimulator(KeyspaceMapping *mapping, const Config &config) :
+    m_mapping(mapping), m_config(config), m_randomState(0x2545f4914f6cdd1dULL),
+    m_requests(0), m_rootBusy(0.0), m_makespan(0.0), m_idealMakespan(0.0), m_keysSearched(0),
+    m_firstFinish(0.0), m_lastFinish(0.0)
+  {
+    assert(m_mapping != NULL);
+    assert(m_config.ranks > 0);
+  }
+
+  double DispatchSimulator::wallTime()
+  {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec + time.tv_nsec * 1e-9;
+  }
+
+  /**
+   * Returns a pseudorandom number from 0 up to 1, the same sequence on every
+   * run.
+   */
+  double DispatchSimulator::random()
+  {
+    m_randomState = m_randomState * 6364136223846793005ULL + 1442695040888963407ULL;
+    return (m_randomState >> 11) * (1.0 / 9007199254740992.0);
+  }
+
+  /**
+   * Simulates the search of the whole mapping. Returns false if the search
+   * could not be completed, which means the dispatcher left ranks waiting
+   * for pools that never came back to the mapping.
+   */
+  bool DispatchSimulator::run()
+  {
+    int ranks = m_config.ranks;
+    size_t poolSize = m_mapping->poolSize();
+    KeyspaceDispatcher dispatcher(m_mapping, ranks);
+    dispatcher.setTargetLeaseTime(m_config.leaseTime);
+
+    std::vector<double> rates(ranks);
+    double totalRate = 0.0;
+    for(int i = 0; i < ranks; ++i)
+    {
+      rates[i] = m_config.keysPerSecond * (1.0 + m_config.rateSpread * (2.0 * random() - 1.0));
+      if(random() < m_config.stragglers)
+        rates[i] /= m_config.slowdown;
+      totalRate += rates[i];
+    }
+    m_idealMakespan = static_cast<double>(m_mapping->poolsLeft()) * poolSize / totalRate;
+
+    std::priority_queue<Request, std::vector<Request>, std::greater<Request> > requests;
+    for(int i = 0; i < ranks; ++i)
+    {
+      Request request = { m_config.latency, 0.0, i };
+      requests.push(request);
+    }
+    std::deque<Request> waiting;
+    std::vector<double> lastWorkEnd(ranks, 0.0);
+    double rootTime = 0.0, lastExpiry = 0.0;
+
+    while(!requests.empty())
+    {
+      Request request = requests.top();
+      requests.pop();
+      ++m_requests;
+      rootTime = std::max(rootTime, request.arrival);
+      m_queueTimes.push_back(rootTime - request.arrival);
+
+      double start = wallTime();
+      bool poolsReturned = false;
+      if(dispatcher.lease(request.rank) != NULL)
+      {
+        dispatcher.checkinLease(request.rank, rootTime);
+        poolsReturned = true;
+      }
+      if(rootTime - lastExpiry >= EXPIRY_INTERVAL)
+      {
+        if(dispatcher.expireLeases(rootTime) > 0)
+          poolsReturned = true;
+        lastExpiry = rootTime;
+      }
+      waiting.push_back(request);
+
+      // answer the request, and any waiting requests that returned pools
+      // may now satisfy, until one has to keep waiting, as the root does
+      bool leasesLeft = true;
+      for(size_t i = poolsReturned ? waiting.size() : 1; i > 0 && leasesLeft; --i)
+      {
+        Request answered = poolsReturned ? waiting.front() : waiting.back();
+        if(poolsReturned)
+          waiting.pop_front();
+        else
+          waiting.pop_back();
+
+        KeyspacePool *pool = dispatcher.checkoutLease(answered.rank, rootTime);
+        if(pool != NULL)
+        {
+          size_t size;
+          delete[] pool->serialize(&size);
+        }
+        double service = m_config.serviceTime > 0.0 ? m_config.serviceTime : wallTime() - start;
+        start = wallTime();
+        rootTime += service;
+        m_rootBusy += service;
+
+        double received = rootTime + m_config.latency;
+        if(pool != NULL)
+        {
+          uint64_t keys = pool->poolCount() * poolSize;
+          m_keysSearched += keys;
+          m_leaseLatencies.push_back(received - answered.sent);
+          double done = received + keys / rates[answered.rank];
+          lastWorkEnd[answered.rank] = done;
+          Request next = { done + m_config.latency, done, answered.rank };
+          requests.push(next);
+        }
+        else if(dispatcher.finished())
+        {
+          m_leaseLatencies.push_back(received - answered.sent);
+          m_makespan = std::max(m_makespan, received);
+        }
+        else
+        {
+          waiting.push_back(answered);
+          leasesLeft = false;
+        }
+      }
+    }
+
+    std::sort(m_leaseLatencies.begin(), m_leaseLatencies.end());
+    std::sort(m_queueTimes.begin(), m_queueTimes.end());
+    m_firstFinish = m_lastFinish = 0.0;
+    bool first = true;
+    for(int i = 0; i < ranks; ++i)
+    {
+      if(lastWorkEnd[i] == 0.0)
+        continue;
+      m_firstFinish = first ? lastWorkEnd[i] : std::min(m_firstFinish, lastWorkEnd[i]);
+      m_lastFinish = std::max(m_lastFinish, lastWorkEnd[i]);
+      first = false;
+    }
+    return waiting.empty() && dispatcher.finished() && m_mapping->poolsLeft() == 0;
+  }
+
+  void DispatchSimulator::report() const
+  {
+    printf("Simulated %d ranks at %.3g keys/s searching %llu pools of %llu keys\n",
+        m_config.ranks, m_config.keysPerSecond,
+        static_cast<unsigned long long>(m_mapping->totalPools()), static_cast<unsigned long long>(m_mapping->poolSize()));
+    printf("  makespan %.2f s, ideal %.2f s (%.1f%% efficient)\n",
+        m_makespan, m_idealMakespan, m_makespan > 0.0 ? 100.0 * m_idealMakespan / m_makespan : 0.0);
+    printf("  root: %llu requests, %.1f us each, busy %.2f%% of the time, at most %.0f requests/s\n",
+        static_cast<unsigned long long>(m_requests), m_requests > 0 ? 1e6 * m_rootBusy / m_requests : 0.0,
+        m_makespan > 0.0 ? 100.0 * m_rootBusy / m_makespan : 0.0,
+        m_rootBusy > 0.0 ? m_requests / m_rootBusy : 0.0);
+    printf("  lease latency: median %.1f us, 99%% %.1f us, max %.1f us\n",
+        1e6 * percentile(m_leaseLatencies, 0.5), 1e6 * percentile(m_leaseLatencies, 0.99),
+        1e6 * percentile(m_leaseLatencies, 1.0));
+    printf("  queued at the root: median %.1f us, 99%% %.1f us, max %.1f us\n",
+        1e6 * percentile(m_queueTimes, 0.5), 1e6 * percentile(m_queueTimes, 0.99),
+        1e6 * percentile(m_queueTimes, 1.0));
+    double keyspace = static_cast<double>(m_mapping->totalPools()) * m_mapping->poolSize();
+    printf("  tail: ranks stopped searching between %.2f s and %.2f s (%.1f%% imbalance), %.2f%% of the keys searched twice\n",
+        m_firstFinish, m_lastFinish, m_lastFinish > 0.0 ? 100.0 * (m_lastFinish - m_firstFinish) / m_lastFinish : 0.0,
+        m_keysSearched > keyspace ? 100.0 * (m_keysSearched - keyspace) / keyspace : 0.0);
+  }
+}
@@ -0,0 +1,92 @@
+/*******************************************************************************
+ * Copyright 2012 Jonathan Glines <auntieNeo@gmail.com>                        *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ ******************************************************************************/
+
+#ifndef DISPATCH_SIMULATOR_H_
+#define DISPATCH_SIMULATOR_H_
+
+#include "common.h"
+
+namespace TripRipper
+{
+  class KeyspaceMapping;
+
+  /**
+   * The DispatchSimulator class runs the root's KeyspaceDispatcher and a
+   * real KeyspaceMapping against thousands of simulated ranks on a single
+   * thread, to see how changes to lease sizing and the request protocol
+   * behave at a scale that would otherwise need a large allocation.
+   *
+   * The simulation is a discrete event simulation in virtual time. Each rank
+   * searches at its own rate, drawn from around keysPerSecond, and a
+   * fraction of the ranks are stragglers that are slower still. Requests
+   * and responses take latency seconds each way. Like the root in
+   * TripcodeCrawler::runRoot(), the simulated root answers one request at a
+   * time in the order they arrive: it checks in the previous lease of the
+   * rank, checks out a new one and serializes it, and retries the ranks that
+   * are waiting for a pool once pools come back to the mapping. The time
+   * the root spends on each request is the wall time those calls take,
+   * unless a fixed service time is given, so the simulated root is as fast
+   * as the dispatcher on the machine running the simulation.
+   *
+   * report() prints the throughput of the root, the latency of leases from
+   * request to response, and the imbalance at the end of the search.
+   */
+  class DispatchSimulator
+  {
+    public:
+      struct Config
+      {
+        int ranks;
+        double keysPerSecond;
+        // ranks search at keysPerSecond times a factor drawn uniformly from
+        // 1 - rateSpread to 1 + rateSpread
+        double rateSpread;
+        // the fraction of ranks that search slowdown times slower
+        double stragglers, slowdown;
+        double latency;
+        // seconds the root takes per request, or 0 to measure it
+        double serviceTime;
+        double leaseTime;
+      };
+
+      DispatchSimulator(KeyspaceMapping *mapping, const Config &config);
+
+      bool run();
+      void report() const;
+
+    private:
+      static double wallTime();
+      double random();
+
+      KeyspaceMapping *m_mapping;
+      Config m_config;
+      uint64_t m_randomState;
+
+      uint64_t m_requests;
+      double m_rootBusy, m_makespan, m_idealMakespan;
+      uint64_t m_keysSearched;
+      std::vector<double> m_leaseLatencies, m_queueTimes;
+      double m_firstFinish, m_lastFinish;
+  };
+}
+
+#endif
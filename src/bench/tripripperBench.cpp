@@ -0,0 +1,477 @@
+/*******************************************************************************
+ * Copyright 2012 Jonathan Glines <auntieNeo@gmail.com>                        *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ ******************************************************************************/
+
+#include <getopt.h>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <unistd.h>
+#include "benchmark.h"
+#include "engineSelector.h"
+#include "keyspace.h"
+#include "keyspaceFactory.h"
+#include "matchingAlgorithm.h"
+#include "perfCounters.h"
+#include "strategyFactory.h"
+#include "tripcodeAlgorithm.h"
+#include "tripcodeContainer.h"
+
+#define USAGE(status) do { \
+  fprintf(stderr, "Usage: tripripper_bench [options]\n"); \
+  fprintf(stderr, "\n"); \
+  fprintf(stderr, "   Measures the keys per second per core of each stage of the search in\n"); \
+  fprintf(stderr, "   isolation: key generation by each keyspace mapping, pool serialization,\n"); \
+  fprintf(stderr, "   each tripcode algorithm, each matching algorithm, and the stages fused as\n"); \
+  fprintf(stderr, "   in a search. Rates are given with their 95%% confidence intervals.\n"); \
+  fprintf(stderr, "\n"); \
+  fprintf(stderr, "   Options\n"); \
+  fprintf(stderr, "   -q --quick\n"); \
+  fprintf(stderr, "      Take fewer, shorter samples.\n"); \
+  fprintf(stderr, "   -f --filter=[text]\n"); \
+  fprintf(stderr, "      Only run the stages whose names contain the given text.\n"); \
+  fprintf(stderr, "   -s --save=[file]\n"); \
+  fprintf(stderr, "      Save the results to the given file, for use with --baseline.\n"); \
+  fprintf(stderr, "   -b --baseline=[file]\n"); \
+  fprintf(stderr, "      Fail if any stage is slower than in the given file saved with --save\n"); \
+  fprintf(stderr, "      by more than the tolerance.\n"); \
+  fprintf(stderr, "   -t --tolerance=[fraction]\n"); \
+  fprintf(stderr, "      The slowdown allowed by --baseline, 0.1 by default.\n"); \
+  fprintf(stderr, "   -m --match=[string]\n"); \
+  fprintf(stderr, "      The search string given to the matching algorithms.\n"); \
+  fprintf(stderr, "   -p --perf-counters\n"); \
+  fprintf(stderr, "      Also print the cycles, instructions, cache misses and branch misses\n"); \
+  fprintf(stderr, "      of each stage per unit, counted with perf_event_open(2).\n"); \
+  fprintf(stderr, "   -P --plugin-dir=[directory]\n"); \
+  fprintf(stderr, "      Also benchmark the algorithms of the plugins in the given directory.\n"); \
+  exit(status); \
+  } while (0)
+
+using namespace TripRipper;
+
+// the number of keys and tripcodes given to the algorithms at a time
+static const size_t BLOCK_KEYS = 4096;
+
+static uint32_t randomState = 0x2545f491;
+
+static uint32_t nextRandom()
+{
+  randomState = randomState * 1103515245 + 12345;
+  return randomState >> 16;
+}
+
+/**
+ * Returns a serialized copy of the first pool of the given keyspace mapping,
+ * or an empty vector if the mapping cannot be created.
+ */
+static std::vector<uint8_t> firstPool(const std::string &mappingStrategy)
+{
+  std::vector<uint8_t> data;
+  KeyspaceMapping *mapping = StrategyFactory::singleton()->createKeyspaceMapping(mappingStrategy);
+  if(mapping == NULL)
+    return data;
+  KeyspacePool *pool = mapping->checkoutNextPool();
+  if(pool != NULL)
+  {
+    size_t size;
+    uint8_t *buffer = pool->serialize(&size);
+    data.assign(buffer, buffer + size);
+    delete[] buffer;
+    mapping->abandonPool(pool);
+    delete pool;
+  }
+  delete mapping;
+  return data;
+}
+
+/**
+ * Generates the keys of a pool, block by block, starting over with a new
+ * copy of the pool when it runs out.
+ */
+class KeyGenerationStage : public Benchmark::Stage
+{
+  public:
+    KeyGenerationStage(const std::vector<uint8_t> &poolData, TripcodeAlgorithm *tripcodeAlgorithm = NULL, MatchingAlgorithm *matchingAlgorithm = NULL) :
+      m_poolData(poolData), m_pool(NULL),
+      m_tripcodeAlgorithm(tripcodeAlgorithm), m_matchingAlgorithm(matchingAlgorithm)
+    {
+    }
+
+    ~KeyGenerationStage()
+    {
+      delete m_pool;
+    }
+
+    /**
+     * Returns the next block of keys, or NULL if a new copy of the pool
+     * has no keys.
+     */
+    KeyBlock *nextBlock()
+    {
+      for(int attempt = 0; attempt < 2; ++attempt)
+      {
+        if(m_pool == NULL)
+        {
+          m_pool = KeyspaceFactory::deserializeKeyspacePool(&m_poolData[0], m_poolData.size());
+          if(m_pool == NULL)
+            return NULL;
+          if(m_tripcodeAlgorithm != NULL)
+          {
+            m_pool->setOutputAlignment(m_tripcodeAlgorithm->inputAlignment());
+            m_pool->setOutputStride(m_tripcodeAlgorithm->inputStride());
+          }
+        }
+        KeyBlock *block = m_pool->getNextBlock();
+        if(block != NULL)
+          return block;
+        delete m_pool;
+        m_pool = NULL;
+      }
+      return NULL;
+    }
+
+    /**
+     * With algorithms given, this is the fused path of
+     * TripcodeCrawler::doSearch().
+     */
+    uint64_t run()
+    {
+      KeyBlock *block = nextBlock();
+      if(block == NULL)
+        return 0;
+      if(m_tripcodeAlgorithm != NULL)
+      {
+        m_tripcodeAlgorithm->computeTripcodes(block, &m_tripcodes);
+        m_matchingAlgorithm->matchTripcodes(&m_tripcodes, &m_matches);
+        m_tripcodes.clear();
+        m_matches.clear();
+      }
+      return block->numKeys();
+    }
+
+  private:
+    std::vector<uint8_t> m_poolData;
+    KeyspacePool *m_pool;
+    TripcodeAlgorithm *m_tripcodeAlgorithm;
+    MatchingAlgorithm *m_matchingAlgorithm;
+    TripcodeContainer m_tripcodes, m_matches;
+};
+
+/**
+ * Deserializes a pool and serializes it again, as pools are on their way
+ * between ranks.
+ */
+class SerializationStage : public Benchmark::Stage
+{
+  public:
+    SerializationStage(const std::vector<uint8_t> &poolData) : m_poolData(poolData)
+    {
+    }
+
+    uint64_t run()
+    {
+      KeyspacePool *pool = KeyspaceFactory::deserializeKeyspacePool(&m_poolData[0], m_poolData.size());
+      size_t size;
+      delete[] pool->serialize(&size);
+      delete pool;
+      return 1;
+    }
+
+  private:
+    std::vector<uint8_t> m_poolData;
+};
+
+/**
+ * Computes the tripcodes of a block of random printable keys.
+ */
+class TripcodeStage : public Benchmark::Stage
+{
+  public:
+    TripcodeStage(TripcodeAlgorithm *tripcodeAlgorithm) : m_tripcodeAlgorithm(tripcodeAlgorithm)
+    {
+      m_block.resize(BLOCK_KEYS, tripcodeAlgorithm->inputStride());
+      for(size_t i = 0; i < BLOCK_KEYS; ++i)
+      {
+        for(size_t j = 0; j < KeyBlock::KEY_SIZE; ++j)
+          m_block.key(i)[j] = '!' + nextRandom() % ('~' - '!' + 1);
+      }
+    }
+
+    uint64_t run()
+    {
+      m_tripcodeAlgorithm->computeTripcodes(&m_block, &m_tripcodes);
+      m_tripcodes.clear();
+      return BLOCK_KEYS;
+    }
+
+  private:
+    TripcodeAlgorithm *m_tripcodeAlgorithm;
+    KeyBlock m_block;
+    TripcodeContainer m_tripcodes;
+};
+
+/**
+ * Matches a container of random tripcodes.
+ */
+class MatchingStage : public Benchmark::Stage
+{
+  public:
+    MatchingStage(MatchingAlgorithm *matchingAlgorithm) : m_matchingAlgorithm(matchingAlgorithm)
+    {
+      static const char ALPHABET[] = "./0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz";
+      for(size_t i = 0; i < BLOCK_KEYS; ++i)
+      {
+        char tripcode[TripcodeContainer::TRIPCODE_SIZE + 1] = "";
+        char key[TripcodeContainer::KEY_SIZE + 1] = "";
+        for(size_t j = 0; j < TripcodeContainer::TRIPCODE_SIZE; ++j)
+          tripcode[j] = ALPHABET[nextRandom() % (sizeof(ALPHABET) - 1)];
+        for(size_t j = 0; j < TripcodeContainer::KEY_SIZE; ++j)
+          key[j] = ALPHABET[nextRandom() % (sizeof(ALPHABET) - 1)];
+        m_tripcodes.insert(tripcode, key);
+      }
+    }
+
+    uint64_t run()
+    {
+      m_matchingAlgorithm->matchTripcodes(&m_tripcodes, &m_matches);
+      m_matches.clear();
+      return BLOCK_KEYS;
+    }
+
+  private:
+    MatchingAlgorithm *m_matchingAlgorithm;
+    TripcodeContainer m_tripcodes, m_matches;
+};
+
+/**
+ * Writes the given text to a new temporary file, and returns its path, or
+ * an empty string on failure.
+ */
+static std::string writeTemporary(const std::string &text)
+{
+  const char *directory = getenv("TMPDIR");
+  std::string path = std::string(directory != NULL ? directory : "/tmp") + "/tripripper_bench.XXXXXX";
+  std::vector<char> name(path.begin(), path.end());
+  name.push_back('\0');
+  int file = mkstemp(&name[0]);
+  if(file < 0)
+    return "";
+  bool written = write(file, text.data(), text.size()) == static_cast<ssize_t>(text.size());
+  close(file);
+  if(!written)
+  {
+    unlink(&name[0]);
+    return "";
+  }
+  return &name[0];
+}
+
+int main(int argc, char **argv)
+{
+  bool quick = false, perfCounters = false;
+  std::string filter, savePath, baselinePath, pluginDirectory, matchString = "TripRipper";
+  double tolerance = 0.1;
+
+  while(1)
+  {
+    static struct option long_options[] = {
+      {"quick", no_argument, NULL, 'q'},
+      {"filter", required_argument, NULL, 'f'},
+      {"save", required_argument, NULL, 's'},
+      {"baseline", required_argument, NULL, 'b'},
+      {"tolerance", required_argument, NULL, 't'},
+      {"match", required_argument, NULL, 'm'},
+      {"perf-counters", no_argument, NULL, 'p'},
+      {"plugin-dir", required_argument, NULL, 'P'},
+      {"help", no_argument, NULL, 'h'},
+      {NULL, 0, NULL, 0}
+    };
+
+    char opt = getopt_long(argc, argv, "qf:s:b:t:m:pP:h", long_options, NULL);
+
+    if(opt == -1)
+      break;
+
+    switch(opt)
+    {
+      case 'q':
+        quick = true;
+        break;
+      case 'f':
+        filter = std::string(optarg);
+        break;
+      case 's':
+        savePath = std::string(optarg);
+        break;
+      case 'b':
+        baselinePath = std::string(optarg);
+        break;
+      case 't':
+        tolerance = strtod(optarg, NULL);
+        break;
+      case 'm':
+        matchString = std::string(optarg);
+        break;
+      case 'p':
+        perfCounters = true;
+        break;
+      case 'P':
+        pluginDirectory = std::string(optarg);
+        break;
+      case 'h':
+        USAGE(EXIT_SUCCESS);
+        break;
+      default:
+        USAGE(EXIT_FAILURE);
+        break;
+    };
+  }
+
+  StrategyFactory *factory = StrategyFactory::singleton();
+  if(!pluginDirectory.empty())
+    factory->loadPlugins(pluginDirectory);
+
+  // the wordlist and rules of the wordlist and mangling mappings
+  std::string words;
+  for(int i = 0; i < 100000; ++i)
+  {
+    size_t length = 4 + nextRandom() % 7;
+    for(size_t j = 0; j < length; ++j)
+      words += 'a' + nextRandom() % 26;
+    words += '\n';
+  }
+  std::string wordlistPath = writeTemporary(words);
+  std::string rulesPath = writeTemporary("l\nu\nc\n$1\n^!\nsa@\n");
+  if(wordlistPath.empty() || rulesPath.empty())
+  {
+    std::cerr << "Could not write temporary files" << std::endl;
+    return EXIT_FAILURE;
+  }
+  std::vector<std::pair<std::string, std::string> > mappings;
+  mappings.push_back(std::make_pair(std::string("linear"), std::string("linear")));
+  mappings.push_back(std::make_pair(std::string("mask"), std::string("mask:?a?a?a?a?a?a?a?a")));
+  mappings.push_back(std::make_pair(std::string("wordlist"), "wordlist:" + wordlistPath));
+  mappings.push_back(std::make_pair(std::string("mangle"), "mangle:" + rulesPath + ":wordlist:" + wordlistPath));
+
+  std::vector<std::string> tripcodeNames;
+  std::vector<std::string> matchingNames = factory->matchingAlgorithmNames();
+  std::vector<TripcodeAlgorithm*> tripcodeAlgorithms;
+  std::vector<MatchingAlgorithm*> matchingAlgorithms;
+  std::vector<std::string> allTripcodeNames = factory->tripcodeAlgorithmNames();
+  for(size_t i = 0; i < allTripcodeNames.size(); ++i)
+  {
+    TripcodeAlgorithm *tripcodeAlgorithm = factory->createTripcodeAlgorithm(allTripcodeNames[i]);
+    if(!tripcodeAlgorithm->selfTest())
+    {
+      std::cout << "Skipping " << allTripcodeNames[i] << ", which does not compute correct tripcodes" << std::endl;
+      delete tripcodeAlgorithm;
+      continue;
+    }
+    tripcodeNames.push_back(allTripcodeNames[i]);
+    tripcodeAlgorithms.push_back(tripcodeAlgorithm);
+  }
+  for(size_t i = 0; i < matchingNames.size(); ++i)
+  {
+    matchingAlgorithms.push_back(factory->createMatchingAlgorithm(matchingNames[i]));
+    matchingAlgorithms.back()->setMatchString(matchString);
+  }
+
+  std::cout << "CPU: " << EngineSelector::cpuSignature() << std::endl;
+  Benchmark benchmark(quick ? 0.02 : 0.1, quick ? 5 : 10);
+  PerfCounters counters;
+  if(perfCounters)
+  {
+    if(!counters.available())
+      std::cerr << "Hardware performance counters are unavailable" << std::endl;
+    benchmark.setPerfCounters(&counters);
+  }
+  // stage names are measured when they contain the filter
+#define SELECTED(name) ((name).find(filter) != std::string::npos)
+
+  for(size_t i = 0; i < mappings.size(); ++i)
+  {
+    std::vector<uint8_t> poolData = firstPool(mappings[i].second);
+    if(poolData.empty() || KeyGenerationStage(poolData).nextBlock() == NULL)
+    {
+      std::cout << "Skipping " << mappings[i].first << ", which generates no keys" << std::endl;
+      continue;
+    }
+    std::string name = "keys/" + mappings[i].first;
+    if(SELECTED(name))
+    {
+      KeyGenerationStage stage(poolData);
+      benchmark.measure(name, "keys", &stage);
+    }
+    name = "serialize/" + mappings[i].first;
+    if(SELECTED(name))
+    {
+      SerializationStage stage(poolData);
+      benchmark.measure(name, "pools", &stage);
+    }
+    for(size_t t = 0; t < tripcodeAlgorithms.size(); ++t)
+    {
+      for(size_t m = 0; m < matchingAlgorithms.size(); ++m)
+      {
+        name = "fused/" + mappings[i].first + "/" + tripcodeNames[t] + "/" + matchingNames[m];
+        if(SELECTED(name))
+        {
+          KeyGenerationStage stage(poolData, tripcodeAlgorithms[t], matchingAlgorithms[m]);
+          benchmark.measure(name, "keys", &stage);
+        }
+      }
+    }
+  }
+  for(size_t t = 0; t < tripcodeAlgorithms.size(); ++t)
+  {
+    std::string name = "tripcode/" + tripcodeNames[t];
+    if(SELECTED(name))
+    {
+      TripcodeStage stage(tripcodeAlgorithms[t]);
+      benchmark.measure(name, "keys", &stage);
+    }
+  }
+  for(size_t m = 0; m < matchingAlgorithms.size(); ++m)
+  {
+    std::string name = "match/" + matchingNames[m];
+    if(SELECTED(name))
+    {
+      MatchingStage stage(matchingAlgorithms[m]);
+      benchmark.measure(name, "tripcodes", &stage);
+    }
+  }
+#undef SELECTED
+
+  for(size_t i = 0; i < tripcodeAlgorithms.size(); ++i)
+    delete tripcodeAlgorithms[i];
+  for(size_t i = 0; i < matchingAlgorithms.size(); ++i)
+    delete matchingAlgorithms[i];
+  unlink(wordlistPath.c_str());
+  unlink(rulesPath.c_str());
+  // the index written next to the wordlist
+  unlink((wordlistPath + ".idx").c_str());
+
+  int status = EXIT_SUCCESS;
+  if(!savePath.empty() && !benchmark.save(savePath))
+    status = EXIT_FAILURE;
+  if(!baselinePath.empty() && !benchmark.compare(baselinePath, tolerance))
+    status = EXIT_FAILURE;
+  return status;
+}
@@ -0,0 +1,173 @@
+/*******************************************************************************
+ * Copyright 2012 Jonathan Glines <auntieNeo@gmail.com>                        *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ ******************************************************************************/
+
+#include <getopt.h>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include "dispatchSimulator.h"
+#include "keyspace.h"
+#include "keyspaceDispatcher.h"
+#include "strategyFactory.h"
+
+#define USAGE(status) do { \
+  fprintf(stderr, "Usage: tripripper_dispatch_sim [options]\n"); \
+  fprintf(stderr, "\n"); \
+  fprintf(stderr, "   Simulates a search by thousands of ranks against the root's keyspace\n"); \
+  fprintf(stderr, "   dispatcher on a single thread, and reports the throughput of the root,\n"); \
+  fprintf(stderr, "   the latency of leases and the imbalance at the end of the search. Fails\n"); \
+  fprintf(stderr, "   if the search cannot be completed.\n"); \
+  fprintf(stderr, "\n"); \
+  fprintf(stderr, "   Options\n"); \
+  fprintf(stderr, "   -q --quick\n"); \
+  fprintf(stderr, "      Simulate a small search, %d ranks searching %s at %g\n", QUICK_RANKS, QUICK_MAPPING, QUICK_RATE); \
+  fprintf(stderr, "      keys per second.\n"); \
+  fprintf(stderr, "   -n --ranks=[count]\n"); \
+  fprintf(stderr, "      The number of ranks requesting pools, 4096 by default.\n"); \
+  fprintf(stderr, "   -k --keyspace-mapping=[mapping]\n"); \
+  fprintf(stderr, "      The keyspace mapping to search, \"%s\" by default. See\n", DEFAULT_MAPPING); \
+  fprintf(stderr, "      \"tripripper --help\".\n"); \
+  fprintf(stderr, "   -r --rate=[keys]\n"); \
+  fprintf(stderr, "      The keys per second of a rank, 2e6 by default.\n"); \
+  fprintf(stderr, "   -v --spread=[fraction]\n"); \
+  fprintf(stderr, "      The rates of ranks vary by up to this fraction, 0.2 by default.\n"); \
+  fprintf(stderr, "   -s --stragglers=[fraction]\n"); \
+  fprintf(stderr, "      The fraction of ranks that search --slowdown times slower, 0.01 by\n"); \
+  fprintf(stderr, "      default.\n"); \
+  fprintf(stderr, "   -w --slowdown=[factor]\n"); \
+  fprintf(stderr, "      How many times slower stragglers search, 10 by default.\n"); \
+  fprintf(stderr, "   -l --latency=[seconds]\n"); \
+  fprintf(stderr, "      The one way latency of messages, 20e-6 by default.\n"); \
+  fprintf(stderr, "   -c --service-time=[seconds]\n"); \
+  fprintf(stderr, "      The time the root takes to answer a request, rather than the time\n"); \
+  fprintf(stderr, "      the dispatcher takes on this machine.\n"); \
+  fprintf(stderr, "   -L --lease-time=[seconds]\n"); \
+  fprintf(stderr, "      The target time of each lease, %g by default.\n", TripRipper::KeyspaceDispatcher::DEFAULT_LEASE_TIME); \
+  exit(status); \
+  } while (0)
+
+using namespace TripRipper;
+
+static const char *DEFAULT_MAPPING = "mask:?a?a?a?a?a?a";
+static const int QUICK_RANKS = 1000;
+static const char *QUICK_MAPPING = "mask:?a?a?a?a?a";
+static const double QUICK_RATE = 1e5;
+
+int main(int argc, char **argv)
+{
+  std::string mappingStrategy = DEFAULT_MAPPING;
+  DispatchSimulator::Config config;
+  config.ranks = 4096;
+  config.keysPerSecond = 2e6;
+  config.rateSpread = 0.2;
+  config.stragglers = 0.01;
+  config.slowdown = 10.0;
+  config.latency = 20e-6;
+  config.serviceTime = 0.0;
+  config.leaseTime = KeyspaceDispatcher::DEFAULT_LEASE_TIME;
+
+  while(1)
+  {
+    static struct option long_options[] = {
+      {"quick", no_argument, NULL, 'q'},
+      {"ranks", required_argument, NULL, 'n'},
+      {"keyspace-mapping", required_argument, NULL, 'k'},
+      {"rate", required_argument, NULL, 'r'},
+      {"spread", required_argument, NULL, 'v'},
+      {"stragglers", required_argument, NULL, 's'},
+      {"slowdown", required_argument, NULL, 'w'},
+      {"latency", required_argument, NULL, 'l'},
+      {"service-time", required_argument, NULL, 'c'},
+      {"lease-time", required_argument, NULL, 'L'},
+      {"help", no_argument, NULL, 'h'},
+      {NULL, 0, NULL, 0}
+    };
+
+    char opt = getopt_long(argc, argv, "qn:k:r:v:s:w:l:c:L:h", long_options, NULL);
+
+    if(opt == -1)
+      break;
+
+    switch(opt)
+    {
+      case 'q':
+        config.ranks = QUICK_RANKS;
+        mappingStrategy = QUICK_MAPPING;
+        config.keysPerSecond = QUICK_RATE;
+        break;
+      case 'n':
+        config.ranks = atoi(optarg);
+        if(config.ranks <= 0)
+          USAGE(EXIT_FAILURE);
+        break;
+      case 'k':
+        mappingStrategy = std::string(optarg);
+        break;
+      case 'r':
+        config.keysPerSecond = strtod(optarg, NULL);
+        if(config.keysPerSecond <= 0.0)
+          USAGE(EXIT_FAILURE);
+        break;
+      case 'v':
+        config.rateSpread = strtod(optarg, NULL);
+        if(config.rateSpread < 0.0 || config.rateSpread >= 1.0)
+          USAGE(EXIT_FAILURE);
+        break;
+      case 's':
+        config.stragglers = strtod(optarg, NULL);
+        break;
+      case 'w':
+        config.slowdown = strtod(optarg, NULL);
+        if(config.slowdown < 1.0)
+          USAGE(EXIT_FAILURE);
+        break;
+      case 'l':
+        config.latency = strtod(optarg, NULL);
+        break;
+      case 'c':
+        config.serviceTime = strtod(optarg, NULL);
+        break;
+      case 'L':
+        config.leaseTime = strtod(optarg, NULL);
+        if(config.leaseTime <= 0.0)
+          USAGE(EXIT_FAILURE);
+        break;
+      case 'h':
+        USAGE(EXIT_SUCCESS);
+        break;
+      default:
+        USAGE(EXIT_FAILURE);
+        break;
+    };
+  }
+
+  KeyspaceMapping *mapping = StrategyFactory::singleton()->createKeyspaceMapping(mappingStrategy);
+  if(mapping == NULL)
+    return EXIT_FAILURE;
+  DispatchSimulator simulator(mapping, config);
+  bool completed = simulator.run();
+  simulator.report();
+  if(!completed)
+    std::cerr << "The simulated search could not be completed" << std::endl;
+  delete mapping;
+  return completed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
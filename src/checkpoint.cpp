@@ -0,0 +1,323 @@
+/*******************************************************************************
+ * Copyright 2012 Jonathan Glines <auntieNeo@gmail.com>                        *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ ******************************************************************************/
+
+#include "checkpoint.h"
+#include "keyspace.h"
+#include "keyspaceFactory.h"
+#include "logger.h"
+#include "matchLog.h"
+#include "serialization.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace TripRipper
+{
+  const char Checkpoint::MAGIC[8] = { 'T', 'R', 'I', 'P', 'C', 'K', 'P', 'T' };
+  const double Checkpoint::SYNC_INTERVAL = 1.0;
+  const double Checkpoint::SNAPSHOT_INTERVAL = 300.0;
+  const uint64_t Checkpoint::CHECKSUM_BASIS;
+
+  /**
+   * 64 bit FNV-1a hash, used to detect torn or corrupted writes. Data that
+   * is hashed in parts continues from the hash of the parts before it.
+   */
+  uint64_t Checkpoint::checksum(const uint8_t *data, size_t size, uint64_t hash)
+  {
+    for(size_t i = 0; i < size; ++i)
+    {
+      hash ^= data[i];
+      hash *= 1099511628211ULL;
+    }
+    return hash;
+  }
+
+  /**
+   * Syncs the directory containing the file at path, so that a rename() into
+   * it survives a crash. Returns false if the directory could not be synced.
+   */
+  static bool syncDirectory(const std::string &path)
+  {
+    size_t slash = path.rfind('/');
+    std::string directory = "/";
+    if(slash == std::string::npos)
+      directory = ".";
+    else if(slash > 0)
+      directory = path.substr(0, slash);
+    int file = open(directory.c_str(), O_RDONLY | O_DIRECTORY);
+    if(file < 0)
+      return false;
+    bool synced = fsync(file) == 0;
+    close(file);
+    return synced;
+  }
+
+  /**
+   * The Checkpoint constructor opens the write-ahead log next to the snapshot
+   * file at path. Unless resume is true, the log of any previous search is
+   * discarded.
+   */
+  Checkpoint::Checkpoint(const std::string &path, bool resume) :
+    m_path(path),
+    m_logPath(path + ".wal"),
+    m_matchLog(NULL),
+    m_generation(0),
+    m_lastSync(0.0),
+    m_lastSnapshot(0.0),
+    m_logDirty(false)
+  {
+    int flags = O_WRONLY | O_CREAT | O_APPEND;
+    if(!resume)
+      flags |= O_TRUNC;
+    m_logFile = open(m_logPath.c_str(), flags, 0644);
+    if(m_logFile < 0)
+      Logger::error("Could not open checkpoint log %s: %s", m_logPath.c_str(), strerror(errno));
+  }
+
+  Checkpoint::~Checkpoint()
+  {
+    if(m_logFile >= 0)
+    {
+      if(m_logDirty)
+      {
+        if(m_matchLog != NULL)
+          m_matchLog->sync();
+        fdatasync(m_logFile);
+      }
+      close(m_logFile);
+    }
+  }
+
+  /**
+   * Loads the KeyspaceMapping from the snapshot file and replays the
+   * write-ahead log on top of it. The caller assumes ownership of the
+   * returned mapping. Returns NULL if there is no valid snapshot.
+   */
+  KeyspaceMapping *Checkpoint::resume()
+  {
+    int file = open(m_path.c_str(), O_RDONLY);
+    if(file < 0)
+    {
+      Logger::error("Could not open checkpoint %s: %s", m_path.c_str(), strerror(errno));
+      return NULL;
+    }
+    struct stat status;
+    if(fstat(file, &status) != 0 || static_cast<size_t>(status.st_size) < HEADER_SIZE)
+    {
+      Logger::error("Checkpoint %s is truncated", m_path.c_str());
+      close(file);
+      return NULL;
+    }
+    size_t fileSize = status.st_size;
+    void *map = mmap(NULL, fileSize, PROT_READ, MAP_PRIVATE, file, 0);
+    close(file);
+    if(map == MAP_FAILED)
+    {
+      Logger::error("Could not map checkpoint %s: %s", m_path.c_str(), strerror(errno));
+      return NULL;
+    }
+
+    const uint8_t *data = static_cast<const uint8_t*>(map);
+    uint64_t stateSize = readUint64(data + 24);
+    KeyspaceMapping *mapping = NULL;
+    if(memcmp(data, MAGIC, sizeof(MAGIC)) != 0 || readUint32(data + 8) != VERSION)
+      Logger::error("Checkpoint %s is not a checkpoint of this version", m_path.c_str());
+    else if(stateSize > fileSize - HEADER_SIZE || checksum(data + HEADER_SIZE, stateSize) != readUint64(data + 32))
+      Logger::error("Checkpoint %s is corrupt", m_path.c_str());
+    else
+    {
+      m_generation = readUint64(data + 16);
+      mapping = KeyspaceFactory::deserializeKeyspaceMapping(data + HEADER_SIZE, stateSize);
+    }
+    munmap(map, fileSize);
+
+    if(mapping != NULL)
+      replayLog(mapping);
+    return mapping;
+  }
+
+  /**
+   * Checks in each pool recorded in the write-ahead log since the snapshot
+   * was written. Reading stops at the first incomplete or corrupt record.
+   */
+  void Checkpoint::replayLog(KeyspaceMapping *mapping)
+  {
+    int file = open(m_logPath.c_str(), O_RDONLY);
+    if(file < 0)
+      return;
+    struct stat status;
+    if(fstat(file, &status) != 0 || status.st_size == 0)
+    {
+      close(file);
+      return;
+    }
+    size_t fileSize = status.st_size;
+    void *map = mmap(NULL, fileSize, PROT_READ, MAP_PRIVATE, file, 0);
+    close(file);
+    if(map == MAP_FAILED)
+      return;
+
+    const uint8_t *data = static_cast<const uint8_t*>(map);
+    size_t offset = 0;
+    while(fileSize - offset >= RECORD_HEADER_SIZE)
+    {
+      const uint8_t *record = data + offset;
+      uint32_t poolSize = readUint32(record);
+      if(poolSize > fileSize - offset - RECORD_HEADER_SIZE)
+        break;
+      const uint8_t *poolData = record + RECORD_HEADER_SIZE;
+      if(checksum(poolData, poolSize) != readUint64(record + 16))
+        break;
+      if(readUint64(record + 8) == m_generation)
+      {
+        KeyspacePool *pool = KeyspaceFactory::deserializeKeyspacePool(poolData, poolSize);
+        // the pools of the rest of the log are searched again
+        if(pool == NULL)
+          break;
+        mapping->checkinPool(pool);
+        delete pool;
+      }
+      offset += RECORD_HEADER_SIZE + poolSize;
+    }
+    munmap(map, fileSize);
+  }
+
+  /**
+   * Appends the given checked in pool to the write-ahead log. The log is
+   * synced if it has not been synced for SYNC_INTERVAL seconds.
+   */
+  void Checkpoint::logCheckin(const KeyspacePool *pool, double time)
+  {
+    if(m_logFile < 0)
+      return;
+
+    size_t poolSize;
+    uint8_t *poolData = pool->serialize(&poolSize);
+    size_t recordSize = RECORD_HEADER_SIZE + poolSize;
+    uint8_t *record = new uint8_t[recordSize];
+    writeUint32(record, static_cast<uint32_t>(poolSize));
+    writeUint32(record + 4, 0);
+    writeUint64(record + 8, m_generation);
+    writeUint64(record + 16, checksum(poolData, poolSize));
+    memcpy(record + RECORD_HEADER_SIZE, poolData, poolSize);
+    delete[] poolData;
+
+    // a single write keeps records whole, barring a crash
+    ssize_t written = write(m_logFile, record, recordSize);
+    delete[] record;
+    if(written != static_cast<ssize_t>(recordSize))
+    {
+      Logger::error("Could not write checkpoint log %s", m_logPath.c_str());
+      return;
+    }
+    m_logDirty = true;
+
+    if(time - m_lastSync >= SYNC_INTERVAL)
+    {
+      if(m_matchLog != NULL)
+        m_matchLog->sync();
+      fdatasync(m_logFile);
+      m_lastSync = time;
+      m_logDirty = false;
+    }
+  }
+
+  /**
+   * Writes a new snapshot of the given mapping and truncates the write-ahead
+   * log. Returns false if the snapshot could not be written, in which case
+   * the previous snapshot and log remain valid.
+   */
+  bool Checkpoint::snapshot(const KeyspaceMapping *mapping, double time)
+  {
+    // the matches of pools in the snapshot must not be lost
+    if(m_matchLog != NULL)
+      m_matchLog->sync();
+
+    size_t stateSize = mapping->serialSize();
+    size_t fileSize = HEADER_SIZE + stateSize;
+    std::string tempPath = m_path + ".tmp";
+
+    int file = open(tempPath.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if(file < 0)
+    {
+      Logger::error("Could not create checkpoint %s: %s", tempPath.c_str(), strerror(errno));
+      return false;
+    }
+    if(ftruncate(file, fileSize) != 0)
+    {
+      Logger::error("Could not resize checkpoint %s: %s", tempPath.c_str(), strerror(errno));
+      close(file);
+      return false;
+    }
+    void *map = mmap(NULL, fileSize, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+    if(map == MAP_FAILED)
+    {
+      Logger::error("Could not map checkpoint %s: %s", tempPath.c_str(), strerror(errno));
+      close(file);
+      return false;
+    }
+
+    uint8_t *data = static_cast<uint8_t*>(map);
+    bool done;
+    mapping->serialize(data + HEADER_SIZE, stateSize, done);
+    assert(done);
+    memcpy(data, MAGIC, sizeof(MAGIC));
+    writeUint32(data + 8, VERSION);
+    writeUint32(data + 12, 0);
+    writeUint64(data + 16, m_generation + 1);
+    writeUint64(data + 24, stateSize);
+    writeUint64(data + 32, checksum(data + HEADER_SIZE, stateSize));
+    bool synced = msync(map, fileSize, MS_SYNC) == 0 && fsync(file) == 0;
+    munmap(map, fileSize);
+    close(file);
+    if(!synced || rename(tempPath.c_str(), m_path.c_str()) != 0)
+    {
+      Logger::error("Could not write checkpoint %s: %s", m_path.c_str(), strerror(errno));
+      return false;
+    }
+
+    // records of the previous generation are now part of the snapshot, but
+    // the log must outlive the old snapshot until the rename is durable
+    ++m_generation;
+    if(!syncDirectory(m_path))
+      Logger::warning("Could not sync the directory of checkpoint %s: %s", m_path.c_str(), strerror(errno));
+    else if(m_logFile >= 0 && ftruncate(m_logFile, 0) == 0)
+      m_logDirty = false;
+    m_lastSnapshot = time;
+    m_lastSync = time;
+    return true;
+  }
+
+  /**
+   * Returns true if SNAPSHOT_INTERVAL seconds have passed since the last
+   * snapshot.
+   */
+  bool Checkpoint::snapshotDue(double time) const
+  {
+    return time - m_lastSnapshot >= SNAPSHOT_INTERVAL;
+  }
+}
@@ -0,0 +1,96 @@
+/*******************************************************************************
+ * Copyright 2012 Jonathan Glines <auntieNeo@gmail.com>                        *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ ******************************************************************************/
+
+#ifndef CHECKPOINT_H_
+#define CHECKPOINT_H_
+
+#include "common.h"
+
+namespace TripRipper
+{
+  class KeyspaceMapping;
+  class KeyspacePool;
+  class MatchLog;
+
+  /**
+   * The Checkpoint class persists the state of the root's KeyspaceMapping so
+   * that a search can be resumed after the job is stopped or preempted.
+   *
+   * The state is kept in two files. The snapshot file holds a header followed
+   * by the serialized KeyspaceMapping. Snapshots are written to a temporary
+   * file through a shared memory mapping, synced, and then renamed over the
+   * previous snapshot, so a crash never leaves a partially written snapshot
+   * behind. Between snapshots, each checked in pool is appended to a small
+   * write-ahead log next to the snapshot file, so check-ins are not lost when
+   * the root dies between snapshots. On resume, the snapshot is loaded and
+   * the log is replayed on top of it.
+   *
+   * Every log record is tagged with the generation of the snapshot it
+   * follows, and records of older generations are ignored, which makes it
+   * safe to crash between writing a snapshot and truncating the log. A torn
+   * record at the end of the log is detected by its checksum and discarded.
+   *
+   * The log is synced to disk at most once per SYNC_INTERVAL seconds, so a
+   * crash loses at most the check-ins of that interval, and the pools of lost
+   * check-ins and of leases in flight are searched again after resuming.
+   * The MatchLog given to setMatchLog() is synced before the log and before
+   * each snapshot, so that a check-in on disk never refers to matches that
+   * are not.
+   */
+  class Checkpoint
+  {
+    public:
+      Checkpoint(const std::string &path, bool resume);
+      ~Checkpoint();
+
+      const std::string &path() const { return m_path; }
+      void setMatchLog(MatchLog *matchLog) { m_matchLog = matchLog; }
+
+      KeyspaceMapping *resume();
+      void logCheckin(const KeyspacePool *pool, double time);
+      bool snapshot(const KeyspaceMapping *mapping, double time);
+      bool snapshotDue(double time) const;
+
+      static uint64_t checksum(const uint8_t *data, size_t size, uint64_t hash = CHECKSUM_BASIS);
+
+      static const double SYNC_INTERVAL;
+      static const double SNAPSHOT_INTERVAL;
+      static const uint64_t CHECKSUM_BASIS = 14695981039346656037ULL;
+
+    private:
+      static const char MAGIC[8];
+      static const uint32_t VERSION = 2;
+      static const size_t HEADER_SIZE = 8 + 4 + 4 + 8 + 8 + 8;
+      static const size_t RECORD_HEADER_SIZE = 4 + 4 + 8 + 8;
+
+      void replayLog(KeyspaceMapping *mapping);
+
+      std::string m_path, m_logPath;
+      int m_logFile;
+      MatchLog *m_matchLog;
+      uint64_t m_generation;
+      double m_lastSync, m_lastSnapshot;
+      bool m_logDirty;
+  };
+}
+
+#endif
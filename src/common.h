@@ -36,7 +36,8 @@ namespace TripRipper
     KEYSPACE_REQUEST = 1,
     KEYSPACE_RESPONSE,
     POOL_EXHAUSTED_RESULT,
-    TERMINATION_REQUEST
+    TERMINATION_REQUEST,
+    TERMINATION_NOTICE
   };
 
   const int ROOT_RANK = 0;
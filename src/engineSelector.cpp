@@ -0,0 +1,439 @@
+/*******************************************************************************
+ * Copyright 2012 Jonathan Glines <auntieNeo@gmail.com>                        *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ ******************************************************************************/
+
+#include "engineSelector.h"
+#include "keyspace.h"
+#include "logger.h"
+#include "matchingAlgorithm.h"
+#include "strategyFactory.h"
+#include "tripcodeAlgorithm.h"
+#include "tripcodeContainer.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <sstream>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__i386__) || defined(__x86_64__)
+#include <cpuid.h>
+#define TRIPRIPPER_HAVE_CPUID
+#endif
+
+namespace TripRipper
+{
+  const char EngineSelector::AUTO[] = "auto";
+  const double EngineSelector::BENCHMARK_TIME = 0.1;
+  const size_t EngineSelector::BENCHMARK_KEYS;
+
+  // the name of the cache file of the choices
+  static const char ENGINE_CACHE[] = "engine";
+
+  /**
+   * The CPU features that a tripcode algorithm needs, as a list of the names
+   * returned by cpuFeatures() separated by spaces. Algorithms that are not
+   * listed run anywhere.
+   */
+  struct Requirement
+  {
+    const char *algorithm;
+    const char *features;
+  };
+
+  static const Requirement REQUIREMENTS[] = {
+    { "openssl", "" }
+  };
+
+  /**
+   * Returns the names of the SIMD features of the CPU that are relevant to
+   * tripcode algorithms. Features that need operating system support, such as
+   * AVX, are only listed if the operating system saves their registers.
+   */
+  static std::vector<std::string> cpuFeatures()
+  {
+    std::vector<std::string> features;
+#ifdef TRIPRIPPER_HAVE_CPUID
+    unsigned int eax, ebx, ecx, edx;
+    if(!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+      return features;
+    if(edx & (1 << 26))
+      features.push_back("sse2");
+    if(ecx & (1 << 9))
+      features.push_back("ssse3");
+    if(ecx & (1 << 19))
+      features.push_back("sse4.1");
+    if(ecx & (1 << 20))
+      features.push_back("sse4.2");
+    if(ecx & (1 << 23))
+      features.push_back("popcnt");
+
+    uint64_t xcr0 = 0;
+    if(ecx & (1 << 27))
+    {
+      uint32_t low, high;
+      __asm__ __volatile__("xgetbv" : "=a"(low), "=d"(high) : "c"(0));
+      xcr0 = (static_cast<uint64_t>(high) << 32) | low;
+    }
+    bool avxState = (xcr0 & 0x06) == 0x06;
+    bool avx512State = (xcr0 & 0xe6) == 0xe6;
+    if((ecx & (1 << 28)) && avxState)
+      features.push_back("avx");
+    if(__get_cpuid_max(0, NULL) >= 7)
+    {
+      __cpuid_count(7, 0, eax, ebx, ecx, edx);
+      if((ebx & (1 << 5)) && avxState)
+        features.push_back("avx2");
+      if((ebx & (1 << 16)) && avx512State)
+        features.push_back("avx512f");
+    }
+#endif
+    return features;
+  }
+
+  /**
+   * Returns the brand string of the CPU, or "unknown".
+   */
+  static std::string cpuBrand()
+  {
+#ifdef TRIPRIPPER_HAVE_CPUID
+    if(__get_cpuid_max(0x80000000, NULL) >= 0x80000004)
+    {
+      unsigned int brand[12];
+      for(unsigned int i = 0; i < 3; ++i)
+        __get_cpuid(0x80000002 + i, &brand[4 * i], &brand[4 * i + 1], &brand[4 * i + 2], &brand[4 * i + 3]);
+      std::string result(reinterpret_cast<const char*>(brand), sizeof(brand));
+      result = result.substr(0, result.find('\0'));
+      size_t first = result.find_first_not_of(' ');
+      if(first != std::string::npos)
+        return result.substr(first, result.find_last_not_of(' ') - first + 1);
+    }
+#endif
+    return "unknown";
+  }
+
+  static double now()
+  {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec + time.tv_nsec * 1e-9;
+  }
+
+  /**
+   * Returns true if the CPU has the features that the given tripcode
+   * algorithm needs.
+   */
+  static bool eligible(const std::string &algorithm)
+  {
+    for(size_t i = 0; i < sizeof(REQUIREMENTS) / sizeof(REQUIREMENTS[0]); ++i)
+    {
+      if(algorithm != REQUIREMENTS[i].algorithm)
+        continue;
+      std::istringstream features(REQUIREMENTS[i].features);
+      std::string feature;
+      while(features >> feature)
+      {
+        if(!EngineSelector::cpuSupports(feature))
+          return false;
+      }
+    }
+    return true;
+  }
+
+  /**
+   * Returns true if the named tripcode algorithm exists and computes correct
+   * tripcodes.
+   */
+  static bool selfTests(const std::string &algorithm)
+  {
+    TripcodeAlgorithm *tripcode = StrategyFactory::singleton()->createTripcodeAlgorithm(algorithm);
+    bool correct = tripcode != NULL && tripcode->selfTest();
+    delete tripcode;
+    return correct;
+  }
+
+  /**
+   * Returns the given string in hexadecimal, or "-" if it is empty, so that
+   * any string can be part of the key of a cache entry.
+   */
+  static std::string hexEncode(const std::string &string)
+  {
+    static const char DIGITS[] = "0123456789abcdef";
+    if(string.empty())
+      return "-";
+    std::string hex;
+    for(size_t i = 0; i < string.size(); ++i)
+    {
+      unsigned char character = string[i];
+      hex += DIGITS[character >> 4];
+      hex += DIGITS[character & 0xf];
+    }
+    return hex;
+  }
+
+  /**
+   * The matchString is the string that is searched for, which is given to
+   * the matching algorithms being benchmarked.
+   */
+  EngineSelector::EngineSelector(const std::string &matchString) :
+    m_matchString(matchString)
+  {
+  }
+
+  EngineSelector::~EngineSelector()
+  {
+  }
+
+  /**
+   * Resolves the given strategy names, either of which may be AUTO, to the
+   * names of the fastest tripcode and matching algorithms on this host.
+   * Returns false if no combination could be run.
+   */
+  bool EngineSelector::select(const std::string &tripcodeStrategy, const std::string &matchingStrategy,
+      std::string *tripcodeAlgorithm, std::string *matchingAlgorithm)
+  {
+    std::vector<std::string> tripcodeAlgorithms, matchingAlgorithms;
+    if(tripcodeStrategy == AUTO)
+    {
+      std::vector<std::string> names = StrategyFactory::singleton()->tripcodeAlgorithmNames();
+      for(size_t i = 0; i < names.size(); ++i)
+      {
+        if(eligible(names[i]) && selfTests(names[i]))
+          tripcodeAlgorithms.push_back(names[i]);
+      }
+    }
+    else
+    {
+      tripcodeAlgorithms.push_back(tripcodeStrategy);
+    }
+    if(matchingStrategy == AUTO)
+      matchingAlgorithms = StrategyFactory::singleton()->matchingAlgorithmNames();
+    else
+      matchingAlgorithms.push_back(matchingStrategy);
+
+    // the value of the request is the chosen algorithms and their keys per
+    // second
+    std::string request = tripcodeStrategy + " " + matchingStrategy + " " + hexEncode(m_matchString), choice;
+    if(readCache(ENGINE_CACHE, request, &choice))
+    {
+      std::istringstream cached(choice);
+      if(cached >> *tripcodeAlgorithm >> *matchingAlgorithm &&
+          std::find(tripcodeAlgorithms.begin(), tripcodeAlgorithms.end(), *tripcodeAlgorithm) != tripcodeAlgorithms.end() &&
+          std::find(matchingAlgorithms.begin(), matchingAlgorithms.end(), *matchingAlgorithm) != matchingAlgorithms.end())
+        return true;
+    }
+
+    double bestRate = 0.0;
+    for(size_t t = 0; t < tripcodeAlgorithms.size(); ++t)
+    {
+      for(size_t m = 0; m < matchingAlgorithms.size(); ++m)
+      {
+        double rate = benchmark(tripcodeAlgorithms[t], matchingAlgorithms[m]);
+        if(rate > bestRate)
+        {
+          bestRate = rate;
+          *tripcodeAlgorithm = tripcodeAlgorithms[t];
+          *matchingAlgorithm = matchingAlgorithms[m];
+        }
+      }
+    }
+    if(bestRate <= 0.0)
+      return false;
+    std::ostringstream value;
+    value << *tripcodeAlgorithm << " " << *matchingAlgorithm << " " << static_cast<uint64_t>(bestRate);
+    writeCache(ENGINE_CACHE, request, value.str());
+    return true;
+  }
+
+  /**
+   * Runs the given combination of algorithms on random keys for
+   * BENCHMARK_TIME seconds, and returns the number of keys per second it
+   * went through. Returns 0 if either algorithm does not exist, or if the
+   * tripcode algorithm fails its selfTest().
+   */
+  double EngineSelector::benchmark(const std::string &tripcodeAlgorithm, const std::string &matchingAlgorithm) const
+  {
+    TripcodeAlgorithm *tripcode = StrategyFactory::singleton()->createTripcodeAlgorithm(tripcodeAlgorithm);
+    MatchingAlgorithm *matching = StrategyFactory::singleton()->createMatchingAlgorithm(matchingAlgorithm);
+    if(tripcode == NULL || matching == NULL || !tripcode->selfTest())
+    {
+      delete tripcode;
+      delete matching;
+      return 0.0;
+    }
+    matching->setMatchString(m_matchString);
+
+    KeyBlock block;
+    block.resize(BENCHMARK_KEYS, tripcode->inputStride());
+    uint32_t random = 0x2545f491;
+    for(size_t i = 0; i < BENCHMARK_KEYS; ++i)
+    {
+      for(size_t j = 0; j < KeyBlock::KEY_SIZE; ++j)
+      {
+        random = random * 1103515245 + 12345;
+        block.key(i)[j] = '!' + (random >> 16) % ('~' - '!' + 1);
+      }
+    }
+
+    TripcodeContainer tripcodes, matches;
+    // the first pass warms up caches and lazily initialized tables
+    tripcode->computeTripcodes(&block, &tripcodes);
+    matching->matchTripcodes(&tripcodes, &matches);
+    tripcodes.clear();
+    matches.clear();
+
+    uint64_t keys = 0;
+    double start = now(), elapsed;
+    do
+    {
+      tripcode->computeTripcodes(&block, &tripcodes);
+      matching->matchTripcodes(&tripcodes, &matches);
+      tripcodes.clear();
+      matches.clear();
+      keys += BENCHMARK_KEYS;
+      elapsed = now() - start;
+    } while(elapsed < BENCHMARK_TIME);
+
+    delete tripcode;
+    delete matching;
+    return keys / elapsed;
+  }
+
+  /**
+   * Returns a description of the CPU, namely its brand string and the
+   * features returned by cpuFeatures(), that changes whenever the choice of
+   * algorithms might.
+   */
+  std::string EngineSelector::cpuSignature()
+  {
+    std::string signature = cpuBrand() + " [";
+    std::vector<std::string> features = cpuFeatures();
+    for(size_t i = 0; i < features.size(); ++i)
+      signature += (i > 0 ? "," : "") + features[i];
+    return signature + "]";
+  }
+
+  /**
+   * Returns true if the CPU has the given feature, e.g. "avx2".
+   */
+  bool EngineSelector::cpuSupports(const std::string &feature)
+  {
+    std::vector<std::string> features = cpuFeatures();
+    return std::find(features.begin(), features.end(), feature) != features.end();
+  }
+
+  /**
+   * Returns the path of the cache file of this host with the given name,
+   * creating its directory if needed, or an empty string if there is nowhere
+   * to put it.
+   */
+  std::string EngineSelector::cachePath(const std::string &name)
+  {
+    std::string directory;
+    const char *cacheHome = getenv("XDG_CACHE_HOME");
+    const char *home = getenv("HOME");
+    if(cacheHome != NULL && cacheHome[0] != '\0')
+      directory = cacheHome;
+    else if(home != NULL && home[0] != '\0')
+    {
+      directory = std::string(home) + "/.cache";
+      mkdir(directory.c_str(), 0755);
+    }
+    else
+      return "";
+    directory += "/tripripper";
+    mkdir(directory.c_str(), 0755);
+
+    char host[256];
+    if(gethostname(host, sizeof(host)) != 0)
+      return "";
+    host[sizeof(host) - 1] = '\0';
+    return directory + "/" + name + "-" + host;
+  }
+
+  /**
+   * Cache files start with a line holding "cpu" and the CPU signature,
+   * followed by a line for each entry, which holds its key and its value
+   * separated by a space. Keys are made of a fixed number of words for each
+   * file. Reads the value of the given key from the named cache file, and
+   * returns false if there is none for this CPU.
+   */
+  bool EngineSelector::readCache(const std::string &name, const std::string &key, std::string *value)
+  {
+    std::string path = cachePath(name);
+    if(path.empty())
+      return false;
+    std::ifstream file(path.c_str());
+    std::string line;
+    if(!std::getline(file, line) || line != "cpu " + cpuSignature())
+      return false;
+    while(std::getline(file, line))
+    {
+      if(line.compare(0, key.size() + 1, key + " ") == 0)
+      {
+        *value = line.substr(key.size() + 1);
+        return true;
+      }
+    }
+    return false;
+  }
+
+  /**
+   * Stores the value of the given key in the named cache file, replacing any
+   * previous value. The file is replaced by renaming, since other processes
+   * on the host may be reading it.
+   */
+  void EngineSelector::writeCache(const std::string &name, const std::string &key, const std::string &value)
+  {
+    std::string path = cachePath(name);
+    if(path.empty())
+      return;
+    std::string signature = "cpu " + cpuSignature();
+    std::vector<std::string> lines;
+    std::ifstream previous(path.c_str());
+    std::string line;
+    if(std::getline(previous, line) && line == signature)
+    {
+      while(std::getline(previous, line))
+      {
+        if(line.compare(0, key.size() + 1, key + " ") != 0)
+          lines.push_back(line);
+      }
+    }
+    previous.close();
+
+    std::ostringstream tempPath;
+    tempPath << path << ".tmp" << getpid();
+    std::ofstream file(tempPath.str().c_str());
+    file << signature << "\n";
+    for(size_t i = 0; i < lines.size(); ++i)
+      file << lines[i] << "\n";
+    file << key << " " << value << "\n";
+    file.close();
+    if(!file || rename(tempPath.str().c_str(), path.c_str()) != 0)
+    {
+      Logger::warning("Could not write %s", path.c_str());
+      remove(tempPath.str().c_str());
+    }
+  }
+}
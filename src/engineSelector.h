@@ -0,0 +1,77 @@
+/*******************************************************************************
+ * Copyright 2012 Jonathan Glines <auntieNeo@gmail.com>                        *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ ******************************************************************************/
+
+#ifndef ENGINE_SELECTOR_H_
+#define ENGINE_SELECTOR_H_
+
+#include "common.h"
+
+namespace TripRipper
+{
+  /**
+   * The EngineSelector class picks the fastest combination of TripcodeAlgorithm
+   * and MatchingAlgorithm for the host it runs on, which is what the strategy
+   * name AUTO asks for.
+   *
+   * Every eligible combination is run on a synthetic KeyBlock of
+   * BENCHMARK_KEYS random keys for BENCHMARK_TIME seconds, and the one that
+   * goes through the most keys per second wins. A tripcode algorithm is
+   * eligible unless it needs CPU features that the host lacks, as detected
+   * with CPUID, or fails its TripcodeAlgorithm::selfTest().
+   *
+   * Since the benchmark delays the start of the search, the choice is cached
+   * in a small file per host under $XDG_CACHE_HOME/tripripper, or
+   * ~/.cache/tripripper, along with the CPU signature it was made for. The
+   * choice is cached per match string, since the cost of matching depends on
+   * it, and is used as long as the CPU signature matches and the chosen
+   * algorithms are still eligible. Other per host caches, such as the profiles of
+   * the Autotuner, share this mechanism.
+   */
+  class EngineSelector
+  {
+    public:
+      static const char AUTO[];
+      static const double BENCHMARK_TIME;
+      static const size_t BENCHMARK_KEYS = 4096;
+
+      EngineSelector(const std::string &matchString);
+      ~EngineSelector();
+
+      bool select(const std::string &tripcodeStrategy, const std::string &matchingStrategy,
+          std::string *tripcodeAlgorithm, std::string *matchingAlgorithm);
+
+      double benchmark(const std::string &tripcodeAlgorithm, const std::string &matchingAlgorithm) const;
+
+      static std::string cpuSignature();
+      static bool cpuSupports(const std::string &feature);
+
+      static std::string cachePath(const std::string &name);
+      static bool readCache(const std::string &name, const std::string &key, std::string *value);
+      static void writeCache(const std::string &name, const std::string &key, const std::string &value);
+
+    private:
+
+      std::string m_matchString;
+  };
+}
+
+#endif
@@ -0,0 +1,265 @@
+/*******************************************************************************
+ * Copyright 2012 Jonathan Glines <auntieNeo@gmail.com>                        *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ ******************************************************************************/
+
+#include "keyMask.h"
+#include "keyspace.h"
+
+#include <cstring>
+
+namespace TripRipper
+{
+  static const char LOWER[] = "abcdefghijklmnopqrstuvwxyz";
+  static const char UPPER[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+  static const char DIGITS[] = "0123456789";
+  static const char SYMBOLS[] = " !\"#$%&'()*+,-./:;<=>?@[\\]^_`{|}~";
+
+  KeyMask::KeyMask() :
+    m_minLength(0),
+    m_totalKeys(0)
+  {
+  }
+
+  KeyMask::~KeyMask()
+  {
+  }
+
+  /**
+   * Reads a range of key lengths followed by a colon from the front of spec,
+   * if there is one, and returns the number of characters read.
+   */
+  static size_t parseLengths(const std::string &spec, size_t *minLength, size_t *maxLength)
+  {
+    size_t i = 0;
+    size_t lengths[2] = { 0, 0 };
+    for(int n = 0; n < 2; ++n)
+    {
+      size_t start = i;
+      while(i < spec.size() && spec[i] >= '0' && spec[i] <= '9' && i - start < 2)
+        lengths[n] = lengths[n] * 10 + (spec[i++] - '0');
+      if(i == start || i >= spec.size())
+        return 0;
+      if(spec[i] == ':')
+      {
+        *minLength = lengths[0];
+        *maxLength = n == 0 ? lengths[0] : lengths[1];
+        return i + 1;
+      }
+      if(spec[i] != '-' || n == 1)
+        return 0;
+      ++i;
+    }
+    return 0;
+  }
+
+  /**
+   * Appends the characters of the class with the given name, the character
+   * after the question mark, to characters. Returns false if there is no
+   * such class.
+   */
+  static bool appendClass(char name, std::string *characters)
+  {
+    switch(name)
+    {
+      case 'l':
+        *characters += LOWER;
+        break;
+      case 'u':
+        *characters += UPPER;
+        break;
+      case 'd':
+        *characters += DIGITS;
+        break;
+      case 'h':
+        *characters += std::string(DIGITS) + "abcdef";
+        break;
+      case 'H':
+        *characters += std::string(DIGITS) + "ABCDEF";
+        break;
+      case 's':
+        *characters += SYMBOLS;
+        break;
+      case 'a':
+        *characters += std::string(LOWER) + UPPER + DIGITS + SYMBOLS;
+        break;
+      case 'k':
+        for(int c = 0xa1; c <= 0xdf; ++c)
+          *characters += static_cast<char>(c);
+        break;
+      case 'b':
+        for(int c = 0x01; c <= 0xff; ++c)
+          *characters += static_cast<char>(c);
+        break;
+      case '?':
+      case '[':
+      case ']':
+        *characters += name;
+        break;
+      default:
+        return false;
+    }
+    return true;
+  }
+
+  /**
+   * Returns the given characters allowed at the given position without
+   * repeated characters, and without the characters that give the same
+   * tripcodes as another of the characters.
+   *
+   * \sa KeyBlock::canonicalCharacter()
+   */
+  static std::string canonicalCharacters(size_t position, const std::string &characters)
+  {
+    bool allowed[256] = { false };
+    for(size_t i = 0; i < characters.size(); ++i)
+      allowed[static_cast<uint8_t>(characters[i])] = true;
+    bool added[256] = { false };
+    std::string result;
+    for(size_t i = 0; i < characters.size(); ++i)
+    {
+      uint8_t c = characters[i];
+      uint8_t canonical = KeyBlock::canonicalCharacter(position, c);
+      if(added[c] || (canonical != c && allowed[canonical]))
+        continue;
+      added[c] = true;
+      result += c;
+    }
+    return result;
+  }
+
+  /**
+   * Parses the given mask specification, which is described in the class
+   * documentation. Returns false if the specification is invalid, in which
+   * case the state of the mask is undefined.
+   */
+  bool KeyMask::parse(const std::string &spec)
+  {
+    m_spec = spec;
+    m_positions.clear();
+    m_keysOfLength.clear();
+    m_totalKeys = 0;
+
+    size_t minLength = 0, maxLength = 0;
+    size_t i = parseLengths(spec, &minLength, &maxLength);
+    for(; i < spec.size(); ++i)
+    {
+      std::string characters;
+      if(spec[i] == '[')
+      {
+        for(++i; i < spec.size() && spec[i] != ']'; ++i)
+        {
+          if(spec[i] != '?')
+            characters += spec[i];
+          else if(++i >= spec.size() || !appendClass(spec[i], &characters))
+            return false;
+        }
+        if(i >= spec.size() || characters.empty())
+          return false;
+      }
+      else if(spec[i] != '?')
+      {
+        characters = spec[i];
+      }
+      else if(++i >= spec.size() || !appendClass(spec[i], &characters))
+      {
+        return false;
+      }
+      m_positions.push_back(characters);
+    }
+
+    if(maxLength == 0)
+      minLength = maxLength = m_positions.size();
+    if(minLength == 0 || minLength > maxLength || maxLength > m_positions.size() || maxLength > KeyBlock::KEY_SIZE)
+      return false;
+    m_positions.resize(maxLength);
+    m_minLength = minLength;
+    for(size_t position = 0; position < maxLength; ++position)
+      m_positions[position] = canonicalCharacters(position, m_positions[position]);
+
+    m_keysOfLength.resize(maxLength + 1, 0);
+    uint64_t keys = 1;
+    for(size_t length = 1; length <= maxLength; ++length)
+    {
+      uint64_t radix = m_positions[length - 1].size();
+      if(keys > UINT64_MAX / radix)
+        return false;
+      keys *= radix;
+      if(length < minLength)
+        continue;
+      if(m_totalKeys > UINT64_MAX - keys)
+        return false;
+      m_keysOfLength[length] = keys;
+      m_totalKeys += keys;
+    }
+    return true;
+  }
+
+  /**
+   * Writes the key with the given index to key, which must hold
+   * KeyBlock::KEY_SIZE bytes, and returns the length of the key. The digit of
+   * each position is written to digits, which must also hold
+   * KeyBlock::KEY_SIZE elements, for use with nextKey().
+   */
+  size_t KeyMask::key(uint64_t index, uint8_t *key, size_t *digits) const
+  {
+    assert(index < m_totalKeys);
+    size_t length = m_minLength;
+    while(index >= m_keysOfLength[length])
+      index -= m_keysOfLength[length++];
+
+    memset(key, 0, KeyBlock::KEY_SIZE);
+    for(size_t position = length; position > 0; --position)
+    {
+      const std::string &characters = m_positions[position - 1];
+      digits[position - 1] = index % characters.size();
+      index /= characters.size();
+      key[position - 1] = characters[digits[position - 1]];
+    }
+    return length;
+  }
+
+  /**
+   * Advances key, of the given length, and digits to the key with the next
+   * index, which is much cheaper than calling key() for every index. Returns
+   * the length of the new key, or 0 if key was the last key.
+   */
+  size_t KeyMask::nextKey(size_t length, uint8_t *key, size_t *digits) const
+  {
+    for(size_t position = length; position > 0; --position)
+    {
+      const std::string &characters = m_positions[position - 1];
+      if(++digits[position - 1] < characters.size())
+      {
+        key[position - 1] = characters[digits[position - 1]];
+        return length;
+      }
+      digits[position - 1] = 0;
+      key[position - 1] = characters[0];
+    }
+
+    // every position wrapped around, so continue with longer keys
+    if(length == m_positions.size())
+      return 0;
+    digits[length] = 0;
+    key[length] = m_positions[length][0];
+    return length + 1;
+  }
+}
@@ -0,0 +1,99 @@
+/*******************************************************************************
+ * Copyright 2012 Jonathan Glines <auntieNeo@gmail.com>                        *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ ******************************************************************************/
+
+#ifndef KEY_MASK_H_
+#define KEY_MASK_H_
+
+#include "common.h"
+
+namespace TripRipper
+{
+  /**
+   * The KeyMask class describes a set of keys with a hashcat style mask,
+   * which gives the characters allowed at each position of the key. Each
+   * position is either a literal character or one of the character classes
+   * below.
+   *
+   * - ?l: abcdefghijklmnopqrstuvwxyz
+   * - ?u: ABCDEFGHIJKLMNOPQRSTUVWXYZ
+   * - ?d: 0123456789
+   * - ?h: 0123456789abcdef
+   * - ?H: 0123456789ABCDEF
+   * - ?s: the printable ASCII symbols, including space
+   * - ?a: ?l?u?d?s
+   * - ?k: the half-width katakana of Shift-JIS, 0xa1 to 0xdf
+   * - ?b: every byte except NUL, 0x01 to 0xff
+   * - ??: a literal question mark
+   *
+   * Positions may also be a set of classes and literal characters in
+   * brackets, such as "[?d?k]" or "[?l_-]". Literal brackets are written
+   * "?[" and "?]".
+   *
+   * The mask may be preceded by a range of key lengths and a colon, such as
+   * "6-8:?a?a?a?a?a?a?a?a", in which case the keys are the prefixes of the
+   * mask with lengths in that range. Without a range, all keys have the
+   * length of the mask. Since crypt(3) only looks at the first eight
+   * characters, masks are at most KeyBlock::KEY_SIZE positions long.
+   *
+   * Keys are numbered by mixed-radix arithmetic, where the radix of each
+   * position is the size of its character class. Keys of each length are
+   * numbered in turn, shortest first, and within a length the last position
+   * varies fastest. Every index below totalKeys() therefore maps to a distinct
+   * key that matches the mask.
+   *
+   * Characters with the high bit set are dropped from a position when the
+   * same character with the high bit cleared gives the same tripcode there
+   * and is also allowed at that position, so masks mixing ASCII and
+   * Shift-JIS characters do not search equivalent keys twice.
+   *
+   * \sa KeyBlock::canonicalCharacter()
+   */
+  class KeyMask
+  {
+    public:
+      KeyMask();
+      ~KeyMask();
+
+      bool parse(const std::string &spec);
+
+      /**
+       * Returns the specification that the mask was parsed from.
+       */
+      const std::string &spec() const { return m_spec; }
+      size_t minLength() const { return m_minLength; }
+      size_t maxLength() const { return m_positions.size(); }
+      uint64_t totalKeys() const { return m_totalKeys; }
+
+      size_t key(uint64_t index, uint8_t *key, size_t *digits) const;
+      size_t nextKey(size_t length, uint8_t *key, size_t *digits) const;
+
+    private:
+      std::vector<std::string> m_positions;
+      std::string m_spec;
+      size_t m_minLength;
+      uint64_t m_totalKeys;
+      // the number of keys of each length, indexed by length
+      std::vector<uint64_t> m_keysOfLength;
+  };
+}
+
+#endif
@@ -22,8 +22,12 @@
 
 #include "keyspace.h"
 
+#include <algorithm>
+
 namespace TripRipper
 {
+  const size_t KeyBlock::KEY_SIZE;
+
   KeyspaceMapping::KeyspaceMapping()
   {
   }
@@ -35,6 +39,21 @@ namespace TripRipper
   {
   }
 
+  KeyspacePool *KeyspaceMapping::checkoutPools(uint64_t /*poolCount*/)
+  {
+    return checkoutNextPool();
+  }
+
+  KeyspacePool *KeyspaceMapping::createPool(uint64_t /*firstPool*/, uint64_t /*poolCount*/)
+  {
+    return NULL;
+  }
+
+  PoolTracker *KeyspaceMapping::poolTracker()
+  {
+    return NULL;
+  }
+
   KeyspacePool::KeyspacePool()
   {
   }
@@ -42,4 +61,46 @@ namespace TripRipper
   KeyspacePool::~KeyspacePool()
   {
   }
+
+  KeyBlock::KeyBlock() :
+    m_numKeys(0), m_keyStride(KEY_SIZE)
+  {
+  }
+
+  KeyBlock::~KeyBlock()
+  {
+  }
+
+  /**
+   * Resizes the block to hold numKeys keys, each followed by stride spacer
+   * bytes. The contents of the block are undefined afterwards.
+   */
+  void KeyBlock::resize(size_t numKeys, size_t stride)
+  {
+    m_numKeys = numKeys;
+    m_keyStride = KEY_SIZE + stride;
+    m_data.resize(std::max(m_numKeys * m_keyStride, static_cast<size_t>(1)));
+  }
+
+  /**
+   * Returns the character with the high bit cleared if that character gives
+   * the same tripcode as the given character at the given position of a key,
+   * and the given character otherwise.
+   *
+   * crypt(3) only uses the low 7 bits of each character for the DES key, so
+   * a character with the high bit set only makes a difference where it
+   * changes the salt, which is taken from positions 1 and 2 of the key. The
+   * salt maps every character outside of '.' to 'z' to '.', so there the
+   * high bit only matters for characters whose low 7 bits are in '/' to
+   * 'z'. 0x80 is never replaced, since a NUL character would end the key.
+   */
+  uint8_t KeyBlock::canonicalCharacter(size_t position, uint8_t character)
+  {
+    uint8_t low = character & 0x7f;
+    if(character <= 0x80)
+      return character;
+    if((position == 1 || position == 2) && low >= '/' && low <= 'z')
+      return character;
+    return low;
+  }
 }
@@ -29,6 +29,7 @@ namespace TripRipper
 {
   class KeyspacePool;
   class KeyBlock;
+  class PoolTracker;
 
   /**
    * The KeyspaceMapping class is an abstract class that defines a mapping
@@ -50,7 +51,7 @@ namespace TripRipper
        * 
        * \sa KeyspacePool::Type, KeyspaceFactory::deserializeKeyspaceMapping()
        */
-      enum Type { LINEAR = 1 };
+      enum Type { LINEAR = 1, MASK, WORDLIST, MANGLE, SHARD };
 
       KeyspaceMapping();
       virtual ~KeyspaceMapping();
@@ -86,6 +87,46 @@ namespace TripRipper
        */
       virtual KeyspacePool *checkoutNextPool() = 0;
 
+      /**
+       * This method checks out up to poolCount pools as a single KeyspacePool
+       * object, which lets the root size each lease to the throughput of the
+       * rank that receives it without changing the granularity of the mapping
+       * itself. The number of pools actually checked out is given by
+       * KeyspacePool::poolCount() on the returned object, and may be smaller
+       * than poolCount. Returns NULL if there are no pools left to check out.
+       *
+       * The default implementation ignores poolCount and returns the result of
+       * checkoutNextPool(). Mappings that can cheaply coalesce adjacent pools
+       * should override this.
+       *
+       * \sa KeyspaceDispatcher
+       */
+      virtual KeyspacePool *checkoutPools(uint64_t poolCount);
+
+      /**
+       * This method constructs a pool covering poolCount pools starting at
+       * the pool with index firstPool, without checking them out. This is only
+       * possible for mappings in which a pool is fully determined by its
+       * index, and lets ranks construct pools for indices they have claimed
+       * from an AtomicPoolCounter without involving the root. The caller
+       * assumes ownership of the returned pool.
+       *
+       * The default implementation returns NULL, meaning that the mapping does
+       * not support this.
+       */
+      virtual KeyspacePool *createPool(uint64_t firstPool, uint64_t poolCount);
+
+      /**
+       * Returns the PoolTracker that keeps track of the searched pools of
+       * the mapping, for mappings whose pools are identified by an index. This
+       * lets the pools of a search be divided into shards that are searched
+       * separately and merged afterwards; see ShardKeyspace.
+       *
+       * The default implementation returns NULL, meaning that the mapping
+       * does not support this.
+       */
+      virtual PoolTracker *poolTracker();
+
       /**
        * The checkinPool() method marks the given pool as exhausted in the
        * KeyspaceMapping object. That way the KeyspaceMapping object knows that
@@ -99,6 +140,10 @@ namespace TripRipper
        * checked in by examining the object. Serialized and deserialized objects
        * should preserve the information needed to check in a pool.
        *
+       * Implementations must tolerate a pool being checked in more than once,
+       * or after it has been abandoned. This happens when a lease expires or
+       * is re-executed speculatively by the KeyspaceDispatcher.
+       *
        * \sa abandonPool()
        */
       virtual void checkinPool(KeyspacePool *) = 0;
@@ -111,12 +156,23 @@ namespace TripRipper
        */
       virtual void abandonPool(KeyspacePool *) = 0;
 
+      /**
+       * Returns the size in bytes of the serial representation written by
+       * serialize(). The first four bytes of the representation are the
+       * KeyspaceMapping::Type of the mapping in network byte order.
+       */
+      virtual size_t serialSize() const = 0;
+
       /**
        * Abstract method to serialize the entire KeyspaceMapping object so that
        * it can be  deserialized and searching of the keyspace can resume at a
        * later time. Implementations should assume that any currently checked
        * out pools are abandoned if they are still checked out at serialization
        * time.
+       *
+       * The size argument is the size of buffer in bytes. Implementations set
+       * done to true if the entire object was written, which is guaranteed if
+       * size is at least serialSize().
        */
       virtual void serialize(unsigned char *buffer, size_t size, bool &done) const = 0;
 
@@ -128,6 +184,9 @@ namespace TripRipper
        *
        * This method should not be called directly. You should call
        * KeyspaceFactory::deserializeKeyspaceMapping() instead.
+       *
+       * Implementations set done to true if a complete object was read from
+       * the size bytes in buffer.
        */
       virtual void deserialize(const unsigned char *buffer, size_t size, bool &done) = 0;
 
@@ -158,11 +217,31 @@ namespace TripRipper
        * 
        * \sa KeyspaceMapping::Type, KeyspaceFactory::deserializeKeyspacePool()
        */
-      enum Type { LINEAR = 1 };
+      enum Type { LINEAR = 1, MASK, WORDLIST, MANGLE };
 
       KeyspacePool();
       virtual ~KeyspacePool();
 
+      /**
+       * Returns the number of pools of the originating KeyspaceMapping that
+       * this object covers. This is 1 unless the pool was checked out with
+       * KeyspaceMapping::checkoutPools().
+       */
+      virtual uint64_t poolCount() { return 1; }
+
+      /**
+       * This method removes poolCount pools from the front of this pool and
+       * returns them as a new KeyspacePool object, which the caller assumes
+       * ownership of. This is how a node leader divides a large lease among
+       * the ranks on its node.
+       *
+       * Returns NULL if the pool cannot be split such that both parts are
+       * non-empty. The default implementation always returns NULL.
+       *
+       * \sa NodeDispatcher
+       */
+      virtual KeyspacePool *splitPool(uint64_t /*poolCount*/) { return NULL; }
+
       /**
        * This method returns the size in bytes of each block that the pool
        * returns. The block size must be a multiple of the value returned by
@@ -172,6 +251,16 @@ namespace TripRipper
        */
       virtual size_t blockSize() = 0;
 
+      /**
+       * This method sets the number of keys in each block that the pool
+       * returns, overriding the default of the implementing class, and is
+       * called before the first block is taken. A blockKeys of 0 restores the
+       * default. Pools with a fixed block size ignore it.
+       *
+       * \sa blockSize(), Autotuner
+       */
+      virtual void setBlockKeys(size_t /*blockKeys*/) {}
+
       /**
        * This method returns the address alignment of the output keys in bytes.
        *
@@ -211,7 +300,7 @@ namespace TripRipper
        *
        * \sa setOutputPackHighBit()
        */
-      virtual bool outputPackHighBit();
+      virtual bool outputPackHighBit() = 0;
 
       /**
        * This method sets whether or not to pack the high bits of the output
@@ -245,7 +334,9 @@ namespace TripRipper
     protected:
       /**
        * Read a KeyspacePool object from the serialized representation pointed
-       * to by buffer. The size argument is the size in bytes of buffer.
+       * to by buffer. The size argument is the size in bytes of buffer. The
+       * done argument is set to false if the representation describes a pool
+       * that cannot be constructed, such as one with an invalid mask.
        *
        * This method needs to be implemented by implementing classes, but should
        * never be called directly except by the KeyspaceFactory class. To
@@ -254,7 +345,7 @@ namespace TripRipper
        *
        * \sa serialize(), KeyspaceFactory::deserializeKeyspacePool()
        */
-      virtual void deserialize(const uint8_t *buffer, size_t size) = 0;
+      virtual void deserialize(const uint8_t *buffer, size_t size, bool &done) = 0;
   };
 
   /**
@@ -262,12 +353,37 @@ namespace TripRipper
    * packed in such a way to allow for efficient processing.
    *
    * A KeyBlock is a further division of the keyspace of a KeyspacePool.
+   *
+   * Keys are stored one after the other. Each key takes KEY_SIZE bytes, with
+   * shorter keys padded with zero bytes, and is followed by the spacer bytes
+   * set with KeyspacePool::setOutputStride(). The KeyspacePool that returns a
+   * KeyBlock owns it, and may reuse it for the next block.
    */
   class KeyBlock
   {
     public:
+      static const size_t KEY_SIZE = 8;
+
       KeyBlock();
       virtual ~KeyBlock();
+
+      size_t numKeys() const { return m_numKeys; }
+      /**
+       * Returns the distance in bytes between the first bytes of consecutive
+       * keys, which is KEY_SIZE plus the output stride of the pool.
+       */
+      size_t keyStride() const { return m_keyStride; }
+
+      const uint8_t *key(size_t index) const { return &m_data[index * m_keyStride]; }
+      uint8_t *key(size_t index) { return &m_data[index * m_keyStride]; }
+
+      void resize(size_t numKeys, size_t stride);
+
+      static uint8_t canonicalCharacter(size_t position, uint8_t character);
+
+    private:
+      std::vector<uint8_t> m_data;
+      size_t m_numKeys, m_keyStride;
   };
 }
 
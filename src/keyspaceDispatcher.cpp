@@ -0,0 +1,312 @@
+/*******************************************************************************
+ * Copyright 2012 Jonathan Glines <auntieNeo@gmail.com>                        *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ ******************************************************************************/
+
+#include "keyspaceDispatcher.h"
+#include "keyspace.h"
+#include "keyspaceFactory.h"
+
+#include <algorithm>
+#include <set>
+
+namespace TripRipper
+{
+  const double KeyspaceDispatcher::DEFAULT_LEASE_TIME = 10.0;
+  /// Weight given to the most recent lease in the exponentially weighted
+  /// moving average of each rank's throughput.
+  const double KeyspaceDispatcher::THROUGHPUT_SMOOTHING = 0.5;
+  /// A lease expires once it has taken this many times longer than expected
+  /// from the throughput of its rank...
+  const double KeyspaceDispatcher::LEASE_TIMEOUT_FACTOR = 4.0;
+  /// ...but never sooner than this many seconds after it was checked out.
+  const double KeyspaceDispatcher::MIN_LEASE_TIMEOUT = 60.0;
+  /// Timeout in seconds of leases given to ranks of unknown throughput.
+  const double KeyspaceDispatcher::PROBE_LEASE_TIMEOUT = 600.0;
+
+  /**
+   * The KeyspaceDispatcher constructor takes the mapping to dispatch pools
+   * from and the number of ranks that can request pools. The mapping is not
+   * owned by the dispatcher.
+   */
+  KeyspaceDispatcher::KeyspaceDispatcher(KeyspaceMapping *mapping, int numRanks) :
+    m_mapping(mapping),
+    m_numRanks(numRanks),
+    m_targetLeaseTime(DEFAULT_LEASE_TIME),
+    m_nextLeaseId(0)
+  {
+    assert(m_mapping != NULL);
+    assert(m_numRanks > 0);
+    m_ranks = new RankState[m_numRanks];
+    for(int i = 0; i < m_numRanks; ++i)
+    {
+      m_ranks[i].lease = NULL;
+      m_ranks[i].leaseId = 0;
+      m_ranks[i].leaseStart = 0.0;
+      m_ranks[i].leaseDeadline = 0.0;
+      m_ranks[i].throughput = 0.0;
+      m_ranks[i].speculative = false;
+      m_ranks[i].settled = false;
+    }
+  }
+
+  /**
+   * Any leases that are still outstanding are abandoned, so that they will be
+   * searched again if the mapping is serialized and resumed.
+   */
+  KeyspaceDispatcher::~KeyspaceDispatcher()
+  {
+    for(int i = 0; i < m_numRanks; ++i)
+      abandonLease(i);
+    delete[] m_ranks;
+  }
+
+  /**
+   * Checks out a new lease for the given rank, sized by leaseSize(). The rank
+   * must not already hold a lease. If the mapping has no unclaimed pools
+   * left, the rank is given a speculative copy of a straggling lease instead.
+   * The dispatcher retains ownership of the returned pool until the lease is
+   * checked in or abandoned. Returns NULL if there is nothing for the rank to
+   * do, which does not mean the search is finished; see finished().
+   */
+  KeyspacePool *KeyspaceDispatcher::checkoutLease(int rank, double time)
+  {
+    assert(rank >= 0 && rank < m_numRanks);
+    RankState &state = m_ranks[rank];
+    assert(state.lease == NULL);
+    state.lease = m_mapping->checkoutPools(leaseSize(rank));
+    if(state.lease == NULL)
+      return speculate(rank, time);
+    state.leaseId = m_nextLeaseId++;
+    state.leaseStart = time;
+    state.leaseDeadline = time + leaseTimeout(rank);
+    state.speculative = false;
+    state.settled = false;
+    return state.lease;
+  }
+
+  /**
+   * Checks in the lease held by the given rank, if any, and updates the
+   * throughput estimate for that rank from the time it took to exhaust the
+   * lease. Leases that have expired are still checked in, since their pools
+   * have been searched after all.
+   */
+  void KeyspaceDispatcher::checkinLease(int rank, double time)
+  {
+    assert(rank >= 0 && rank < m_numRanks);
+    RankState &state = m_ranks[rank];
+    if(state.lease == NULL)
+      return;
+
+    double elapsed = time - state.leaseStart;
+    if(elapsed > 0.0)
+    {
+      double keys = static_cast<double>(state.lease->poolCount()) * m_mapping->poolSize();
+      double rate = keys / elapsed;
+      if(state.throughput == 0.0)
+        state.throughput = rate;
+      else
+        state.throughput = THROUGHPUT_SMOOTHING * rate + (1.0 - THROUGHPUT_SMOOTHING) * state.throughput;
+    }
+
+    m_mapping->checkinPool(state.lease);
+    settleCopies(rank);
+    delete state.lease;
+    state.lease = NULL;
+  }
+
+  /**
+   * Returns the lease held by the given rank to the mapping's set of
+   * unsearched pools. Leases that have already been settled, and speculative
+   * copies of leases, are simply dropped, since their pools are either
+   * searched, back in the mapping, or still leased to another rank.
+   */
+  void KeyspaceDispatcher::abandonLease(int rank)
+  {
+    assert(rank >= 0 && rank < m_numRanks);
+    RankState &state = m_ranks[rank];
+    if(state.lease == NULL)
+      return;
+    if(!state.settled && !state.speculative)
+      m_mapping->abandonPool(state.lease);
+    delete state.lease;
+    state.lease = NULL;
+  }
+
+  /**
+   * Returns the pools of every unsettled lease whose deadline has passed to
+   * the mapping. The ranks holding those leases keep them, so that their
+   * results are still accepted if they eventually check them in. Returns the
+   * number of leases expired.
+   */
+  int KeyspaceDispatcher::expireLeases(double time)
+  {
+    int expired = 0;
+    for(int i = 0; i < m_numRanks; ++i)
+    {
+      RankState &state = m_ranks[i];
+      if(state.lease == NULL || state.settled || time < state.leaseDeadline)
+        continue;
+      if(!state.speculative)
+        m_mapping->abandonPool(state.lease);
+      state.settled = true;
+      ++expired;
+    }
+    return expired;
+  }
+
+  /**
+   * Returns true once every pool of the mapping has been checked in.
+   */
+  bool KeyspaceDispatcher::finished() const
+  {
+    return m_mapping->poolsLeft() == 0;
+  }
+
+  /**
+   * Gives the given rank a copy of the unsettled lease with the latest
+   * deadline that has not been copied yet, and returns the copy. Returns NULL
+   * if there is no such lease.
+   */
+  KeyspacePool *KeyspaceDispatcher::speculate(int rank, double time)
+  {
+    // leases that already have a copy are skipped
+    std::set<uint64_t> copied;
+    for(int i = 0; i < m_numRanks; ++i)
+    {
+      if(m_ranks[i].lease != NULL && m_ranks[i].speculative)
+        copied.insert(m_ranks[i].leaseId);
+    }
+
+    int straggler = -1;
+    for(int i = 0; i < m_numRanks; ++i)
+    {
+      const RankState &candidate = m_ranks[i];
+      if(i == rank || candidate.lease == NULL || candidate.settled || candidate.speculative)
+        continue;
+      if(copied.count(candidate.leaseId) > 0)
+        continue;
+      if(straggler < 0 || candidate.leaseDeadline > m_ranks[straggler].leaseDeadline)
+        straggler = i;
+    }
+    if(straggler < 0)
+      return NULL;
+
+    RankState &state = m_ranks[rank];
+    size_t poolDataSize;
+    uint8_t *poolData = m_ranks[straggler].lease->serialize(&poolDataSize);
+    state.lease = KeyspaceFactory::deserializeKeyspacePool(poolData, poolDataSize);
+    delete[] poolData;
+    if(state.lease == NULL)
+      return NULL;
+    state.leaseId = m_ranks[straggler].leaseId;
+    state.leaseStart = time;
+    state.leaseDeadline = time + leaseTimeout(rank);
+    state.speculative = true;
+    state.settled = false;
+    return state.lease;
+  }
+
+  /**
+   * Returns the number of seconds the current lease of the given rank has
+   * before it expires.
+   */
+  double KeyspaceDispatcher::leaseTimeout(int rank) const
+  {
+    const RankState &state = m_ranks[rank];
+    if(state.throughput == 0.0)
+      return PROBE_LEASE_TIMEOUT;
+    double keys = static_cast<double>(state.lease->poolCount()) * m_mapping->poolSize();
+    return std::max(LEASE_TIMEOUT_FACTOR * keys / state.throughput, MIN_LEASE_TIMEOUT);
+  }
+
+  /**
+   * Marks every other copy of the lease of the given rank as settled, after
+   * the lease has been checked in.
+   */
+  void KeyspaceDispatcher::settleCopies(int rank)
+  {
+    const RankState &state = m_ranks[rank];
+    for(int i = 0; i < m_numRanks; ++i)
+    {
+      if(i != rank && m_ranks[i].lease != NULL && m_ranks[i].leaseId == state.leaseId)
+        m_ranks[i].settled = true;
+    }
+  }
+
+  /**
+   * Returns the lease currently held by the given rank, or NULL.
+   */
+  KeyspacePool *KeyspaceDispatcher::lease(int rank) const
+  {
+    assert(rank >= 0 && rank < m_numRanks);
+    return m_ranks[rank].lease;
+  }
+
+  /**
+   * Returns the time at which the lease of the given rank expires.
+   */
+  double KeyspaceDispatcher::leaseDeadline(int rank) const
+  {
+    assert(rank >= 0 && rank < m_numRanks);
+    return m_ranks[rank].leaseDeadline;
+  }
+
+  /**
+   * Returns the number of pools the next lease for the given rank should
+   * cover. Ranks without a throughput estimate get a single pool, which
+   * serves as their probe.
+   *
+   * \sa guidedLeaseSize()
+   */
+  uint64_t KeyspaceDispatcher::leaseSize(int rank) const
+  {
+    assert(rank >= 0 && rank < m_numRanks);
+    return guidedLeaseSize(m_ranks[rank].throughput, m_targetLeaseTime, m_mapping->poolSize(), m_mapping->poolsLeft(), m_numRanks);
+  }
+
+  /**
+   * Returns the number of pools to lease to a rank with the given throughput
+   * in keys per second, such that the lease takes about leaseTime seconds,
+   * but never more than the guided share of the pools left,
+   * poolsLeft / (GUIDED_DIVISOR * numRanks). The lease is a single pool if
+   * the throughput is not yet known.
+   */
+  uint64_t KeyspaceDispatcher::guidedLeaseSize(double throughput, double leaseTime, size_t poolSize, uint64_t poolsLeft, int numRanks)
+  {
+    if(throughput <= 0.0)
+      return 1;
+
+    double target = throughput * leaseTime / poolSize;
+    uint64_t guided = poolsLeft / (static_cast<uint64_t>(GUIDED_DIVISOR) * numRanks);
+    uint64_t size = target < static_cast<double>(guided) ? static_cast<uint64_t>(target) : guided;
+    return std::max(size, static_cast<uint64_t>(1));
+  }
+
+  /**
+   * Returns the estimated throughput of the given rank in keys per second, or
+   * zero if the rank has not yet completed a lease.
+   */
+  double KeyspaceDispatcher::throughput(int rank) const
+  {
+    assert(rank >= 0 && rank < m_numRanks);
+    return m_ranks[rank].throughput;
+  }
+}
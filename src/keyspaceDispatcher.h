@@ -0,0 +1,121 @@
+/*******************************************************************************
+ * Copyright 2012 Jonathan Glines <auntieNeo@gmail.com>                        *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ ******************************************************************************/
+
+#ifndef KEYSPACE_DISPATCHER_H_
+#define KEYSPACE_DISPATCHER_H_
+
+#include "common.h"
+
+namespace TripRipper
+{
+  class KeyspaceMapping;
+  class KeyspacePool;
+
+  /**
+   * The KeyspaceDispatcher class decides how much of the keyspace the root
+   * process leases to each rank. It keeps track of the lease that each rank
+   * currently holds, and keeps an estimate of the throughput of each rank
+   * based on how long it took to exhaust its previous leases.
+   *
+   * Leases are sized so that each rank spends roughly targetLeaseTime()
+   * seconds on a lease, which keeps the number of messages the root has to
+   * handle independent of how fast a rank is. As the keyspace nears
+   * exhaustion, lease sizes shrink geometrically in the manner of OpenMP's
+   * guided scheduling, so that no single rank is left holding a large lease
+   * at the end of the search.
+   *
+   * Each lease is given a deadline based on the throughput of the rank that
+   * holds it. Leases that are not checked in by their deadline are expired by
+   * expireLeases(), which returns their pools to the mapping so that other
+   * ranks can search them. Once the mapping has no unclaimed pools left, idle
+   * ranks are given speculative copies of the outstanding lease with the
+   * latest deadline, and whichever copy is checked in first completes the
+   * pools. This keeps one slow or hung rank from holding up the end of the
+   * search. Both mechanisms rely on KeyspaceMapping::checkinPool() tolerating
+   * pools that are checked in more than once.
+   *
+   * KeyspaceDispatcher does not do any communication itself. Times are given
+   * by the caller, typically with MPI_Wtime().
+   */
+  class KeyspaceDispatcher
+  {
+    public:
+      KeyspaceDispatcher(KeyspaceMapping *mapping, int numRanks);
+      ~KeyspaceDispatcher();
+
+      /**
+       * The target amount of wall time in seconds that each lease should take
+       * to exhaust.
+       */
+      double targetLeaseTime() const { return m_targetLeaseTime; }
+      void setTargetLeaseTime(double seconds) { m_targetLeaseTime = seconds; }
+
+      KeyspacePool *checkoutLease(int rank, double time);
+      void checkinLease(int rank, double time);
+      void abandonLease(int rank);
+      int expireLeases(double time);
+      bool finished() const;
+
+      KeyspacePool *lease(int rank) const;
+      double leaseDeadline(int rank) const;
+      uint64_t leaseSize(int rank) const;
+      double throughput(int rank) const;
+
+      static uint64_t guidedLeaseSize(double throughput, double leaseTime, size_t poolSize, uint64_t poolsLeft, int numRanks);
+
+      static const double DEFAULT_LEASE_TIME;
+
+    private:
+      struct RankState
+      {
+        KeyspacePool *lease;
+        // identifies the lease, shared by speculative copies of a lease
+        uint64_t leaseId;
+        double leaseStart, leaseDeadline;
+        // estimated throughput in keys per second, or zero if unknown
+        double throughput;
+        // true if this rank holds a speculative copy of another rank's lease
+        bool speculative;
+        // true if the pools of the lease no longer depend on this rank,
+        // because the lease expired or another copy was checked in first
+        bool settled;
+      };
+
+      static const double THROUGHPUT_SMOOTHING;
+      static const double LEASE_TIMEOUT_FACTOR;
+      static const double MIN_LEASE_TIMEOUT;
+      static const double PROBE_LEASE_TIMEOUT;
+      static const int GUIDED_DIVISOR = 2;
+
+      KeyspacePool *speculate(int rank, double time);
+      double leaseTimeout(int rank) const;
+      void settleCopies(int rank);
+
+      KeyspaceMapping *m_mapping;
+      int m_numRanks;
+      double m_targetLeaseTime;
+      RankState *m_ranks;
+      uint64_t m_nextLeaseId;
+  };
+}
+
+#endif
@@ -23,6 +23,10 @@
 #include "keyspaceFactory.h"
 #include "keyspace.h"
 #include "linearKeyspace.h"
+#include "manglingKeyspace.h"
+#include "maskKeyspace.h"
+#include "shardKeyspace.h"
+#include "wordlistKeyspace.h"
 #include "common.h"
 
 #include <arpa/inet.h>
@@ -46,40 +50,97 @@ namespace TripRipper
   /**
    * The deserializeKeyspaceMapping method calls the appropriate
    * deserialization method for the given serialized data and returns a pointer
-   * to the deserialized object.
+   * to the deserialized object, or NULL if the mapping cannot be restored.
    *
    * The caller assumes ownership of the returned object.
    */
-  static KeyspaceMapping *deserializeKeyspaceMapping(const uint8_t *data, size_t size)
+  KeyspaceMapping *KeyspaceFactory::deserializeKeyspaceMapping(const uint8_t *data, size_t size)
   {
-    assert(size >= sizeof(const uint32_t));
+    if(size < sizeof(const uint32_t))
+      return NULL;
     uint32_t type = ntohl(*reinterpret_cast<const uint32_t*>(data));
     KeyspaceMapping *mapping = NULL;
-    switch(static
+    switch(static_cast<KeyspaceMapping::Type>(type))
+    {
+      case KeyspaceMapping::LINEAR:
+        mapping = new LinearKeyspace();
+        break;
+      case KeyspaceMapping::MASK:
+        mapping = new MaskKeyspace();
+        break;
+      case KeyspaceMapping::WORDLIST:
+        mapping = new WordlistKeyspace();
+        break;
+      case KeyspaceMapping::MANGLE:
+        mapping = new ManglingKeyspace();
+        break;
+      case KeyspaceMapping::SHARD:
+        mapping = new ShardKeyspace();
+        break;
+      default:
+        return NULL;
+    }
+    // the wordlist may have gone missing or changed, or the base mapping of
+    // a mangling or shard mapping may not be restorable
+    bool done;
+    mapping->deserialize(data, size, done);
+    if(!done)
+    {
+      delete mapping;
+      mapping = NULL;
+    }
+    return mapping;
   }
 
   /**
    * The deserializeKeyspacePool method calls the appropriate deserialization
    * method for the given serialized data and returns a pointer to the
-   * deserialized object.
+   * deserialized object, or NULL if the pool cannot be constructed.
    *
    * The caller assumes ownership of the returned object.
    */
   KeyspacePool *KeyspaceFactory::deserializeKeyspacePool(const uint8_t *data, size_t size)
   {
-    assert(size >= sizeof(const uint32_t));
-    uint32_t type = ntohl(*reinterpret_cast<const uint32_t*>(data));
+    return deserializeKeyspacePool(data, size, NULL);
+  }
+
+  /**
+   * Deserializes a pool like deserializeKeyspacePool() above, but into
+   * recycled if it is a pool of the same type, so that a rank searching one
+   * pool after another does not allocate a pool for each. Otherwise recycled
+   * is deleted. The factory takes ownership of recycled, which may be NULL.
+   */
+  KeyspacePool *KeyspaceFactory::deserializeKeyspacePool(const uint8_t *data, size_t size, KeyspacePool *recycled)
+  {
+    uint32_t type = size < sizeof(const uint32_t) ? 0 : ntohl(*reinterpret_cast<const uint32_t*>(data));
     KeyspacePool *pool = NULL;
     switch(static_cast<KeyspacePool::Type>(type))
     {
       case KeyspacePool::LINEAR:
-        {
-          pool = new LinearKeyspacePool();
-          pool->deserialize(data, size);
-        }
+        pool = dynamic_cast<LinearKeyspacePool*>(recycled) != NULL ? recycled : new LinearKeyspacePool();
+        break;
+      case KeyspacePool::MASK:
+        pool = dynamic_cast<MaskKeyspacePool*>(recycled) != NULL ? recycled : new MaskKeyspacePool();
+        break;
+      case KeyspacePool::WORDLIST:
+        pool = dynamic_cast<WordlistKeyspacePool*>(recycled) != NULL ? recycled : new WordlistKeyspacePool();
+        break;
+      case KeyspacePool::MANGLE:
+        pool = dynamic_cast<ManglingKeyspacePool*>(recycled) != NULL ? recycled : new ManglingKeyspacePool();
         break;
       default:
-        assert(false);
+        break;
+    }
+    if(pool != recycled)
+      delete recycled;
+    if(pool == NULL)
+      return NULL;
+    bool done;
+    pool->deserialize(data, size, done);
+    if(!done)
+    {
+      delete pool;
+      pool = NULL;
     }
     return pool;
   }
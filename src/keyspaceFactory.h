@@ -51,6 +51,7 @@ namespace TripRipper
 
       static KeyspaceMapping *deserializeKeyspaceMapping(const uint8_t *data, size_t size);
       static KeyspacePool *deserializeKeyspacePool(const uint8_t *data, size_t size);
+      static KeyspacePool *deserializeKeyspacePool(const uint8_t *data, size_t size, KeyspacePool *recycled);
   };
 }
 
@@ -21,10 +21,14 @@
  ******************************************************************************/
 
 #include "linearKeyspace.h"
+#include "serialization.h"
+
+#include <algorithm>
 
 namespace TripRipper
 {
-  LinearKeyspace::LinearKeyspace()
+  LinearKeyspace::LinearKeyspace() :
+    m_tracker(static_cast<uint64_t>(1) << (KEY_BITS - POOL_SIZE_BITS))
   {
   }
 
@@ -34,40 +38,187 @@ namespace TripRipper
 
   uint64_t LinearKeyspace::totalPools()
   {
-    // TODO
+    return m_tracker.totalPools();
   }
 
   uint64_t LinearKeyspace::poolsLeft()
   {
-    // TODO
+    return m_tracker.poolsLeft();
   }
 
   size_t LinearKeyspace::poolSize()
   {
-    // TODO
+    return static_cast<size_t>(1) << POOL_SIZE_BITS;
+  }
+
+  KeyspacePool *LinearKeyspace::checkoutNextPool()
+  {
+    return checkoutPools(1);
+  }
+
+  /**
+   * Pools are handed out in sequential order. Abandoned pools are handed out
+   * again before any pools after them.
+   */
+  KeyspacePool *LinearKeyspace::checkoutPools(uint64_t poolCount)
+  {
+    uint64_t firstPool, count;
+    if(!m_tracker.checkout(poolCount, &firstPool, &count))
+      return NULL;
+    return createPool(firstPool, count);
+  }
+
+  KeyspacePool *LinearKeyspace::createPool(uint64_t firstPool, uint64_t poolCount)
+  {
+    assert(poolCount > 0);
+    assert(firstPool < totalPools() && poolCount <= totalPools() - firstPool);
+    LinearKeyspacePool *pool = new LinearKeyspacePool(firstPool, poolCount);
+    pool->setOutputAlignment(outputAlignment());
+    pool->setOutputStride(outputStride());
+    return pool;
   }
 
-  KeyspacePool *LinearKeyspace::getNextPool()
+  void LinearKeyspace::checkinPool(KeyspacePool *pool)
   {
-    // TODO
+    LinearKeyspacePool *linearPool = dynamic_cast<LinearKeyspacePool*>(pool);
+    assert(linearPool != NULL);
+    m_tracker.checkin(linearPool->firstPool(), linearPool->poolCount());
   }
 
+  void LinearKeyspace::abandonPool(KeyspacePool *pool)
+  {
+    LinearKeyspacePool *linearPool = dynamic_cast<LinearKeyspacePool*>(pool);
+    assert(linearPool != NULL);
+    m_tracker.abandon(linearPool->firstPool(), linearPool->poolCount());
+  }
+
+  size_t LinearKeyspace::serialSize() const
+  {
+    return 4 + m_tracker.serialSize();
+  }
+
+  /**
+   * The serial representation of a LinearKeyspace is the
+   * KeyspaceMapping::LINEAR type followed by the serialized PoolTracker.
+   */
   void LinearKeyspace::serialize(unsigned char *buffer, size_t size, bool &done) const
   {
-    // TODO
+    done = false;
+    if(size < serialSize())
+      return;
+    writeUint32(buffer, KeyspaceMapping::LINEAR);
+    m_tracker.serialize(buffer + 4);
+    done = true;
   }
 
   void LinearKeyspace::deserialize(const unsigned char *buffer, size_t size, bool &done)
   {
-    // TODO
+    done = false;
+    if(size < 4 || readUint32(buffer) != KeyspaceMapping::LINEAR)
+      return;
+    assert(m_tracker.poolsCheckedOut() == 0);
+    if(m_tracker.deserialize(buffer + 4, size - 4) == 0)
+      return;
+    done = true;
   }
 
-  LinearKeyspacePool::LinearKeyspacePool(uint64_t identifier) :
-    KeyspacePool(identifier)
+  LinearKeyspacePool::LinearKeyspacePool() :
+    m_firstPool(0), m_poolCount(0),
+    m_blockKeys(BLOCK_KEYS),
+    m_outputAlignment(1), m_outputStride(0),
+    m_outputPackHighBit(false),
+    m_nextPool(0), m_nextKey(0)
+  {
+  }
+
+  LinearKeyspacePool::LinearKeyspacePool(uint64_t firstPool, uint64_t poolCount) :
+    m_firstPool(firstPool), m_poolCount(poolCount),
+    m_blockKeys(BLOCK_KEYS),
+    m_outputAlignment(1), m_outputStride(0),
+    m_outputPackHighBit(false),
+    m_nextPool(firstPool), m_nextKey(0)
   {
   }
 
   LinearKeyspacePool::~LinearKeyspacePool()
   {
   }
+
+  /**
+   * Pools can only be split before any blocks have been taken from them.
+   */
+  KeyspacePool *LinearKeyspacePool::splitPool(uint64_t poolCount)
+  {
+    if(poolCount == 0 || poolCount >= m_poolCount || m_nextPool != m_firstPool || m_nextKey != 0)
+      return NULL;
+    LinearKeyspacePool *pool = new LinearKeyspacePool(m_firstPool, poolCount);
+    pool->setBlockKeys(m_blockKeys);
+    pool->setOutputAlignment(m_outputAlignment);
+    pool->setOutputStride(m_outputStride);
+    pool->setOutputPackHighBit(m_outputPackHighBit);
+    m_firstPool += poolCount;
+    m_poolCount -= poolCount;
+    m_nextPool = m_firstPool;
+    return pool;
+  }
+
+  size_t LinearKeyspacePool::blockSize()
+  {
+    return m_blockKeys * (KeyBlock::KEY_SIZE + m_outputStride);
+  }
+
+  /**
+   * \todo Pack the high bits of the keys when outputPackHighBit() is set.
+   */
+  KeyBlock *LinearKeyspacePool::getNextBlock()
+  {
+    if(m_nextPool >= m_firstPool + m_poolCount)
+      return NULL;
+
+    // blocks do not cross the end of a pool
+    const uint64_t poolKeys = static_cast<uint64_t>(1) << LinearKeyspace::POOL_SIZE_BITS;
+    size_t numKeys = static_cast<size_t>(std::min(poolKeys - m_nextKey, static_cast<uint64_t>(m_blockKeys)));
+    uint64_t index = (m_nextPool << LinearKeyspace::POOL_SIZE_BITS) + m_nextKey;
+    m_block.resize(numKeys, m_outputStride);
+    for(size_t i = 0; i < numKeys; ++i, ++index)
+    {
+      uint8_t *key = m_block.key(i);
+      for(size_t j = 0; j < KeyBlock::KEY_SIZE; ++j)
+        key[j] = static_cast<uint8_t>(index >> (8 * j));
+    }
+    m_nextKey += numKeys;
+    if(m_nextKey == poolKeys)
+    {
+      ++m_nextPool;
+      m_nextKey = 0;
+    }
+    return &m_block;
+  }
+
+  /**
+   * The serial representation of a LinearKeyspacePool is the
+   * KeyspacePool::LINEAR type, followed by the first pool index and the number
+   * of pools, all in network byte order.
+   */
+  uint8_t *LinearKeyspacePool::serialize(size_t *size) const
+  {
+    uint8_t *buffer = new uint8_t[SERIAL_SIZE];
+    writeUint32(buffer, KeyspacePool::LINEAR);
+    writeUint64(buffer + 4, m_firstPool);
+    writeUint64(buffer + 12, m_poolCount);
+    *size = SERIAL_SIZE;
+    return buffer;
+  }
+
+  void LinearKeyspacePool::deserialize(const uint8_t *buffer, size_t size, bool &done)
+  {
+    done = false;
+    if(size < SERIAL_SIZE || readUint32(buffer) != KeyspacePool::LINEAR)
+      return;
+    m_firstPool = readUint64(buffer + 4);
+    m_poolCount = readUint64(buffer + 12);
+    m_nextPool = m_firstPool;
+    m_nextKey = 0;
+    done = true;
+  }
 }
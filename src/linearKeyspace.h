@@ -24,6 +24,7 @@
 #define LINEAR_KEYSPACE_H_
 
 #include "keyspace.h"
+#include "poolTracker.h"
 
 namespace TripRipper
 {
@@ -40,33 +41,94 @@ namespace TripRipper
   class LinearKeyspace : public KeyspaceMapping
   {
     public:
+      /**
+       * The number of keys in each pool of a LinearKeyspace, as a power of
+       * two.
+       */
+      static const int POOL_SIZE_BITS = 24;
+      /**
+       * The number of bits in each key of the keyspace. Every byte of the 8
+       * byte key is walked.
+       */
+      static const int KEY_BITS = 64;
+
       LinearKeyspace();
       ~LinearKeyspace();
 
       uint64_t totalPools();
       uint64_t poolsLeft();
       size_t poolSize();
-      KeyspacePool *getNextPool();
+      KeyspacePool *checkoutNextPool();
+      KeyspacePool *checkoutPools(uint64_t poolCount);
+      KeyspacePool *createPool(uint64_t firstPool, uint64_t poolCount);
+      void checkinPool(KeyspacePool *pool);
+      void abandonPool(KeyspacePool *pool);
+      PoolTracker *poolTracker() { return &m_tracker; }
 
+      size_t serialSize() const;
       void serialize(unsigned char *buffer, size_t size, bool &done) const;
       void deserialize(const unsigned char *buffer, size_t size, bool &done);
+
+    private:
+      PoolTracker m_tracker;
   };
 
   /**
    * The LinearKeyspacePool implements a KeyspacePool for LinearKeyspace. Keys
    * in this pool are from a single, contiguous portion of the keyspace.
+   *
+   * The key with a given index holds the bytes of the index, least
+   * significant byte first, so the first pools walk the shortest keys.
    */
   class LinearKeyspacePool : public KeyspacePool
   {
+    friend class LinearKeyspace;
+
     public:
-      LinearKeyspacePool(uint64_t identifier);
+      /**
+       * The number of keys in each KeyBlock, unless set otherwise with
+       * setBlockKeys().
+       */
+      static const size_t BLOCK_KEYS = 4096;
+
+      LinearKeyspacePool();
+      LinearKeyspacePool(uint64_t firstPool, uint64_t poolCount);
       ~LinearKeyspacePool();
 
-      uint64_t identifier()
+      /**
+       * Returns the index of the first pool covered by this object.
+       */
+      uint64_t firstPool() const { return m_firstPool; }
+      uint64_t poolCount() { return m_poolCount; }
+      KeyspacePool *splitPool(uint64_t poolCount);
+
+      size_t blockSize();
+      void setBlockKeys(size_t blockKeys) { m_blockKeys = blockKeys > 0 ? blockKeys : BLOCK_KEYS; }
+      size_t outputAlignment() { return m_outputAlignment; }
+      void setOutputAlignment(size_t alignment) { m_outputAlignment = alignment; }
+      size_t outputStride() { return m_outputStride; }
+      void setOutputStride(size_t stride) { m_outputStride = stride; }
+      bool outputPackHighBit() { return m_outputPackHighBit; }
+      void setOutputPackHighBit(bool packHighBit) { m_outputPackHighBit = packHighBit; }
+
+      KeyBlock *getNextBlock();
+
+      uint8_t *serialize(size_t *size) const;
+
+    protected:
+      void deserialize(const uint8_t *buffer, size_t size, bool &done);
+
+    private:
+      static const size_t SERIAL_SIZE = 4 + 8 + 8;
+
+      uint64_t m_firstPool, m_poolCount;
+      size_t m_blockKeys;
+      size_t m_outputAlignment, m_outputStride;
+      bool m_outputPackHighBit;
 
-      size_t blockSize() { return ; }
-      size_t blockAlignment() { return ; }
-      void setBlockAlignment(size_t alignment);
+      // the state of the iteration over the keys of the pool
+      KeyBlock m_block;
+      uint64_t m_nextPool, m_nextKey;
   };
 }
 
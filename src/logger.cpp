@@ -0,0 +1,300 @@
+/*******************************************************************************
+ * Copyright 2012 Jonathan Glines <auntieNeo@gmail.com>                        *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ ******************************************************************************/
+
+#include "logger.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <unistd.h>
+
+namespace TripRipper
+{
+  static const char *LEVEL_NAMES[Logger::NUM_LEVELS] = { "debug", "info", "warning", "error" };
+
+  Logger *Logger::singleton()
+  {
+    static Logger instance;
+    return &instance;
+  }
+
+  Logger::Logger() :
+    m_level(INFO),
+    m_rank(-1),
+    m_head(0),
+    m_tail(0),
+    m_dropped(0),
+    m_running(false),
+    m_stopping(false)
+  {
+    m_queue = new Message[QUEUE_MESSAGES];
+    for(size_t i = 0; i < QUEUE_MESSAGES; ++i)
+      m_queue[i].sequence = i;
+  }
+
+  Logger::~Logger()
+  {
+    stop();
+    delete[] m_queue;
+  }
+
+  const char *Logger::levelName(Level level)
+  {
+    return LEVEL_NAMES[level];
+  }
+
+  /**
+   * Sets level to the level of the given name, and returns false if there
+   * is no such level.
+   */
+  bool Logger::parseLevel(const std::string &name, Level *level)
+  {
+    for(int i = 0; i < NUM_LEVELS; ++i)
+    {
+      if(name == LEVEL_NAMES[i])
+      {
+        *level = static_cast<Level>(i);
+        return true;
+      }
+    }
+    return false;
+  }
+
+  /**
+   * Starts the thread that writes the messages, which are tagged with the
+   * given rank from then on. If the thread cannot be started, messages are
+   * still written by the threads that log them.
+   */
+  void Logger::start(int rank)
+  {
+    if(m_running)
+      return;
+    m_rank = rank;
+    m_stopping = false;
+    if(pthread_create(&m_thread, NULL, writerThread, this) != 0)
+    {
+      log(WARNING, "Could not start the logging thread: %s", strerror(errno));
+      return;
+    }
+    m_running = true;
+  }
+
+  /**
+   * Writes every message logged so far and stops the thread that writes
+   * them. The threads that log must have stopped logging.
+   */
+  void Logger::stop()
+  {
+    if(!m_running)
+      return;
+    m_stopping = true;
+    pthread_join(m_thread, NULL);
+    m_running = false;
+  }
+
+  /**
+   * Waits until every message logged before the call has been written.
+   */
+  void Logger::flush()
+  {
+    if(m_running)
+    {
+      uint64_t head = m_head;
+      while(static_cast<int64_t>(m_tail - head) < 0)
+        usleep(POLL_INTERVAL / 10);
+    }
+    fflush(stdout);
+    fflush(stderr);
+  }
+
+  void Logger::log(Level level, const char *format, ...)
+  {
+    va_list arguments;
+    va_start(arguments, format);
+    logv(level, format, arguments);
+    va_end(arguments);
+  }
+
+  void Logger::logv(Level level, const char *format, va_list arguments)
+  {
+    if(!enabled(level))
+      return;
+    if(!m_running)
+    {
+      char text[MESSAGE_SIZE];
+      vsnprintf(text, sizeof(text), format, arguments);
+      write(level, text);
+      fflush(level >= WARNING ? stderr : stdout);
+      return;
+    }
+
+    // claim the slot at the head, if the writer is done with it
+    uint64_t position = m_head;
+    Message *message;
+    while(true)
+    {
+      message = &m_queue[position % QUEUE_MESSAGES];
+      int64_t lag = static_cast<int64_t>(message->sequence - position);
+      if(lag == 0)
+      {
+        if(__sync_bool_compare_and_swap(&m_head, position, position + 1))
+          break;
+        position = m_head;
+      }
+      else if(lag < 0)
+      {
+        // the queue is full; only errors are worth waiting for
+        if(level < ERROR)
+        {
+          __sync_fetch_and_add(&m_dropped, 1);
+          return;
+        }
+        usleep(POLL_INTERVAL / 10);
+        position = m_head;
+      }
+      else
+      {
+        position = m_head;
+      }
+    }
+    message->level = level;
+    vsnprintf(message->text, MESSAGE_SIZE, format, arguments);
+    __sync_synchronize();
+    message->sequence = position + 1;
+
+    if(level >= ERROR)
+      flush();
+  }
+
+  void Logger::debug(const char *format, ...)
+  {
+    va_list arguments;
+    va_start(arguments, format);
+    singleton()->logv(DEBUG, format, arguments);
+    va_end(arguments);
+  }
+
+  void Logger::info(const char *format, ...)
+  {
+    va_list arguments;
+    va_start(arguments, format);
+    singleton()->logv(INFO, format, arguments);
+    va_end(arguments);
+  }
+
+  void Logger::warning(const char *format, ...)
+  {
+    va_list arguments;
+    va_start(arguments, format);
+    singleton()->logv(WARNING, format, arguments);
+    va_end(arguments);
+  }
+
+  void Logger::error(const char *format, ...)
+  {
+    va_list arguments;
+    va_start(arguments, format);
+    singleton()->logv(ERROR, format, arguments);
+    va_end(arguments);
+  }
+
+  /**
+   * The main loop of the thread that writes the messages. It sleeps for
+   * POLL_INTERVAL whenever the queue is empty, so that logging a message
+   * never needs to wake it.
+   */
+  void *Logger::writerThread(void *argument)
+  {
+    Logger *logger = static_cast<Logger*>(argument);
+    uint64_t reported = 0;
+    while(true)
+    {
+      bool stopping = logger->m_stopping;
+      bool wrote = false;
+      while(logger->writeNext())
+        wrote = true;
+      uint64_t dropped = logger->m_dropped;
+      if(dropped > reported)
+      {
+        char text[64];
+        snprintf(text, sizeof(text), "%llu log messages were dropped", static_cast<unsigned long long>(dropped - reported));
+        logger->write(WARNING, text);
+        reported = dropped;
+        wrote = true;
+      }
+      if(wrote)
+      {
+        fflush(stdout);
+        fflush(stderr);
+      }
+      // the queue was emptied after the stop was requested
+      if(stopping)
+        break;
+      if(!wrote)
+        usleep(POLL_INTERVAL);
+    }
+    return NULL;
+  }
+
+  /**
+   * Writes the message at the tail of the queue, if it has been logged, and
+   * returns false otherwise. Only the writer thread calls this.
+   */
+  bool Logger::writeNext()
+  {
+    Message *message = &m_queue[m_tail % QUEUE_MESSAGES];
+    if(message->sequence != m_tail + 1)
+      return false;
+    __sync_synchronize();
+    write(message->level, message->text);
+    __sync_synchronize();
+    message->sequence = m_tail + QUEUE_MESSAGES;
+    m_tail = m_tail + 1;
+    return true;
+  }
+
+  /**
+   * Writes each line of the given text, prefixed with the rank and, unless
+   * it is info, the level, once the rank is known.
+   */
+  void Logger::write(Level level, const char *text)
+  {
+    FILE *out = level >= WARNING ? stderr : stdout;
+    char prefix[32] = "";
+    if(m_rank >= 0)
+    {
+      if(level == INFO)
+        snprintf(prefix, sizeof(prefix), "[%d] ", m_rank);
+      else
+        snprintf(prefix, sizeof(prefix), "[%d] %s: ", m_rank, LEVEL_NAMES[level]);
+    }
+    while(*text != '\0')
+    {
+      const char *end = strchr(text, '\n');
+      size_t length = end != NULL ? static_cast<size_t>(end - text) : strlen(text);
+      fprintf(out, "%s%.*s\n", prefix, static_cast<int>(length), text);
+      text += length;
+      if(*text == '\n')
+        ++text;
+    }
+  }
+}
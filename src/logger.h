@@ -0,0 +1,113 @@
+/*******************************************************************************
+ * Copyright 2012 Jonathan Glines <auntieNeo@gmail.com>                        *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ ******************************************************************************/
+
+#ifndef LOGGER_H_
+#define LOGGER_H_
+
+#include "common.h"
+
+#include <cstdarg>
+#include <pthread.h>
+
+#define TRIPRIPPER_PRINTF(formatIndex, firstArgument) __attribute__((format(printf, formatIndex, firstArgument)))
+
+namespace TripRipper
+{
+  /**
+   * The Logger class prints the messages of TripRipper, tagged with the rank
+   * that logged them, without making the thread that logs wait for the
+   * output, so that the root's dispatch loop and the searching threads are
+   * not stalled by a slow terminal or file system.
+   *
+   * Messages are formatted with printf style formats into a fixed size slot
+   * of a bounded ring buffer of QUEUE_MESSAGES messages, which any thread
+   * may add to without a lock or an allocation. A thread started by start()
+   * takes the messages out, prefixes each line with the rank and level, and
+   * writes them: debug and info messages to stdout, warnings and errors to
+   * stderr. If the buffer is full, the message is dropped rather than
+   * waited for, and the number dropped is printed later. Messages longer
+   * than MESSAGE_SIZE are truncated.
+   *
+   * Errors usually precede MPI_Abort(), so logging one waits until every
+   * message before it has been written. Messages below level() cost a
+   * comparison. Until start() is called, and after stop(), messages are
+   * written by the thread that logs them; before start() the rank is not
+   * known, so they have no prefix.
+   */
+  class Logger
+  {
+    public:
+      enum Level { DEBUG, INFO, WARNING, ERROR, NUM_LEVELS };
+
+      static const size_t MESSAGE_SIZE = 1024;
+      static const size_t QUEUE_MESSAGES = 1024;
+      static const unsigned int POLL_INTERVAL = 1000;  // microseconds
+
+      static Logger *singleton();
+
+      static const char *levelName(Level level);
+      static bool parseLevel(const std::string &name, Level *level);
+
+      Level level() const { return m_level; }
+      void setLevel(Level level) { m_level = level; }
+      bool enabled(Level level) const { return level >= m_level; }
+
+      void start(int rank);
+      void stop();
+      void flush();
+
+      void log(Level level, const char *format, ...) TRIPRIPPER_PRINTF(3, 4);
+      void logv(Level level, const char *format, va_list arguments);
+
+      static void debug(const char *format, ...) TRIPRIPPER_PRINTF(1, 2);
+      static void info(const char *format, ...) TRIPRIPPER_PRINTF(1, 2);
+      static void warning(const char *format, ...) TRIPRIPPER_PRINTF(1, 2);
+      static void error(const char *format, ...) TRIPRIPPER_PRINTF(1, 2);
+
+    private:
+      struct Message
+      {
+        volatile uint64_t sequence;
+        Level level;
+        char text[MESSAGE_SIZE];
+      };
+
+      Logger();
+      ~Logger();
+
+      static void *writerThread(void *logger);
+      bool writeNext();
+      void write(Level level, const char *text);
+
+      Level m_level;
+      int m_rank;
+      Message *m_queue;
+      // the next message to add and the next to write; each message's
+      // sequence tells whether it has been added or written
+      volatile uint64_t m_head, m_tail;
+      volatile uint64_t m_dropped;
+      volatile bool m_running, m_stopping;
+      pthread_t m_thread;
+  };
+}
+
+#endif
@@ -25,6 +25,14 @@
 #include <cstdlib>
 #include <iostream>
 #include "tripcodeCrawler.h"
+#include "matchLog.h"
+#include "checkpoint.h"
+#include "engineSelector.h"
+#include "keyspace.h"
+#include "logger.h"
+#include "shardKeyspace.h"
+#include "strategyFactory.h"
+#include "telemetry.h"
 
 #define USAGE(status) do { \
   fprintf(stderr, "Usage: tripripper [mpi_arguments] [options] search_string\n\n"); \
@@ -32,15 +40,96 @@
   fprintf(stderr, "   -k --keyspace-mapping=[mapping]\n"); \
   fprintf(stderr, "      The keyspace mapping determines which keys in the keyspace will be\n"); \
   fprintf(stderr, "      searched, and in what order.\n"); \
+  fprintf(stderr, "      \"linear\" walks every 8 byte key. \"mask:[mask]\" only walks the keys\n"); \
+  fprintf(stderr, "      matching a hashcat style mask of ?l, ?u, ?d, ?h, ?H, ?s, ?a, ?k (Shift-JIS\n"); \
+  fprintf(stderr, "      katakana), ?b (any byte), sets such as [?d?k] and literal characters,\n"); \
+  fprintf(stderr, "      e.g. \"mask:?u?l?l?l?d?d\". The mask may be preceded by a range of key\n"); \
+  fprintf(stderr, "      lengths, e.g. \"mask:6-8:?a?a?a?a?a?a?a?a\". Keys that give the same\n"); \
+  fprintf(stderr, "      tripcode as another key of the mask are skipped.\n"); \
+  fprintf(stderr, "      \"wordlist:[file]\" walks the lines of the given file, which every rank\n"); \
+  fprintf(stderr, "      must be able to read.\n"); \
+  fprintf(stderr, "      \"mangle:[rules]:[mapping]\" applies each hashcat style rule in the file\n"); \
+  fprintf(stderr, "      rules to each key of another mapping that supports \"atomic\" dispatch,\n"); \
+  fprintf(stderr, "      e.g. \"mangle:rules.txt:wordlist:words.txt\".\n"); \
   fprintf(stderr, "   -t --tripcode-algorithm=[algorithm]\n"); \
   fprintf(stderr, "      The algorithm that computes the tripcodes. There are a variety of tripcode\n"); \
   fprintf(stderr, "      algorithms available, depending on the hardware, each with different\n"); \
-  fprintf(stderr, "      performance characteristics.\n"); \
+  fprintf(stderr, "      performance characteristics. With \"auto\", the default, each node\n"); \
+  fprintf(stderr, "      benchmarks the algorithms its CPU supports and uses the fastest; the\n"); \
+  fprintf(stderr, "      choice is cached in ~/.cache/tripripper for each search string until\n"); \
+  fprintf(stderr, "      the CPU changes.\n"); \
+  fprintf(stderr, "   -m --matching-algorithm=[algorithm]\n"); \
+  fprintf(stderr, "      The algorithm that compares tripcodes to the search string. \"auto\",\n"); \
+  fprintf(stderr, "      the default, is chosen along with the tripcode algorithm.\n"); \
+  fprintf(stderr, "   -P --plugin-dir=[directory]\n"); \
+  fprintf(stderr, "      Load additional tripcode and matching algorithms from the plugins in\n"); \
+  fprintf(stderr, "      the given directory that the CPU of each node supports, rather than\n"); \
+  fprintf(stderr, "      from the \"plugins\" directory next to the executable. Only available\n"); \
+  fprintf(stderr, "      when built with TRIPRIPPER_PLUGINS.\n"); \
+  fprintf(stderr, "   -p --perf-counters\n"); \
+  fprintf(stderr, "      Count cycles, instructions, cache misses and branch misses of the\n"); \
+  fprintf(stderr, "      tripcode and matching algorithms on each rank with perf_event_open(2),\n"); \
+  fprintf(stderr, "      and print them per key when the search is over.\n"); \
+  fprintf(stderr, "   -u --tune\n"); \
+  fprintf(stderr, "      Measure the number of keys per block at which the algorithms search\n"); \
+  fprintf(stderr, "      the keyspace mapping fastest on each node, without searching. The\n"); \
+  fprintf(stderr, "      result is stored in ~/.cache/tripripper, and later searches with the\n"); \
+  fprintf(stderr, "      same algorithms and mapping use it.\n"); \
+  fprintf(stderr, "   -d --dispatch=[root|node|atomic]\n"); \
+  fprintf(stderr, "      How ranks obtain portions of the keyspace. With \"root\", the default,\n"); \
+  fprintf(stderr, "      every rank requests pools from the root. With \"node\", a leader on each\n"); \
+  fprintf(stderr, "      node leases large pools from the root and divides them among the other\n"); \
+  fprintf(stderr, "      ranks on the node. With \"atomic\", ranks claim pools from a counter on\n"); \
+  fprintf(stderr, "      the root with MPI one-sided atomics; only some keyspace mappings support\n"); \
+  fprintf(stderr, "      this, and the search cannot be checkpointed.\n"); \
+  fprintf(stderr, "   -H --hierarchical\n"); \
+  fprintf(stderr, "      Same as --dispatch=node.\n"); \
+  fprintf(stderr, "   -c --checkpoint=[file]\n"); \
+  fprintf(stderr, "      Periodically save the progress of the search to the given file, and\n"); \
+  fprintf(stderr, "      save it when any rank receives SIGTERM.\n"); \
+  fprintf(stderr, "   -r --resume\n"); \
+  fprintf(stderr, "      Resume the search saved in the file given with --checkpoint.\n"); \
+  fprintf(stderr, "   -o --match-log=[file]\n"); \
+  fprintf(stderr, "      Append matches to the given file rather than printing them, and index\n"); \
+  fprintf(stderr, "      the file by tripcode when the search is over.\n"); \
+  fprintf(stderr, "   -L --lookup=[tripcode]\n"); \
+  fprintf(stderr, "      Print the matches of the given tripcode in the file given with\n"); \
+  fprintf(stderr, "      --match-log, without searching.\n"); \
+  fprintf(stderr, "   -n --max-matches=[count]\n"); \
+  fprintf(stderr, "      Stop the search once at least the given number of matches have been\n"); \
+  fprintf(stderr, "      found.\n"); \
+  fprintf(stderr, "   -T --time-limit=[seconds]\n"); \
+  fprintf(stderr, "      Stop the search after the given number of seconds.\n"); \
+  fprintf(stderr, "   -i --status-interval=[seconds]\n"); \
+  fprintf(stderr, "      Print the keys per second of the cluster, the pools searched, the time\n"); \
+  fprintf(stderr, "      left and the slowest ranks every given number of seconds, 10 by\n"); \
+  fprintf(stderr, "      default. 0 only prints a summary once the search is over.\n"); \
+  fprintf(stderr, "   -f --status-file=[file]\n"); \
+  fprintf(stderr, "      Also write the status, with the counts of each rank, to the given file,\n"); \
+  fprintf(stderr, "      replacing it at every interval.\n"); \
+  fprintf(stderr, "   -x --trace=[file]\n"); \
+  fprintf(stderr, "      Write when each rank waited for, received and searched pools and sent\n"); \
+  fprintf(stderr, "      results to the given file when the search is over, as a Chrome trace\n"); \
+  fprintf(stderr, "      that chrome://tracing and Perfetto can open. Only available when\n"); \
+  fprintf(stderr, "      built with TRIPRIPPER_TRACE.\n"); \
+  fprintf(stderr, "   -l --log-level=[debug|info|warning|error]\n"); \
+  fprintf(stderr, "      Only print messages of the given level and above, \"info\" by default.\n"); \
+  fprintf(stderr, "      \"debug\" also prints every pool the root leases out.\n"); \
+  fprintf(stderr, "   -S --export-shards=[count]\n"); \
+  fprintf(stderr, "      Divide the search in the file given with --checkpoint into the given\n"); \
+  fprintf(stderr, "      number of shards, without searching. The checkpoint of each shard is\n"); \
+  fprintf(stderr, "      written next to it, and can be searched on its own with --resume.\n"); \
+  fprintf(stderr, "      Without --resume, a new search is divided.\n"); \
+  fprintf(stderr, "   -M --merge=[file]\n"); \
+  fprintf(stderr, "      Merge the given shard checkpoint or match log into the search in the\n"); \
+  fprintf(stderr, "      file given with --checkpoint and the log given with --match-log,\n"); \
+  fprintf(stderr, "      without searching. May be given more than once.\n"); \
   exit(status); \
   } while (0)
 
 void tripRipperExit()
 {
+  TripRipper::Logger::singleton()->stop();
   MPI_Finalize();
 }
 
@@ -48,8 +137,19 @@ int main(int argc, char **argv)
 {
   MPI_Init(&argc, &argv);
   atexit(tripRipperExit);
+  int rank;
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  TripRipper::Logger::singleton()->start(rank);
 
-  std::string keyspaceMapping, tripcodeAlgorithm, matchingAlgorithm, searchString;
+  std::string keyspaceMapping, tripcodeAlgorithm, matchingAlgorithm, searchString, checkpointPath, matchLogPath, lookup, pluginDirectory;
+  tripcodeAlgorithm = matchingAlgorithm = TripRipper::EngineSelector::AUTO;
+  bool resume = false, tune = false, perfCounters = false;
+  uint64_t maxMatches = 0;
+  uint32_t shardCount = 0;
+  std::vector<std::string> mergePaths;
+  double timeLimit = 0.0, statusInterval = TripRipper::Telemetry::DEFAULT_INTERVAL;
+  std::string statusPath, tracePath;
+  TripRipper::TripcodeCrawler::DispatchMode dispatchMode = TripRipper::TripcodeCrawler::ROOT_DISPATCH;
 
   // parse options with getopts
   while(1)
@@ -59,10 +159,28 @@ int main(int argc, char **argv)
       {"tripcode-algorithm", required_argument, NULL, 't'},
       {"matching-algorithm", required_argument, NULL, 'm'},
       {"search-string", required_argument, NULL, 's'},
-      {"help", no_argument, NULL, 'h'}
+      {"plugin-dir", required_argument, NULL, 'P'},
+      {"perf-counters", no_argument, NULL, 'p'},
+      {"tune", no_argument, NULL, 'u'},
+      {"dispatch", required_argument, NULL, 'd'},
+      {"hierarchical", no_argument, NULL, 'H'},
+      {"checkpoint", required_argument, NULL, 'c'},
+      {"resume", no_argument, NULL, 'r'},
+      {"match-log", required_argument, NULL, 'o'},
+      {"lookup", required_argument, NULL, 'L'},
+      {"max-matches", required_argument, NULL, 'n'},
+      {"time-limit", required_argument, NULL, 'T'},
+      {"status-interval", required_argument, NULL, 'i'},
+      {"status-file", required_argument, NULL, 'f'},
+      {"trace", required_argument, NULL, 'x'},
+      {"log-level", required_argument, NULL, 'l'},
+      {"export-shards", required_argument, NULL, 'S'},
+      {"merge", required_argument, NULL, 'M'},
+      {"help", no_argument, NULL, 'h'},
+      {NULL, 0, NULL, 0}
     };
 
-    char opt = getopt_long(argc, argv, "k:t:m:", long_options, NULL);
+    char opt = getopt_long(argc, argv, "k:t:m:P:pud:Hc:ro:L:n:T:i:f:x:l:S:M:h", long_options, NULL);
 
     if(opt == -1)
       break;
@@ -75,7 +193,7 @@ int main(int argc, char **argv)
           USAGE(EXIT_FAILURE);
         }
         keyspaceMapping = std::string(optarg);
-        std::cout << "keyspaceMapping: " << keyspaceMapping << std::endl;
+        TripRipper::Logger::info("keyspaceMapping: %s", keyspaceMapping.c_str());
         break;
       case 't':
         if(optarg == NULL)
@@ -83,7 +201,7 @@ int main(int argc, char **argv)
           USAGE(EXIT_FAILURE);
         }
         tripcodeAlgorithm = std::string(optarg);
-        std::cout << "tripcodeAlgorithm: " << tripcodeAlgorithm << std::endl;
+        TripRipper::Logger::info("tripcodeAlgorithm: %s", tripcodeAlgorithm.c_str());
         break;
       case 'm':
         if(optarg == NULL)
@@ -91,7 +209,122 @@ int main(int argc, char **argv)
           USAGE(EXIT_FAILURE);
         }
         matchingAlgorithm = std::string(optarg);
-        std::cout << "matchingAlgorithm: " << matchingAlgorithm << std::endl;
+        TripRipper::Logger::info("matchingAlgorithm: %s", matchingAlgorithm.c_str());
+        break;
+      case 'P':
+        if(optarg == NULL)
+        {
+          USAGE(EXIT_FAILURE);
+        }
+        pluginDirectory = std::string(optarg);
+        break;
+      case 'p':
+        perfCounters = true;
+        break;
+      case 'u':
+        tune = true;
+        break;
+      case 'd':
+        if(optarg == NULL)
+        {
+          USAGE(EXIT_FAILURE);
+        }
+        if(std::string(optarg) == "root")
+          dispatchMode = TripRipper::TripcodeCrawler::ROOT_DISPATCH;
+        else if(std::string(optarg) == "node")
+          dispatchMode = TripRipper::TripcodeCrawler::NODE_DISPATCH;
+        else if(std::string(optarg) == "atomic")
+          dispatchMode = TripRipper::TripcodeCrawler::ATOMIC_DISPATCH;
+        else
+          USAGE(EXIT_FAILURE);
+        break;
+      case 'H':
+        dispatchMode = TripRipper::TripcodeCrawler::NODE_DISPATCH;
+        break;
+      case 'c':
+        if(optarg == NULL)
+        {
+          USAGE(EXIT_FAILURE);
+        }
+        checkpointPath = std::string(optarg);
+        break;
+      case 'r':
+        resume = true;
+        break;
+      case 'o':
+        if(optarg == NULL)
+        {
+          USAGE(EXIT_FAILURE);
+        }
+        matchLogPath = std::string(optarg);
+        break;
+      case 'L':
+        if(optarg == NULL)
+        {
+          USAGE(EXIT_FAILURE);
+        }
+        lookup = std::string(optarg);
+        break;
+      case 'n':
+        if(optarg == NULL)
+        {
+          USAGE(EXIT_FAILURE);
+        }
+        maxMatches = strtoull(optarg, NULL, 10);
+        break;
+      case 'T':
+        if(optarg == NULL)
+        {
+          USAGE(EXIT_FAILURE);
+        }
+        timeLimit = strtod(optarg, NULL);
+        break;
+      case 'i':
+        if(optarg == NULL)
+        {
+          USAGE(EXIT_FAILURE);
+        }
+        statusInterval = strtod(optarg, NULL);
+        break;
+      case 'f':
+        if(optarg == NULL)
+        {
+          USAGE(EXIT_FAILURE);
+        }
+        statusPath = std::string(optarg);
+        break;
+      case 'x':
+        if(optarg == NULL)
+        {
+          USAGE(EXIT_FAILURE);
+        }
+        tracePath = std::string(optarg);
+        break;
+      case 'l':
+        {
+          TripRipper::Logger::Level level;
+          if(optarg == NULL || !TripRipper::Logger::parseLevel(optarg, &level))
+          {
+            USAGE(EXIT_FAILURE);
+          }
+          TripRipper::Logger::singleton()->setLevel(level);
+        }
+        break;
+      case 'S':
+        if(optarg == NULL)
+        {
+          USAGE(EXIT_FAILURE);
+        }
+        shardCount = strtoul(optarg, NULL, 10);
+        if(shardCount == 0)
+          USAGE(EXIT_FAILURE);
+        break;
+      case 'M':
+        if(optarg == NULL)
+        {
+          USAGE(EXIT_FAILURE);
+        }
+        mergePaths.push_back(std::string(optarg));
         break;
       case 'h':
         USAGE(EXIT_SUCCESS);
@@ -103,16 +336,100 @@ int main(int argc, char **argv)
         break;
     };
   }
+  // look up a tripcode in an existing match log instead of searching
+  if(!lookup.empty())
+  {
+    if(matchLogPath.empty())
+    {
+      USAGE(EXIT_FAILURE);
+    }
+    int worldRank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &worldRank);
+    if(worldRank != TripRipper::ROOT_RANK)
+      return EXIT_SUCCESS;
+    TripRipper::MatchLog matchLog(matchLogPath);
+    if(!matchLog.isOpen())
+      return EXIT_FAILURE;
+    TripRipper::TripcodeSearchResult results;
+    matchLog.find(lookup, &results);
+    for(size_t i = 0; i < results.size(); ++i)
+      std::cout << "!" << results.tripcode(i) << " #" << results.key(i) << std::endl;
+    return EXIT_SUCCESS;
+  }
+
+  // divide a search into shards, or merge shards back into it, instead of
+  // searching
+  if(shardCount > 0 || !mergePaths.empty())
+  {
+    if(checkpointPath.empty() || (shardCount > 0 && !mergePaths.empty()))
+    {
+      USAGE(EXIT_FAILURE);
+    }
+    int worldRank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &worldRank);
+    if(worldRank != TripRipper::ROOT_RANK)
+      return EXIT_SUCCESS;
+    bool merging = !mergePaths.empty();
+    TripRipper::Checkpoint checkpoint(checkpointPath, resume || merging);
+    TripRipper::KeyspaceMapping *mapping;
+    if(resume || merging)
+      mapping = checkpoint.resume();
+    else
+      mapping = TripRipper::StrategyFactory::singleton()->createKeyspaceMapping(keyspaceMapping);
+    if(mapping == NULL)
+      return EXIT_FAILURE;
+    bool done;
+    if(merging)
+      done = TripRipper::ShardKeyspace::mergeShards(&checkpoint, mapping, matchLogPath, mergePaths);
+    else
+      done = TripRipper::ShardKeyspace::exportShards(&checkpoint, mapping, shardCount);
+    delete mapping;
+    return done ? EXIT_SUCCESS : EXIT_FAILURE;
+  }
+
   // get the search string
   if(optind >= argc)
   {
     USAGE(EXIT_FAILURE);
   }
   searchString = std::string(argv[optind]);
+  if(resume && checkpointPath.empty())
+  {
+    USAGE(EXIT_FAILURE);
+  }
+  // the root does not learn which pools have been searched in this mode
+  if(dispatchMode == TripRipper::TripcodeCrawler::ATOMIC_DISPATCH && !checkpointPath.empty())
+  {
+    TripRipper::Logger::error("--checkpoint and --resume cannot be used with --dispatch=atomic");
+    return EXIT_FAILURE;
+  }
+
+  // load the algorithms of plugins before they are chosen
+  if(pluginDirectory.empty())
+    pluginDirectory = TripRipper::StrategyFactory::defaultPluginDirectory();
+  TripRipper::StrategyFactory::singleton()->loadPlugins(pluginDirectory);
 
   TripRipper::TripcodeCrawler crawler(keyspaceMapping, tripcodeAlgorithm, matchingAlgorithm, searchString);
+  crawler.setDispatchMode(dispatchMode);
+  crawler.setCheckpoint(checkpointPath, resume);
+  crawler.setStopConditions(maxMatches, timeLimit);
+  crawler.setMatchLog(matchLogPath);
+  crawler.setPerfCounters(perfCounters);
+  crawler.setStatus(statusInterval, statusPath);
+  crawler.setTrace(tracePath);
 
+  if(tune)
+  {
+    crawler.tune();
+    return EXIT_SUCCESS;
+  }
   crawler.run();
 
+  // only the root holds the results, which follow the messages of the search
+  TripRipper::Logger::singleton()->flush();
+  const TripRipper::TripcodeSearchResult &results = crawler.results();
+  for(size_t i = 0; i < results.size(); ++i)
+    std::cout << "!" << results.tripcode(i) << " #" << results.key(i) << std::endl;
+
   return EXIT_SUCCESS;
 }
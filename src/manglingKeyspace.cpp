@@ -0,0 +1,416 @@
+/*******************************************************************************
+ * Copyright 2012 Jonathan Glines <auntieNeo@gmail.com>                        *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ ******************************************************************************/
+
+#include "manglingKeyspace.h"
+#include "keyspaceFactory.h"
+#include "logger.h"
+#include "serialization.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace TripRipper
+{
+  /**
+   * Returns a copy of the given pool, which has not started iterating yet.
+   */
+  static KeyspacePool *clonePool(const KeyspacePool *pool)
+  {
+    size_t size;
+    uint8_t *buffer = pool->serialize(&size);
+    KeyspacePool *clone = KeyspaceFactory::deserializeKeyspacePool(buffer, size);
+    assert(clone != NULL);
+    delete[] buffer;
+    return clone;
+  }
+
+  ManglingKeyspace::ManglingKeyspace() :
+    m_base(NULL), m_tracker(0)
+  {
+  }
+
+  ManglingKeyspace::~ManglingKeyspace()
+  {
+    delete m_base;
+  }
+
+  /**
+   * Sets the rules and the base mapping to mangle, which starts the search of
+   * the keyspace over. The mapping takes ownership of base, unless this
+   * returns false because there are no rules or because the base mapping
+   * does not support createPool().
+   */
+  bool ManglingKeyspace::setMangling(const ManglingRules &rules, KeyspaceMapping *base)
+  {
+    assert(m_tracker.poolsCheckedOut() == 0);
+    if(rules.ruleCount() == 0 || base->totalPools() == 0)
+      return false;
+    KeyspacePool *probe = base->createPool(0, 1);
+    if(probe == NULL)
+      return false;
+    delete probe;
+    if(base != m_base)
+      delete m_base;
+    m_rules = rules;
+    m_base = base;
+    m_tracker = PoolTracker(m_base->totalPools() * m_rules.ruleCount());
+    return true;
+  }
+
+  uint64_t ManglingKeyspace::totalPools()
+  {
+    return m_tracker.totalPools();
+  }
+
+  uint64_t ManglingKeyspace::poolsLeft()
+  {
+    return m_tracker.poolsLeft();
+  }
+
+  size_t ManglingKeyspace::poolSize()
+  {
+    return m_base->poolSize();
+  }
+
+  KeyspacePool *ManglingKeyspace::checkoutNextPool()
+  {
+    return checkoutPools(1);
+  }
+
+  KeyspacePool *ManglingKeyspace::checkoutPools(uint64_t poolCount)
+  {
+    uint64_t firstPool, count;
+    if(!m_tracker.checkout(poolCount, &firstPool, &count))
+      return NULL;
+    return createPool(firstPool, count);
+  }
+
+  KeyspacePool *ManglingKeyspace::createPool(uint64_t firstPool, uint64_t poolCount)
+  {
+    assert(poolCount > 0);
+    assert(firstPool < totalPools() && poolCount <= totalPools() - firstPool);
+    uint64_t ruleCount = m_rules.ruleCount();
+    uint64_t firstBase = firstPool / ruleCount;
+    uint64_t lastBase = (firstPool + poolCount - 1) / ruleCount;
+    KeyspacePool *base = m_base->createPool(firstBase, lastBase - firstBase + 1);
+    assert(base != NULL);
+    // the keys are copied when they are mangled, so spacers are wasted
+    base->setOutputStride(0);
+    ManglingKeyspacePool *pool = new ManglingKeyspacePool(m_rules, firstPool, poolCount, base);
+    pool->setOutputAlignment(outputAlignment());
+    pool->setOutputStride(outputStride());
+    return pool;
+  }
+
+  void ManglingKeyspace::checkinPool(KeyspacePool *pool)
+  {
+    ManglingKeyspacePool *manglingPool = dynamic_cast<ManglingKeyspacePool*>(pool);
+    assert(manglingPool != NULL);
+    m_tracker.checkin(manglingPool->firstPool(), manglingPool->poolCount());
+  }
+
+  void ManglingKeyspace::abandonPool(KeyspacePool *pool)
+  {
+    ManglingKeyspacePool *manglingPool = dynamic_cast<ManglingKeyspacePool*>(pool);
+    assert(manglingPool != NULL);
+    m_tracker.abandon(manglingPool->firstPool(), manglingPool->poolCount());
+  }
+
+  size_t ManglingKeyspace::serialSize() const
+  {
+    assert(m_base != NULL);
+    return 4 + 4 + m_rules.text().size() + 4 + m_base->serialSize() + m_tracker.serialSize();
+  }
+
+  /**
+   * The serial representation of a ManglingKeyspace is the
+   * KeyspaceMapping::MANGLE type, followed by the length of the rules, the
+   * rules themselves, the length of the serialized base mapping, the base
+   * mapping and the serialized PoolTracker.
+   */
+  void ManglingKeyspace::serialize(unsigned char *buffer, size_t size, bool &done) const
+  {
+    done = false;
+    if(size < serialSize())
+      return;
+    const std::string &text = m_rules.text();
+    size_t baseSize = m_base->serialSize();
+    writeUint32(buffer, KeyspaceMapping::MANGLE);
+    writeUint32(buffer + 4, static_cast<uint32_t>(text.size()));
+    memcpy(buffer + 8, text.data(), text.size());
+    buffer += 8 + text.size();
+    writeUint32(buffer, static_cast<uint32_t>(baseSize));
+    bool baseDone;
+    m_base->serialize(buffer + 4, baseSize, baseDone);
+    assert(baseDone);
+    m_tracker.serialize(buffer + 4 + baseSize);
+    done = true;
+  }
+
+  void ManglingKeyspace::deserialize(const unsigned char *buffer, size_t size, bool &done)
+  {
+    done = false;
+    if(size < 8 || readUint32(buffer) != KeyspaceMapping::MANGLE)
+      return;
+    size_t textSize = readUint32(buffer + 4);
+    if(size - 8 < textSize + 4)
+      return;
+    ManglingRules rules;
+    if(!rules.compile(std::string(reinterpret_cast<const char*>(buffer + 8), textSize)))
+      return;
+    buffer += 8 + textSize;
+    size -= 8 + textSize;
+    size_t baseSize = readUint32(buffer);
+    if(size - 4 < baseSize)
+      return;
+    KeyspaceMapping *base = KeyspaceFactory::deserializeKeyspaceMapping(buffer + 4, baseSize);
+    if(base == NULL)
+      return;
+    if(!setMangling(rules, base))
+    {
+      delete base;
+      return;
+    }
+    uint64_t totalPools = m_tracker.totalPools();
+    if(m_tracker.deserialize(buffer + 4 + baseSize, size - 4 - baseSize) == 0)
+      return;
+    // the base mapping has changed size since the checkpoint
+    if(m_tracker.totalPools() != totalPools)
+      m_tracker = PoolTracker(totalPools);
+    done = true;
+  }
+
+  ManglingKeyspacePool::ManglingKeyspacePool() :
+    m_firstPool(0), m_poolCount(0),
+    m_base(NULL),
+    m_blockKeys(0),
+    m_outputAlignment(1), m_outputStride(0),
+    m_outputPackHighBit(false),
+    m_nextPool(0), m_piece(NULL), m_baseBlock(NULL),
+    m_rule(0), m_ruleBegin(0), m_ruleEnd(0)
+  {
+  }
+
+  /**
+   * Constructs a pool covering poolCount pools starting at firstPool. The
+   * pool takes ownership of base, which must cover the base pools of these
+   * pools.
+   */
+  ManglingKeyspacePool::ManglingKeyspacePool(const ManglingRules &rules, uint64_t firstPool, uint64_t poolCount, KeyspacePool *base) :
+    m_rules(rules),
+    m_firstPool(firstPool), m_poolCount(poolCount),
+    m_base(base),
+    m_blockKeys(0),
+    m_outputAlignment(1), m_outputStride(0),
+    m_outputPackHighBit(false),
+    m_nextPool(firstPool), m_piece(NULL), m_baseBlock(NULL),
+    m_rule(0), m_ruleBegin(0), m_ruleEnd(0)
+  {
+  }
+
+  ManglingKeyspacePool::~ManglingKeyspacePool()
+  {
+    delete m_base;
+    delete m_piece;
+  }
+
+  /**
+   * Pools can only be split before any blocks have been taken from them.
+   * When the split falls between the rules of a base pool, both parts need
+   * that base pool, so the part returned gets a copy of it.
+   */
+  KeyspacePool *ManglingKeyspacePool::splitPool(uint64_t poolCount)
+  {
+    if(poolCount == 0 || poolCount >= m_poolCount || m_base == NULL || m_piece != NULL)
+      return NULL;
+    uint64_t ruleCount = m_rules.ruleCount();
+    uint64_t firstBase = m_firstPool / ruleCount;
+    uint64_t frontLastBase = (m_firstPool + poolCount - 1) / ruleCount;
+    uint64_t backFirstBase = (m_firstPool + poolCount) / ruleCount;
+    uint64_t frontBases = frontLastBase - firstBase + 1;
+
+    KeyspacePool *front;
+    if(frontLastBase == backFirstBase)
+    {
+      front = clonePool(m_base);
+      if(frontBases < front->poolCount())
+      {
+        KeyspacePool *back = front;
+        front = back->splitPool(frontBases);
+        delete back;
+      }
+      if(backFirstBase > firstBase)
+        delete m_base->splitPool(backFirstBase - firstBase);
+    }
+    else
+    {
+      front = m_base->splitPool(frontBases);
+    }
+    assert(front != NULL);
+
+    ManglingKeyspacePool *pool = new ManglingKeyspacePool(m_rules, m_firstPool, poolCount, front);
+    pool->setBlockKeys(m_blockKeys);
+    pool->setOutputAlignment(m_outputAlignment);
+    pool->setOutputStride(m_outputStride);
+    pool->setOutputPackHighBit(m_outputPackHighBit);
+    m_firstPool += poolCount;
+    m_poolCount -= poolCount;
+    m_nextPool = m_firstPool;
+    return pool;
+  }
+
+  size_t ManglingKeyspacePool::blockSize()
+  {
+    if(m_base == NULL)
+      return 0;
+    return m_base->blockSize() / KeyBlock::KEY_SIZE * (KeyBlock::KEY_SIZE + m_outputStride);
+  }
+
+  /**
+   * The blocks are those of the base pool, so the number of keys is passed
+   * on to it.
+   */
+  void ManglingKeyspacePool::setBlockKeys(size_t blockKeys)
+  {
+    m_blockKeys = blockKeys;
+    if(m_base != NULL)
+      m_base->setBlockKeys(blockKeys);
+    if(m_piece != NULL)
+      m_piece->setBlockKeys(blockKeys);
+  }
+
+  /**
+   * Takes one base pool at a time from the base pool, and returns each of
+   * its blocks mangled by each of the rules of this pool for it, so the base
+   * keys are only generated or read once.
+   *
+   * \todo Pack the high bits of the keys when outputPackHighBit() is set.
+   */
+  KeyBlock *ManglingKeyspacePool::getNextBlock()
+  {
+    uint64_t ruleCount = m_rules.ruleCount();
+    uint64_t endPool = m_firstPool + m_poolCount;
+    while(true)
+    {
+      if(m_baseBlock != NULL && m_rule < m_ruleEnd)
+      {
+        m_rules.apply(m_rule++, *m_baseBlock, m_outputStride, &m_block);
+        return &m_block;
+      }
+      if(m_piece != NULL)
+      {
+        m_baseBlock = m_piece->getNextBlock();
+        if(m_baseBlock != NULL)
+        {
+          m_rule = m_ruleBegin;
+          continue;
+        }
+        delete m_piece;
+        m_piece = NULL;
+        m_nextPool = (m_nextPool / ruleCount + 1) * ruleCount;
+      }
+      if(m_nextPool >= endPool || m_base == NULL)
+        return NULL;
+
+      // take the next base pool
+      uint64_t basePool = m_nextPool / ruleCount;
+      m_ruleBegin = m_nextPool % ruleCount;
+      m_ruleEnd = std::min(endPool - basePool * ruleCount, ruleCount);
+      if(m_base->poolCount() > 1)
+      {
+        m_piece = m_base->splitPool(1);
+        assert(m_piece != NULL);
+      }
+      else
+      {
+        m_piece = m_base;
+        m_base = NULL;
+      }
+    }
+  }
+
+  /**
+   * The serial representation of a ManglingKeyspacePool is the
+   * KeyspacePool::MANGLE type, followed by the length of the rules, the rules
+   * themselves, the first pool index, the number of pools, the length of the
+   * serialized base pool and the base pool. Once iteration has started, the
+   * base pool is left out, since only the pool indices are needed to check
+   * the pool in.
+   */
+  uint8_t *ManglingKeyspacePool::serialize(size_t *size) const
+  {
+    const std::string &text = m_rules.text();
+    size_t baseSize = 0;
+    uint8_t *base = NULL;
+    if(m_base != NULL && m_piece == NULL && m_nextPool == m_firstPool)
+      base = m_base->serialize(&baseSize);
+    *size = 4 + 4 + text.size() + 8 + 8 + 4 + baseSize;
+    uint8_t *buffer = new uint8_t[*size];
+    writeUint32(buffer, KeyspacePool::MANGLE);
+    writeUint32(buffer + 4, static_cast<uint32_t>(text.size()));
+    memcpy(buffer + 8, text.data(), text.size());
+    uint8_t *p = buffer + 8 + text.size();
+    writeUint64(p, m_firstPool);
+    writeUint64(p + 8, m_poolCount);
+    writeUint32(p + 16, static_cast<uint32_t>(baseSize));
+    if(base != NULL)
+      memcpy(p + 20, base, baseSize);
+    delete[] base;
+    return buffer;
+  }
+
+  void ManglingKeyspacePool::deserialize(const uint8_t *buffer, size_t size, bool &done)
+  {
+    done = false;
+    if(size < 8 || readUint32(buffer) != KeyspacePool::MANGLE)
+      return;
+    size_t textSize = readUint32(buffer + 4);
+    if(size - 8 < textSize + 20)
+      return;
+    // a recycled pool of the same rules does not compile them again
+    const std::string &current = m_rules.text();
+    if((textSize != current.size() || memcmp(buffer + 8, current.data(), textSize) != 0) &&
+        !m_rules.compile(std::string(reinterpret_cast<const char*>(buffer + 8), textSize)))
+    {
+      Logger::error("Received a pool with invalid mangling rules");
+      return;
+    }
+    const uint8_t *p = buffer + 8 + textSize;
+    m_firstPool = readUint64(p);
+    m_poolCount = readUint64(p + 8);
+    size_t baseSize = readUint32(p + 16);
+    if(size - 8 - textSize - 20 < baseSize)
+      return;
+    delete m_piece;
+    m_piece = NULL;
+    KeyspacePool *base = m_base;
+    m_base = NULL;
+    if(baseSize > 0)
+      m_base = KeyspaceFactory::deserializeKeyspacePool(p + 20, baseSize, base);
+    else
+      delete base;
+    m_baseBlock = NULL;
+    m_nextPool = m_firstPool;
+    // the base pool reports its own failure
+    done = baseSize == 0 || m_base != NULL;
+  }
+}
@@ -0,0 +1,130 @@
+/*******************************************************************************
+ * Copyright 2012 Jonathan Glines <auntieNeo@gmail.com>                        *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ ******************************************************************************/
+
+#ifndef MANGLING_KEYSPACE_H_
+#define MANGLING_KEYSPACE_H_
+
+#include "keyspace.h"
+#include "manglingRules.h"
+#include "poolTracker.h"
+
+namespace TripRipper
+{
+  /**
+   * The ManglingKeyspace class decorates another KeyspaceMapping, the base
+   * mapping, with a list of ManglingRules. Every rule is applied to every key
+   * of the base mapping, so the keys of e.g. a wordlist are searched along
+   * with their capitalized, leet speak and digit suffixed variants without
+   * the variants ever being written out.
+   *
+   * Pool i of the mapping is rule i % R applied to pool i / R of the base
+   * mapping, where R is the number of rules, so the rules for a base pool
+   * are adjacent and a lease of several pools reads each base pool once.
+   * The base mapping must support createPool(), and then so does this
+   * mapping.
+   */
+  class ManglingKeyspace : public KeyspaceMapping
+  {
+    public:
+      ManglingKeyspace();
+      ~ManglingKeyspace();
+
+      bool setMangling(const ManglingRules &rules, KeyspaceMapping *base);
+      const ManglingRules &rules() const { return m_rules; }
+
+      uint64_t totalPools();
+      uint64_t poolsLeft();
+      size_t poolSize();
+      KeyspacePool *checkoutNextPool();
+      KeyspacePool *checkoutPools(uint64_t poolCount);
+      KeyspacePool *createPool(uint64_t firstPool, uint64_t poolCount);
+      void checkinPool(KeyspacePool *pool);
+      void abandonPool(KeyspacePool *pool);
+      PoolTracker *poolTracker() { return &m_tracker; }
+
+      size_t serialSize() const;
+      void serialize(unsigned char *buffer, size_t size, bool &done) const;
+      void deserialize(const unsigned char *buffer, size_t size, bool &done);
+
+    private:
+      ManglingRules m_rules;
+      KeyspaceMapping *m_base;
+      PoolTracker m_tracker;
+  };
+
+  /**
+   * The ManglingKeyspacePool implements a KeyspacePool for ManglingKeyspace.
+   * It carries the rules and a pool of the base mapping covering its base
+   * pools, and mangles each block of the base pool with each of its rules in
+   * turn.
+   */
+  class ManglingKeyspacePool : public KeyspacePool
+  {
+    friend class ManglingKeyspace;
+
+    public:
+      ManglingKeyspacePool();
+      ManglingKeyspacePool(const ManglingRules &rules, uint64_t firstPool, uint64_t poolCount, KeyspacePool *base);
+      ~ManglingKeyspacePool();
+
+      /**
+       * Returns the index of the first pool covered by this object.
+       */
+      uint64_t firstPool() const { return m_firstPool; }
+      uint64_t poolCount() { return m_poolCount; }
+      KeyspacePool *splitPool(uint64_t poolCount);
+
+      size_t blockSize();
+      void setBlockKeys(size_t blockKeys);
+      size_t outputAlignment() { return m_outputAlignment; }
+      void setOutputAlignment(size_t alignment) { m_outputAlignment = alignment; }
+      size_t outputStride() { return m_outputStride; }
+      void setOutputStride(size_t stride) { m_outputStride = stride; }
+      bool outputPackHighBit() { return m_outputPackHighBit; }
+      void setOutputPackHighBit(bool packHighBit) { m_outputPackHighBit = packHighBit; }
+
+      KeyBlock *getNextBlock();
+
+      uint8_t *serialize(size_t *size) const;
+
+    protected:
+      void deserialize(const uint8_t *buffer, size_t size, bool &done);
+
+    private:
+      ManglingRules m_rules;
+      uint64_t m_firstPool, m_poolCount;
+      // the base pools that have not been taken into m_piece yet
+      KeyspacePool *m_base;
+      size_t m_blockKeys;
+      size_t m_outputAlignment, m_outputStride;
+      bool m_outputPackHighBit;
+
+      // the state of the iteration over the keys of the pool
+      KeyBlock m_block;
+      uint64_t m_nextPool;
+      KeyspacePool *m_piece;
+      KeyBlock *m_baseBlock;
+      size_t m_rule, m_ruleBegin, m_ruleEnd;
+  };
+}
+
+#endif
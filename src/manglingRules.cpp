@@ -0,0 +1,265 @@
+/*******************************************************************************
+ * Copyright 2012 Jonathan Glines <auntieNeo@gmail.com>                        *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ ******************************************************************************/
+
+#include "manglingRules.h"
+#include "keyspace.h"
+#include "logger.h"
+
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+namespace TripRipper
+{
+  static uint8_t lower(uint8_t c)
+  {
+    return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+  }
+
+  static uint8_t upper(uint8_t c)
+  {
+    return (c >= 'a' && c <= 'z') ? c - ('a' - 'A') : c;
+  }
+
+  static uint8_t toggle(uint8_t c)
+  {
+    return (c >= 'a' && c <= 'z') ? upper(c) : lower(c);
+  }
+
+  ManglingRules::ManglingRules()
+  {
+  }
+
+  ManglingRules::~ManglingRules()
+  {
+  }
+
+  /**
+   * Compiles the given rules, replacing any rules compiled before. Returns
+   * false if a rule is invalid or if there are no rules.
+   */
+  bool ManglingRules::compile(const std::string &text)
+  {
+    m_text.clear();
+    m_rules.clear();
+    std::istringstream lines(text);
+    std::string line;
+    while(std::getline(lines, line))
+    {
+      if(!line.empty() && line[line.size() - 1] == '\r')
+        line.erase(line.size() - 1);
+      if(line.empty() || line[0] == '#')
+        continue;
+      std::vector<Operation> rule;
+      if(!compileRule(line, &rule))
+      {
+        Logger::error("Invalid mangling rule \"%s\"", line.c_str());
+        return false;
+      }
+      m_rules.push_back(rule);
+      m_text += line + "\n";
+    }
+    return !m_rules.empty();
+  }
+
+  /**
+   * Compiles the rules in the file at path.
+   */
+  bool ManglingRules::load(const std::string &path)
+  {
+    std::ifstream file(path.c_str());
+    if(!file)
+    {
+      Logger::error("Could not open mangling rules %s", path.c_str());
+      return false;
+    }
+    std::ostringstream text;
+    text << file.rdbuf();
+    return compile(text.str());
+  }
+
+  bool ManglingRules::compileRule(const std::string &line, std::vector<Operation> *rule)
+  {
+    for(size_t i = 0; i < line.size(); ++i)
+    {
+      char function = line[i];
+      if(function == ' ' || function == ':')
+        continue;
+
+      // the arguments of the function
+      size_t arguments = 0;
+      if(function == 'T' || function == '$' || function == '^' || function == '\'')
+        arguments = 1;
+      else if(function == 's')
+        arguments = 2;
+      if(line.size() - i - 1 < arguments)
+        return false;
+      uint8_t first = arguments > 0 ? line[i + 1] : 0;
+      uint8_t second = arguments > 1 ? line[i + 2] : 0;
+      i += arguments;
+
+      Operation operation;
+      operation.opcode = TRANSLATE;
+      operation.argument = first;
+      uint8_t table[256];
+      for(int c = 0; c < 256; ++c)
+        table[c] = c;
+      switch(function)
+      {
+        case 'l':
+        case 'c':
+          for(int c = 0; c < 256; ++c)
+            table[c] = lower(c);
+          break;
+        case 'u':
+          for(int c = 0; c < 256; ++c)
+            table[c] = upper(c);
+          break;
+        case 't':
+          for(int c = 0; c < 256; ++c)
+            table[c] = toggle(c);
+          break;
+        case 's':
+          table[first] = second;
+          break;
+        case 'T':
+        case '\'':
+          if(first < '0' || first > '7')
+            return false;
+          // truncating to nothing would make empty keys
+          if(function == '\'' && first == '0')
+            return false;
+          operation.opcode = function == 'T' ? TOGGLE_AT : TRUNCATE;
+          operation.argument = first - '0';
+          break;
+        case '$':
+          operation.opcode = APPEND;
+          break;
+        case '^':
+          operation.opcode = PREPEND;
+          break;
+        default:
+          return false;
+      }
+
+      if(operation.opcode == TRANSLATE)
+      {
+        // fuse with a preceding translation
+        if(!rule->empty() && rule->back().opcode == TRANSLATE)
+        {
+          std::vector<uint8_t> &fused = rule->back().table;
+          for(int c = 0; c < 256; ++c)
+            fused[c] = table[fused[c]];
+        }
+        else
+        {
+          operation.table.assign(table, table + 256);
+          rule->push_back(operation);
+        }
+      }
+      else
+      {
+        rule->push_back(operation);
+      }
+
+      if(function == 'c')
+      {
+        operation.opcode = CAPITALIZE;
+        rule->push_back(operation);
+      }
+    }
+    // keys are zero padded, so zero bytes must stay zero bytes
+    for(size_t i = 0; i < rule->size(); ++i)
+    {
+      const Operation &operation = (*rule)[i];
+      if(operation.opcode == TRANSLATE && operation.table[0] != 0)
+        return false;
+      if((operation.opcode == APPEND || operation.opcode == PREPEND) && operation.argument == 0)
+        return false;
+    }
+    return true;
+  }
+
+  /**
+   * Applies the rule with the given index to every key of keys, and writes
+   * the results to mangled, with stride spacer bytes after each key.
+   */
+  void ManglingRules::apply(size_t rule, const KeyBlock &keys, size_t stride, KeyBlock *mangled) const
+  {
+    assert(rule < m_rules.size());
+    const size_t keySize = KeyBlock::KEY_SIZE;
+    size_t numKeys = keys.numKeys();
+    mangled->resize(numKeys, stride);
+    for(size_t i = 0; i < numKeys; ++i)
+      memcpy(mangled->key(i), keys.key(i), keySize);
+
+    const std::vector<Operation> &operations = m_rules[rule];
+    for(size_t o = 0; o < operations.size(); ++o)
+    {
+      const Operation &operation = operations[o];
+      uint8_t argument = operation.argument;
+      switch(operation.opcode)
+      {
+        case TRANSLATE:
+          {
+            const uint8_t *table = &operation.table[0];
+            for(size_t i = 0; i < numKeys; ++i)
+            {
+              uint8_t *key = mangled->key(i);
+              for(size_t j = 0; j < keySize; ++j)
+                key[j] = table[key[j]];
+            }
+          }
+          break;
+        case CAPITALIZE:
+          for(size_t i = 0; i < numKeys; ++i)
+            mangled->key(i)[0] = upper(mangled->key(i)[0]);
+          break;
+        case TOGGLE_AT:
+          for(size_t i = 0; i < numKeys; ++i)
+            mangled->key(i)[argument] = toggle(mangled->key(i)[argument]);
+          break;
+        case APPEND:
+          for(size_t i = 0; i < numKeys; ++i)
+          {
+            uint8_t *key = mangled->key(i);
+            size_t length = strnlen(reinterpret_cast<const char*>(key), keySize);
+            if(length < keySize)
+              key[length] = argument;
+          }
+          break;
+        case PREPEND:
+          for(size_t i = 0; i < numKeys; ++i)
+          {
+            uint8_t *key = mangled->key(i);
+            memmove(key + 1, key, keySize - 1);
+            key[0] = argument;
+          }
+          break;
+        case TRUNCATE:
+          for(size_t i = 0; i < numKeys; ++i)
+            memset(mangled->key(i) + argument, 0, keySize - argument);
+          break;
+      }
+    }
+  }
+}
@@ -0,0 +1,95 @@
+/*******************************************************************************
+ * Copyright 2012 Jonathan Glines <auntieNeo@gmail.com>                        *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ ******************************************************************************/
+
+#ifndef MANGLING_RULES_H_
+#define MANGLING_RULES_H_
+
+#include "common.h"
+
+namespace TripRipper
+{
+  class KeyBlock;
+
+  /**
+   * The ManglingRules class holds a compiled list of hashcat style mangling
+   * rules, which derive new keys from the keys of a KeyBlock.
+   *
+   * Rules are given one per line, and empty lines and lines starting with #
+   * are ignored. Each rule is a sequence of the following functions, which
+   * may be separated by spaces.
+   *
+   * - ":" leaves the key as it is.
+   * - "l", "u" and "t" lowercase, uppercase and toggle the case of the key.
+   * - "c" capitalizes the key, i.e. uppercases the first character and
+   *   lowercases the rest.
+   * - "TN" toggles the case of the character at position N.
+   * - "$X" and "^X" append and prepend the character X.
+   * - "sXY" substitutes the character Y for every X, e.g. "sa4 se3 so0".
+   * - "'N" truncates the key to N characters, where N is at least 1.
+   *
+   * Positions are single digits counted from 0. Every key is implicitly
+   * truncated to KeyBlock::KEY_SIZE characters, since crypt(3) ignores the
+   * rest.
+   *
+   * Rules are applied to a whole KeyBlock at a time, one function after the
+   * other. Functions that map characters to characters regardless of their
+   * position, i.e. "l", "u", "t" and "s", are compiled into 256 byte
+   * translation tables, and consecutive ones are fused into a single table,
+   * so that they cost one table lookup per byte of the block.
+   */
+  class ManglingRules
+  {
+    public:
+      ManglingRules();
+      ~ManglingRules();
+
+      bool compile(const std::string &text);
+      bool load(const std::string &path);
+
+      /**
+       * Returns the rules that were compiled, one per line, which compile()
+       * accepts to produce the same rules.
+       */
+      const std::string &text() const { return m_text; }
+      size_t ruleCount() const { return m_rules.size(); }
+
+      void apply(size_t rule, const KeyBlock &keys, size_t stride, KeyBlock *mangled) const;
+
+    private:
+      enum Opcode { TRANSLATE, CAPITALIZE, TOGGLE_AT, APPEND, PREPEND, TRUNCATE };
+
+      struct Operation
+      {
+        Opcode opcode;
+        uint8_t argument;
+        // the translation table of TRANSLATE operations
+        std::vector<uint8_t> table;
+      };
+
+      bool compileRule(const std::string &line, std::vector<Operation> *rule);
+
+      std::string m_text;
+      std::vector<std::vector<Operation> > m_rules;
+  };
+}
+
+#endif
@@ -0,0 +1,268 @@
+/*******************************************************************************
+ * Copyright 2012 Jonathan Glines <auntieNeo@gmail.com>                        *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ ******************************************************************************/
+
+#include "maskKeyspace.h"
+#include "logger.h"
+#include "serialization.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace TripRipper
+{
+  const uint64_t MaskKeyspace::POOL_SIZE;
+
+  MaskKeyspace::MaskKeyspace() :
+    m_tracker(0)
+  {
+  }
+
+  MaskKeyspace::~MaskKeyspace()
+  {
+  }
+
+  /**
+   * Sets the mask from the given specification, which starts the search of
+   * the keyspace over. Returns false if the specification is invalid.
+   *
+   * \sa KeyMask::parse()
+   */
+  bool MaskKeyspace::setMask(const std::string &spec)
+  {
+    assert(m_tracker.poolsCheckedOut() == 0);
+    if(!m_mask.parse(spec))
+      return false;
+    m_tracker = PoolTracker((m_mask.totalKeys() + POOL_SIZE - 1) / POOL_SIZE);
+    return true;
+  }
+
+  uint64_t MaskKeyspace::totalPools()
+  {
+    return m_tracker.totalPools();
+  }
+
+  uint64_t MaskKeyspace::poolsLeft()
+  {
+    return m_tracker.poolsLeft();
+  }
+
+  size_t MaskKeyspace::poolSize()
+  {
+    return static_cast<size_t>(std::min(m_mask.totalKeys(), POOL_SIZE));
+  }
+
+  KeyspacePool *MaskKeyspace::checkoutNextPool()
+  {
+    return checkoutPools(1);
+  }
+
+  /**
+   * Pools are handed out in the order of their key indices. Abandoned pools
+   * are handed out again before any pools after them.
+   */
+  KeyspacePool *MaskKeyspace::checkoutPools(uint64_t poolCount)
+  {
+    uint64_t firstPool, count;
+    if(!m_tracker.checkout(poolCount, &firstPool, &count))
+      return NULL;
+    return createPool(firstPool, count);
+  }
+
+  KeyspacePool *MaskKeyspace::createPool(uint64_t firstPool, uint64_t poolCount)
+  {
+    assert(poolCount > 0);
+    assert(firstPool < totalPools() && poolCount <= totalPools() - firstPool);
+    MaskKeyspacePool *pool = new MaskKeyspacePool(m_mask, firstPool, poolCount);
+    pool->setOutputAlignment(outputAlignment());
+    pool->setOutputStride(outputStride());
+    return pool;
+  }
+
+  void MaskKeyspace::checkinPool(KeyspacePool *pool)
+  {
+    MaskKeyspacePool *maskPool = dynamic_cast<MaskKeyspacePool*>(pool);
+    assert(maskPool != NULL);
+    m_tracker.checkin(maskPool->firstPool(), maskPool->poolCount());
+  }
+
+  void MaskKeyspace::abandonPool(KeyspacePool *pool)
+  {
+    MaskKeyspacePool *maskPool = dynamic_cast<MaskKeyspacePool*>(pool);
+    assert(maskPool != NULL);
+    m_tracker.abandon(maskPool->firstPool(), maskPool->poolCount());
+  }
+
+  size_t MaskKeyspace::serialSize() const
+  {
+    return 4 + 4 + m_mask.spec().size() + m_tracker.serialSize();
+  }
+
+  /**
+   * The serial representation of a MaskKeyspace is the
+   * KeyspaceMapping::MASK type, followed by the length of the mask
+   * specification, the specification itself and the serialized PoolTracker.
+   */
+  void MaskKeyspace::serialize(unsigned char *buffer, size_t size, bool &done) const
+  {
+    done = false;
+    if(size < serialSize())
+      return;
+    const std::string &spec = m_mask.spec();
+    writeUint32(buffer, KeyspaceMapping::MASK);
+    writeUint32(buffer + 4, static_cast<uint32_t>(spec.size()));
+    memcpy(buffer + 8, spec.data(), spec.size());
+    m_tracker.serialize(buffer + 8 + spec.size());
+    done = true;
+  }
+
+  void MaskKeyspace::deserialize(const unsigned char *buffer, size_t size, bool &done)
+  {
+    done = false;
+    if(size < 8 || readUint32(buffer) != KeyspaceMapping::MASK)
+      return;
+    size_t specSize = readUint32(buffer + 4);
+    if(size - 8 < specSize)
+      return;
+    if(!setMask(std::string(reinterpret_cast<const char*>(buffer + 8), specSize)))
+      return;
+    if(m_tracker.deserialize(buffer + 8 + specSize, size - 8 - specSize) == 0)
+      return;
+    done = true;
+  }
+
+  MaskKeyspacePool::MaskKeyspacePool() :
+    m_firstPool(0), m_poolCount(0),
+    m_blockKeys(BLOCK_KEYS),
+    m_outputAlignment(1), m_outputStride(0),
+    m_outputPackHighBit(false),
+    m_nextIndex(0), m_keyLength(0)
+  {
+  }
+
+  MaskKeyspacePool::MaskKeyspacePool(const KeyMask &mask, uint64_t firstPool, uint64_t poolCount) :
+    m_mask(mask),
+    m_firstPool(firstPool), m_poolCount(poolCount),
+    m_blockKeys(BLOCK_KEYS),
+    m_outputAlignment(1), m_outputStride(0),
+    m_outputPackHighBit(false),
+    m_nextIndex(firstPool * MaskKeyspace::POOL_SIZE), m_keyLength(0)
+  {
+  }
+
+  MaskKeyspacePool::~MaskKeyspacePool()
+  {
+  }
+
+  /**
+   * Pools can only be split before any blocks have been taken from them.
+   */
+  KeyspacePool *MaskKeyspacePool::splitPool(uint64_t poolCount)
+  {
+    if(poolCount == 0 || poolCount >= m_poolCount || m_keyLength != 0)
+      return NULL;
+    MaskKeyspacePool *pool = new MaskKeyspacePool(m_mask, m_firstPool, poolCount);
+    pool->setBlockKeys(m_blockKeys);
+    pool->setOutputAlignment(m_outputAlignment);
+    pool->setOutputStride(m_outputStride);
+    pool->setOutputPackHighBit(m_outputPackHighBit);
+    m_firstPool += poolCount;
+    m_poolCount -= poolCount;
+    m_nextIndex = m_firstPool * MaskKeyspace::POOL_SIZE;
+    return pool;
+  }
+
+  size_t MaskKeyspacePool::blockSize()
+  {
+    return m_blockKeys * (KeyBlock::KEY_SIZE + m_outputStride);
+  }
+
+  /**
+   * Keys are generated by advancing the digits of the previous key, so only
+   * the first key of the pool needs the divisions of KeyMask::key().
+   *
+   * \todo Pack the high bits of the keys when outputPackHighBit() is set.
+   */
+  KeyBlock *MaskKeyspacePool::getNextBlock()
+  {
+    uint64_t endIndex = std::min((m_firstPool + m_poolCount) * MaskKeyspace::POOL_SIZE, m_mask.totalKeys());
+    if(m_nextIndex >= endIndex)
+      return NULL;
+    if(m_keyLength == 0)
+      m_keyLength = m_mask.key(m_nextIndex, m_key, m_digits);
+
+    size_t numKeys = static_cast<size_t>(std::min(endIndex - m_nextIndex, static_cast<uint64_t>(m_blockKeys)));
+    m_block.resize(numKeys, m_outputStride);
+    for(size_t i = 0; i < numKeys; ++i)
+    {
+      memcpy(m_block.key(i), m_key, KeyBlock::KEY_SIZE);
+      if(++m_nextIndex < endIndex)
+        m_keyLength = m_mask.nextKey(m_keyLength, m_key, m_digits);
+    }
+    return &m_block;
+  }
+
+  /**
+   * The serial representation of a MaskKeyspacePool is the
+   * KeyspacePool::MASK type, followed by the length of the mask
+   * specification, the specification itself, the first pool index and the
+   * number of pools, all in network byte order.
+   */
+  uint8_t *MaskKeyspacePool::serialize(size_t *size) const
+  {
+    const std::string &spec = m_mask.spec();
+    *size = 4 + 4 + spec.size() + 8 + 8;
+    uint8_t *buffer = new uint8_t[*size];
+    writeUint32(buffer, KeyspacePool::MASK);
+    writeUint32(buffer + 4, static_cast<uint32_t>(spec.size()));
+    memcpy(buffer + 8, spec.data(), spec.size());
+    writeUint64(buffer + 8 + spec.size(), m_firstPool);
+    writeUint64(buffer + 16 + spec.size(), m_poolCount);
+    return buffer;
+  }
+
+  void MaskKeyspacePool::deserialize(const uint8_t *buffer, size_t size, bool &done)
+  {
+    done = false;
+    if(size < 8 || readUint32(buffer) != KeyspacePool::MASK)
+      return;
+    size_t specSize = readUint32(buffer + 4);
+    if(size - 8 < specSize + 16)
+      return;
+    // a recycled pool of the same mask is not parsed again, which would
+    // allocate
+    const std::string &current = m_mask.spec();
+    if(specSize != current.size() || memcmp(buffer + 8, current.data(), specSize) != 0)
+    {
+      std::string spec(reinterpret_cast<const char*>(buffer + 8), specSize);
+      if(!m_mask.parse(spec))
+      {
+        Logger::error("Received a pool with the invalid mask \"%s\"", spec.c_str());
+        return;
+      }
+    }
+    m_firstPool = readUint64(buffer + 8 + specSize);
+    m_poolCount = readUint64(buffer + 16 + specSize);
+    m_nextIndex = m_firstPool * MaskKeyspace::POOL_SIZE;
+    m_keyLength = 0;
+    done = true;
+  }
+}
@@ -0,0 +1,135 @@
+/*******************************************************************************
+ * Copyright 2012 Jonathan Glines <auntieNeo@gmail.com>                        *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ ******************************************************************************/
+
+#ifndef MASK_KEYSPACE_H_
+#define MASK_KEYSPACE_H_
+
+#include "keyspace.h"
+#include "keyMask.h"
+#include "poolTracker.h"
+
+namespace TripRipper
+{
+  /**
+   * The MaskKeyspace class describes a mapping onto the keys that match a
+   * KeyMask. Where LinearKeyspace walks every byte value of every position,
+   * most of which cannot be typed into a form, a mask only produces keys made
+   * of the characters that are wanted at each position, so every tripcode
+   * computed is one that can be used.
+   *
+   * Pools are consecutive ranges of POOL_SIZE key indices of the mask, so a
+   * pool is fully determined by its index, and the mapping supports
+   * createPool().
+   */
+  class MaskKeyspace : public KeyspaceMapping
+  {
+    public:
+      /**
+       * The number of keys in each pool. The last pool may be smaller.
+       */
+      static const uint64_t POOL_SIZE = 1 << 20;
+
+      MaskKeyspace();
+      ~MaskKeyspace();
+
+      bool setMask(const std::string &spec);
+      const KeyMask &mask() const { return m_mask; }
+
+      uint64_t totalPools();
+      uint64_t poolsLeft();
+      size_t poolSize();
+      KeyspacePool *checkoutNextPool();
+      KeyspacePool *checkoutPools(uint64_t poolCount);
+      KeyspacePool *createPool(uint64_t firstPool, uint64_t poolCount);
+      void checkinPool(KeyspacePool *pool);
+      void abandonPool(KeyspacePool *pool);
+      PoolTracker *poolTracker() { return &m_tracker; }
+
+      size_t serialSize() const;
+      void serialize(unsigned char *buffer, size_t size, bool &done) const;
+      void deserialize(const unsigned char *buffer, size_t size, bool &done);
+
+    private:
+      KeyMask m_mask;
+      PoolTracker m_tracker;
+  };
+
+  /**
+   * The MaskKeyspacePool implements a KeyspacePool for MaskKeyspace. The
+   * mask travels with the pool, so ranks do not need the mapping to generate
+   * its keys.
+   */
+  class MaskKeyspacePool : public KeyspacePool
+  {
+    friend class MaskKeyspace;
+
+    public:
+      /**
+       * The number of keys in each KeyBlock, unless set otherwise with
+       * setBlockKeys().
+       */
+      static const size_t BLOCK_KEYS = 4096;
+
+      MaskKeyspacePool();
+      MaskKeyspacePool(const KeyMask &mask, uint64_t firstPool, uint64_t poolCount);
+      ~MaskKeyspacePool();
+
+      /**
+       * Returns the index of the first pool covered by this object.
+       */
+      uint64_t firstPool() const { return m_firstPool; }
+      uint64_t poolCount() { return m_poolCount; }
+      KeyspacePool *splitPool(uint64_t poolCount);
+
+      size_t blockSize();
+      void setBlockKeys(size_t blockKeys) { m_blockKeys = blockKeys > 0 ? blockKeys : BLOCK_KEYS; }
+      size_t outputAlignment() { return m_outputAlignment; }
+      void setOutputAlignment(size_t alignment) { m_outputAlignment = alignment; }
+      size_t outputStride() { return m_outputStride; }
+      void setOutputStride(size_t stride) { m_outputStride = stride; }
+      bool outputPackHighBit() { return m_outputPackHighBit; }
+      void setOutputPackHighBit(bool packHighBit) { m_outputPackHighBit = packHighBit; }
+
+      KeyBlock *getNextBlock();
+
+      uint8_t *serialize(size_t *size) const;
+
+    protected:
+      void deserialize(const uint8_t *buffer, size_t size, bool &done);
+
+    private:
+      KeyMask m_mask;
+      uint64_t m_firstPool, m_poolCount;
+      size_t m_blockKeys;
+      size_t m_outputAlignment, m_outputStride;
+      bool m_outputPackHighBit;
+
+      // the state of the iteration over the keys of the pool
+      KeyBlock m_block;
+      uint64_t m_nextIndex;
+      size_t m_keyLength;
+      uint8_t m_key[KeyBlock::KEY_SIZE];
+      size_t m_digits[KeyBlock::KEY_SIZE];
+  };
+}
+
+#endif
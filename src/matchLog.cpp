@@ -0,0 +1,529 @@
+/*******************************************************************************
+ * Copyright 2012 Jonathan Glines <auntieNeo@gmail.com>                        *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ ******************************************************************************/
+
+#include "matchLog.h"
+#include "checkpoint.h"
+#include "logger.h"
+#include "serialization.h"
+#include "tripcodeSearchResult.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace TripRipper
+{
+  const char MatchLog::MAGIC[8] = { 'T', 'R', 'I', 'P', 'M', 'L', 'O', 'G' };
+  const char MatchLog::INDEX_MAGIC[8] = { 'T', 'R', 'I', 'P', 'M', 'I', 'D', 'X' };
+  const size_t MatchLog::WINDOW_SIZE;
+
+  /**
+   * An entry of the index, which refers to a record of the log by its
+   * number. The tripcode is repeated in the entry so that the binary search
+   * only touches the index.
+   */
+  struct IndexEntry
+  {
+    uint8_t tripcode[TripcodeSearchResult::TRIPCODE_SIZE];
+    uint8_t record[8];
+  };
+
+  /**
+   * Orders index entries by tripcode, and then by the key of the record they
+   * refer to, so that duplicate matches end up next to each other.
+   */
+  class IndexOrder
+  {
+    public:
+      IndexOrder(const uint8_t *records) : m_records(records) { }
+
+      bool operator()(const IndexEntry &a, const IndexEntry &b) const
+      {
+        int order = memcmp(a.tripcode, b.tripcode, sizeof(a.tripcode));
+        if(order != 0)
+          return order < 0;
+        return memcmp(key(a), key(b), TripcodeSearchResult::KEY_SIZE) < 0;
+      }
+
+      bool equal(const IndexEntry &a, const IndexEntry &b) const
+      {
+        return memcmp(a.tripcode, b.tripcode, sizeof(a.tripcode)) == 0 &&
+          memcmp(key(a), key(b), TripcodeSearchResult::KEY_SIZE) == 0;
+      }
+
+      const uint8_t *key(const IndexEntry &entry) const
+      {
+        return m_records + readUint64(entry.record) * TripcodeSearchResult::RECORD_SIZE;
+      }
+
+    private:
+      const uint8_t *m_records;
+  };
+
+  /**
+   * Orders index entries by tripcode alone, for lookups.
+   */
+  static bool tripcodeLess(const IndexEntry &a, const IndexEntry &b)
+  {
+    return memcmp(a.tripcode, b.tripcode, sizeof(a.tripcode)) < 0;
+  }
+
+  /**
+   * The MatchLog constructor opens the log at path, creating it if it does
+   * not exist. Matches are appended to an existing log, which is what a
+   * resumed search wants. The index is kept at path with ".idx" appended,
+   * and the ledger of appended logs with ".merged" appended.
+   */
+  MatchLog::MatchLog(const std::string &path) :
+    m_path(path),
+    m_indexPath(path + ".idx"),
+    m_ledgerPath(path + ".merged"),
+    m_size(0),
+    m_syncedSize(0),
+    m_window(NULL),
+    m_windowOffset(0),
+    m_windowSize(0)
+  {
+    m_file = open(m_path.c_str(), O_RDWR | O_CREAT, 0644);
+    if(m_file < 0)
+    {
+      Logger::error("Could not open match log %s: %s", m_path.c_str(), strerror(errno));
+      return;
+    }
+
+    struct stat status;
+    uint8_t header[HEADER_SIZE];
+    if(fstat(m_file, &status) != 0)
+    {
+      Logger::error("Could not open match log %s: %s", m_path.c_str(), strerror(errno));
+    }
+    else if(status.st_size == 0)
+    {
+      // a new log, which has had no other logs appended yet
+      writeHeader();
+      unlink(m_ledgerPath.c_str());
+      return;
+    }
+    else if(static_cast<size_t>(status.st_size) < HEADER_SIZE ||
+        pread(m_file, header, HEADER_SIZE, 0) != static_cast<ssize_t>(HEADER_SIZE) ||
+        memcmp(header, MAGIC, sizeof(MAGIC)) != 0 || readUint32(header + 8) != VERSION)
+    {
+      Logger::error("Match log %s is not a match log of this version", m_path.c_str());
+    }
+    else
+    {
+      // records past the end of the file were never completely written
+      uint64_t records = (status.st_size - HEADER_SIZE) / TripcodeSearchResult::RECORD_SIZE;
+      m_size = std::min(readUint64(header + 16), records);
+      m_syncedSize = m_size;
+      return;
+    }
+    close(m_file);
+    m_file = -1;
+  }
+
+  /**
+   * Returns true if the file at path is a match log, without creating it.
+   */
+  bool MatchLog::isMatchLog(const std::string &path)
+  {
+    int file = open(path.c_str(), O_RDONLY);
+    if(file < 0)
+      return false;
+    uint8_t header[HEADER_SIZE];
+    bool isLog = pread(file, header, HEADER_SIZE, 0) == static_cast<ssize_t>(HEADER_SIZE) &&
+      memcmp(header, MAGIC, sizeof(MAGIC)) == 0;
+    close(file);
+    return isLog;
+  }
+
+  /**
+   * Syncs the log and trims the slack that the last window left at the end
+   * of the file.
+   */
+  MatchLog::~MatchLog()
+  {
+    if(m_file < 0)
+      return;
+    sync();
+    unmapWindow();
+    if(ftruncate(m_file, HEADER_SIZE + m_size * TripcodeSearchResult::RECORD_SIZE) != 0)
+      Logger::error("Could not trim match log %s: %s", m_path.c_str(), strerror(errno));
+    close(m_file);
+  }
+
+  /**
+   * Appends the given results to the log. They reach the disk, and are
+   * counted by the header, with the next sync().
+   */
+  void MatchLog::append(const TripcodeSearchResult &results)
+  {
+    if(results.empty())
+      return;
+    // records are contiguous in TripcodeSearchResult
+    appendRecords(results.record(0), results.size());
+  }
+
+  /**
+   * Appends the records of the match log at path to this log, such as the
+   * matches of a shard of the search that ran elsewhere. Returns false if
+   * the log at path could not be read.
+   *
+   * Logs are appended to, so a log that was appended before may have grown
+   * since. The ledger holds the checksum and number of the records of each
+   * log appended, and if the first records of the log at path match an
+   * entry, only the records after them are appended. The ledger is written
+   * once the records are synced, so a crash in between only appends them
+   * twice, and the index drops such duplicates.
+   */
+  bool MatchLog::appendLog(const std::string &path)
+  {
+    if(m_file < 0 || !isMatchLog(path))
+      return false;
+    MatchLog other(path);
+    if(!other.isOpen())
+      return false;
+
+    // the entries of the ledger, each the checksum and then the number of
+    // the records appended, ordered by the number of records
+    std::vector<std::pair<uint64_t, uint64_t> > entries;
+    int ledger = open(m_ledgerPath.c_str(), O_RDWR | O_CREAT | O_APPEND, 0644);
+    if(ledger < 0)
+    {
+      Logger::error("Could not open match log ledger %s: %s", m_ledgerPath.c_str(), strerror(errno));
+      return false;
+    }
+    uint8_t entry[16];
+    // a torn entry at the end is ignored
+    for(off_t offset = 0; pread(ledger, entry, sizeof(entry), offset) == static_cast<ssize_t>(sizeof(entry)); offset += sizeof(entry))
+    {
+      if(readUint64(entry + 8) <= other.size())
+        entries.push_back(std::make_pair(readUint64(entry + 8), readUint64(entry)));
+    }
+    std::sort(entries.begin(), entries.end());
+
+    // find the most records the log was appended with before
+    const uint64_t CHUNK_RECORDS = WINDOW_SIZE / TripcodeSearchResult::RECORD_SIZE;
+    std::vector<uint8_t> buffer(CHUNK_RECORDS * TripcodeSearchResult::RECORD_SIZE);
+    uint64_t record = 0, hash = Checkpoint::CHECKSUM_BASIS;
+    uint64_t appended = 0, appendedHash = hash;
+    bool read = true;
+    for(size_t i = 0; read && i < entries.size(); ++i)
+    {
+      while(read && record < entries[i].first)
+      {
+        uint64_t count = std::min(CHUNK_RECORDS, entries[i].first - record);
+        read = other.readRecords(record, count, &buffer[0]);
+        hash = Checkpoint::checksum(&buffer[0], count * TripcodeSearchResult::RECORD_SIZE, hash);
+        record += count;
+      }
+      if(read && hash == entries[i].second)
+      {
+        appended = record;
+        appendedHash = hash;
+      }
+    }
+
+    // append the rest
+    hash = appendedHash;
+    for(record = appended; read && record < other.size(); record += CHUNK_RECORDS)
+    {
+      uint64_t count = std::min(CHUNK_RECORDS, other.size() - record);
+      read = other.readRecords(record, count, &buffer[0]);
+      if(read)
+      {
+        hash = Checkpoint::checksum(&buffer[0], count * TripcodeSearchResult::RECORD_SIZE, hash);
+        appendRecords(&buffer[0], count);
+      }
+    }
+    if(!read)
+    {
+      Logger::error("Could not read match log %s: %s", path.c_str(), strerror(errno));
+      close(ledger);
+      return false;
+    }
+    if(appended > 0)
+    {
+      Logger::info("%s: %llu of %llu matches were merged before", path.c_str(),
+          static_cast<unsigned long long>(appended), static_cast<unsigned long long>(other.size()));
+    }
+
+    if(other.size() > appended)
+    {
+      sync();
+      writeUint64(entry, hash);
+      writeUint64(entry + 8, other.size());
+      if(write(ledger, entry, sizeof(entry)) != static_cast<ssize_t>(sizeof(entry)) || fdatasync(ledger) != 0)
+        Logger::warning("Could not write match log ledger %s: %s", m_ledgerPath.c_str(), strerror(errno));
+    }
+    close(ledger);
+    return true;
+  }
+
+  /**
+   * Reads count records of the log, starting with the record numbered
+   * first, into buffer. Returns false if they could not be read.
+   */
+  bool MatchLog::readRecords(uint64_t first, uint64_t count, uint8_t *buffer) const
+  {
+    size_t size = count * TripcodeSearchResult::RECORD_SIZE;
+    return pread(m_file, buffer, size, HEADER_SIZE + first * TripcodeSearchResult::RECORD_SIZE) == static_cast<ssize_t>(size);
+  }
+
+  /**
+   * Copies count records to the end of the log. Only the size held in
+   * memory is advanced; the header is left to sync().
+   */
+  void MatchLog::appendRecords(const uint8_t *records, uint64_t count)
+  {
+    if(m_file < 0)
+      return;
+
+    size_t size = count * TripcodeSearchResult::RECORD_SIZE;
+    uint64_t offset = HEADER_SIZE + m_size * TripcodeSearchResult::RECORD_SIZE;
+    while(size > 0)
+    {
+      if(!mapWindow(offset, 1))
+        return;
+      size_t length = std::min(size, static_cast<size_t>(m_windowOffset + m_windowSize - offset));
+      memcpy(m_window + (offset - m_windowOffset), records, length);
+      records += length;
+      size -= length;
+      offset += length;
+    }
+    m_size += count;
+  }
+
+  /**
+   * Writes the records appended since the last sync to disk, and then the
+   * header that counts them. The records are synced before the header is
+   * written, since the page cache may write back the header, which is
+   * written with pwrite(), before the pages of the mapping otherwise, and a
+   * crash in between would leave the header counting records that were
+   * never written.
+   */
+  void MatchLog::sync()
+  {
+    if(m_file < 0 || m_size == m_syncedSize)
+      return;
+    if((m_window != NULL && msync(m_window, m_windowSize, MS_SYNC) != 0) || fdatasync(m_file) != 0)
+    {
+      Logger::error("Could not write match log %s: %s", m_path.c_str(), strerror(errno));
+      return;
+    }
+    writeHeader();
+    fdatasync(m_file);
+    m_syncedSize = m_size;
+  }
+
+  /**
+   * Writes the index of the log, replacing any previous index. Returns false
+   * if the index could not be written.
+   */
+  bool MatchLog::buildIndex()
+  {
+    if(m_file < 0)
+      return false;
+    sync();
+
+    size_t logSize = HEADER_SIZE + m_size * TripcodeSearchResult::RECORD_SIZE;
+    void *logMap = mmap(NULL, logSize, PROT_READ, MAP_SHARED, m_file, 0);
+    if(logMap == MAP_FAILED)
+    {
+      Logger::error("Could not map match log %s: %s", m_path.c_str(), strerror(errno));
+      return false;
+    }
+    const uint8_t *records = static_cast<const uint8_t*>(logMap) + HEADER_SIZE;
+
+    std::string tempPath = m_indexPath + ".tmp";
+    size_t indexSize = INDEX_HEADER_SIZE + m_size * sizeof(IndexEntry);
+    int file = open(tempPath.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    void *indexMap = MAP_FAILED;
+    if(file >= 0 && ftruncate(file, indexSize) == 0)
+      indexMap = mmap(NULL, indexSize, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+    if(indexMap == MAP_FAILED)
+    {
+      Logger::error("Could not create match index %s: %s", tempPath.c_str(), strerror(errno));
+      if(file >= 0)
+        close(file);
+      munmap(logMap, logSize);
+      return false;
+    }
+
+    uint8_t *data = static_cast<uint8_t*>(indexMap);
+    IndexEntry *entries = reinterpret_cast<IndexEntry*>(data + INDEX_HEADER_SIZE);
+    for(uint64_t i = 0; i < m_size; ++i)
+    {
+      memcpy(entries[i].tripcode, records + i * TripcodeSearchResult::RECORD_SIZE + TripcodeSearchResult::KEY_SIZE, sizeof(entries[i].tripcode));
+      writeUint64(entries[i].record, i);
+    }
+    IndexOrder order(records);
+    std::sort(entries, entries + m_size, order);
+    uint64_t distinct = 0;
+    for(uint64_t i = 0; i < m_size; ++i)
+    {
+      if(distinct == 0 || !order.equal(entries[distinct - 1], entries[i]))
+        entries[distinct++] = entries[i];
+    }
+
+    memcpy(data, INDEX_MAGIC, sizeof(INDEX_MAGIC));
+    writeUint32(data + 8, VERSION);
+    writeUint32(data + 12, 0);
+    writeUint64(data + 16, m_size);
+    writeUint64(data + 24, distinct);
+    bool synced = msync(indexMap, indexSize, MS_SYNC) == 0;
+    munmap(indexMap, indexSize);
+    munmap(logMap, logSize);
+    synced = synced && ftruncate(file, INDEX_HEADER_SIZE + distinct * sizeof(IndexEntry)) == 0 && fsync(file) == 0;
+    close(file);
+    if(!synced || rename(tempPath.c_str(), m_indexPath.c_str()) != 0)
+    {
+      Logger::error("Could not write match index %s: %s", m_indexPath.c_str(), strerror(errno));
+      return false;
+    }
+    return true;
+  }
+
+  /**
+   * Appends every distinct match of the given tripcode to results, and
+   * returns the number of matches found. The index is rebuilt first if it
+   * does not cover the whole log.
+   */
+  size_t MatchLog::find(const std::string &tripcode, TripcodeSearchResult *results)
+  {
+    if(m_file < 0 || tripcode.size() != TripcodeSearchResult::TRIPCODE_SIZE)
+      return 0;
+
+    for(int attempt = 0; attempt < 2; ++attempt)
+    {
+      int file = open(m_indexPath.c_str(), O_RDONLY);
+      struct stat status;
+      void *indexMap = MAP_FAILED;
+      size_t indexSize = 0;
+      if(file >= 0 && fstat(file, &status) == 0 && static_cast<size_t>(status.st_size) >= INDEX_HEADER_SIZE)
+      {
+        indexSize = status.st_size;
+        indexMap = mmap(NULL, indexSize, PROT_READ, MAP_SHARED, file, 0);
+      }
+      if(file >= 0)
+        close(file);
+
+      const uint8_t *data = static_cast<const uint8_t*>(indexMap);
+      if(indexMap == MAP_FAILED || memcmp(data, INDEX_MAGIC, sizeof(INDEX_MAGIC)) != 0 ||
+          readUint32(data + 8) != VERSION || readUint64(data + 16) != m_size ||
+          readUint64(data + 24) > (indexSize - INDEX_HEADER_SIZE) / sizeof(IndexEntry))
+      {
+        // the index is missing or stale
+        if(indexMap != MAP_FAILED)
+          munmap(indexMap, indexSize);
+        if(attempt > 0 || !buildIndex())
+          return 0;
+        continue;
+      }
+
+      size_t logSize = HEADER_SIZE + m_size * TripcodeSearchResult::RECORD_SIZE;
+      void *logMap = mmap(NULL, logSize, PROT_READ, MAP_SHARED, m_file, 0);
+      if(logMap == MAP_FAILED)
+      {
+        munmap(indexMap, indexSize);
+        return 0;
+      }
+      const uint8_t *records = static_cast<const uint8_t*>(logMap) + HEADER_SIZE;
+
+      const IndexEntry *entries = reinterpret_cast<const IndexEntry*>(data + INDEX_HEADER_SIZE);
+      const IndexEntry *end = entries + readUint64(data + 24);
+      IndexEntry wanted;
+      memcpy(wanted.tripcode, tripcode.data(), sizeof(wanted.tripcode));
+      size_t found = 0;
+      for(const IndexEntry *entry = std::lower_bound(entries, end, wanted, tripcodeLess);
+          entry != end && !tripcodeLess(wanted, *entry); ++entry)
+      {
+        const char *key = reinterpret_cast<const char*>(records + readUint64(entry->record) * TripcodeSearchResult::RECORD_SIZE);
+        results->insert(std::string(key, strnlen(key, TripcodeSearchResult::KEY_SIZE)), tripcode);
+        ++found;
+      }
+      munmap(logMap, logSize);
+      munmap(indexMap, indexSize);
+      return found;
+    }
+    return 0;
+  }
+
+  /**
+   * Makes sure that the size bytes at the given offset of the file are
+   * mapped, moving the window if needed and growing the file to cover it.
+   */
+  bool MatchLog::mapWindow(uint64_t offset, size_t size)
+  {
+    if(m_window != NULL && offset >= m_windowOffset && offset + size <= m_windowOffset + m_windowSize)
+      return true;
+    unmapWindow();
+
+    uint64_t pageSize = sysconf(_SC_PAGESIZE);
+    uint64_t windowOffset = offset / pageSize * pageSize;
+    size_t windowSize = std::max(static_cast<size_t>(offset + size - windowOffset), WINDOW_SIZE);
+    struct stat status;
+    if(fstat(m_file, &status) != 0 ||
+        (static_cast<uint64_t>(status.st_size) < windowOffset + windowSize && ftruncate(m_file, windowOffset + windowSize) != 0))
+    {
+      Logger::error("Could not grow match log %s: %s", m_path.c_str(), strerror(errno));
+      return false;
+    }
+    void *map = mmap(NULL, windowSize, PROT_READ | PROT_WRITE, MAP_SHARED, m_file, windowOffset);
+    if(map == MAP_FAILED)
+    {
+      Logger::error("Could not map match log %s: %s", m_path.c_str(), strerror(errno));
+      return false;
+    }
+    m_window = static_cast<uint8_t*>(map);
+    m_windowOffset = windowOffset;
+    m_windowSize = windowSize;
+    return true;
+  }
+
+  void MatchLog::unmapWindow()
+  {
+    if(m_window == NULL)
+      return;
+    munmap(m_window, m_windowSize);
+    m_window = NULL;
+  }
+
+  /**
+   * Writes the header with the current number of records.
+   */
+  void MatchLog::writeHeader()
+  {
+    uint8_t header[HEADER_SIZE];
+    memcpy(header, MAGIC, sizeof(MAGIC));
+    writeUint32(header + 8, VERSION);
+    writeUint32(header + 12, 0);
+    writeUint64(header + 16, m_size);
+    if(pwrite(m_file, header, HEADER_SIZE, 0) != static_cast<ssize_t>(HEADER_SIZE))
+      Logger::error("Could not write match log %s: %s", m_path.c_str(), strerror(errno));
+  }
+}
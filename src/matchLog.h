@@ -0,0 +1,102 @@
+/*******************************************************************************
+ * Copyright 2012 Jonathan Glines <auntieNeo@gmail.com>                        *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ ******************************************************************************/
+
+#ifndef MATCH_LOG_H_
+#define MATCH_LOG_H_
+
+#include "common.h"
+
+namespace TripRipper
+{
+  class TripcodeSearchResult;
+
+  /**
+   * The MatchLog class is an append-only file of matches that the root
+   * streams results into, so that the number of matches a search can produce
+   * is not limited by the memory of the root.
+   *
+   * The log file holds a header followed by the fixed size records of
+   * TripcodeSearchResult. Records are appended through a shared memory
+   * mapping of a window of WINDOW_SIZE bytes at the end of the file, which
+   * is moved along as the log grows, so the memory used by the log stays
+   * bounded no matter how large it gets. Appending never waits for the disk;
+   * sync() writes the records, and only then advances the number of records
+   * in the header over them, so a crash leaves a valid log behind.
+   *
+   * buildIndex() writes a sorted index next to the log, with one entry per
+   * distinct match ordered by tripcode, which find() searches with a binary
+   * search. Since the index is built by sorting a memory mapping of the index
+   * file in place, building it takes no memory beyond the page cache either.
+   * Duplicate matches, such as those found again after a search is resumed
+   * or by a speculative lease, are dropped from the index.
+   *
+   * appendLog() records each log it appends in a ledger next to the log, by
+   * the checksum and number of the records appended, so that appending a
+   * log again only appends the records it gained since.
+   */
+  class MatchLog
+  {
+    public:
+      MatchLog(const std::string &path);
+      ~MatchLog();
+
+      static bool isMatchLog(const std::string &path);
+
+      bool isOpen() const { return m_file >= 0; }
+      const std::string &path() const { return m_path; }
+
+      /**
+       * Returns the number of records in the log, including duplicates.
+       */
+      uint64_t size() const { return m_size; }
+
+      void append(const TripcodeSearchResult &results);
+      bool appendLog(const std::string &path);
+      void sync();
+
+      bool buildIndex();
+      size_t find(const std::string &tripcode, TripcodeSearchResult *results);
+
+    private:
+      static const char MAGIC[8];
+      static const char INDEX_MAGIC[8];
+      static const uint32_t VERSION = 1;
+      static const size_t HEADER_SIZE = 8 + 4 + 4 + 8;
+      static const size_t INDEX_HEADER_SIZE = 8 + 4 + 4 + 8 + 8;
+      static const size_t WINDOW_SIZE = 16 * 1024 * 1024;
+
+      void appendRecords(const uint8_t *records, uint64_t count);
+      bool readRecords(uint64_t first, uint64_t count, uint8_t *buffer) const;
+      bool mapWindow(uint64_t offset, size_t size);
+      void unmapWindow();
+      void writeHeader();
+
+      std::string m_path, m_indexPath, m_ledgerPath;
+      int m_file;
+      uint64_t m_size, m_syncedSize;
+      uint8_t *m_window;
+      uint64_t m_windowOffset;
+      size_t m_windowSize;
+  };
+}
+
+#endif
@@ -0,0 +1,220 @@
+/*******************************************************************************
+ * Copyright 2012 Jonathan Glines <auntieNeo@gmail.com>                        *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ ******************************************************************************/
+
+#include "nodeDispatcher.h"
+#include "keyspace.h"
+
+#include <algorithm>
+
+namespace TripRipper
+{
+  /**
+   * The NodeDispatcher constructor takes the communicator of the ranks on the
+   * node, in which the calling process must have rank 0. The communicator is
+   * not owned by the NodeDispatcher.
+   */
+  NodeDispatcher::NodeDispatcher(MPI_Comm nodeComm) :
+    m_nodeComm(nodeComm),
+    m_requester(MPI_COMM_WORLD, ROOT_RANK),
+    m_lease(NULL),
+    m_exhausted(false),
+    m_ranksFinished(0),
+    m_outstanding(0)
+  {
+    MPI_Comm_size(m_nodeComm, &m_nodeSize);
+    m_searching.resize(m_nodeSize, false);
+  }
+
+  NodeDispatcher::~NodeDispatcher()
+  {
+    delete m_lease;
+  }
+
+  /**
+   * Returns a pool for the leader itself to search, leasing more of the
+   * keyspace from the root if needed, which means that the pool the leader
+   * took last has been searched. The caller assumes ownership of the
+   * returned pool. Returns NULL once the keyspace has been exhausted.
+   *
+   * If the lease has been handed out but other ranks are still searching
+   * it, this blocks answering their requests until they are done.
+   */
+  KeyspacePool *NodeDispatcher::checkoutPool()
+  {
+    subPoolDone(0);
+    serviceRequests();
+    dispatchWaiting();
+    while(mustWait())
+    {
+      MPI_Status status;
+      MPI_Probe(MPI_ANY_SOURCE, MPI_ANY_TAG, m_nodeComm, &status);
+      PoolRequester::receiveRequest(m_nodeComm, status, &m_results);
+      respond(status.MPI_SOURCE);
+    }
+    return takeSubPool(0);
+  }
+
+  /**
+   * Answers any pending requests for pools from the local ranks without
+   * blocking on new requests. This is meant to be called between KeyBlocks.
+   */
+  void NodeDispatcher::serviceRequests()
+  {
+    int pending;
+    MPI_Status status;
+    // requests arrive as either KEYSPACE_REQUEST or POOL_EXHAUSTED_RESULT
+    MPI_Iprobe(MPI_ANY_SOURCE, MPI_ANY_TAG, m_nodeComm, &pending, &status);
+    while(pending)
+    {
+      PoolRequester::receiveRequest(m_nodeComm, status, &m_results);
+      respond(status.MPI_SOURCE);
+      MPI_Iprobe(MPI_ANY_SOURCE, MPI_ANY_TAG, m_nodeComm, &pending, &status);
+    }
+  }
+
+  /**
+   * Blocks answering requests from the local ranks until every local rank
+   * has been told that the keyspace is exhausted. The leader calls this once
+   * checkoutPool() has returned NULL.
+   */
+  void NodeDispatcher::finish()
+  {
+    dispatchWaiting();
+    while(m_ranksFinished < m_nodeSize - 1)
+    {
+      MPI_Status status;
+      MPI_Probe(MPI_ANY_SOURCE, MPI_ANY_TAG, m_nodeComm, &status);
+      PoolRequester::receiveRequest(m_nodeComm, status, &m_results);
+      respond(status.MPI_SOURCE);
+    }
+  }
+
+  /**
+   * Drops what is left of the current lease and makes a last request to the
+   * root, which delivers the collected results and is answered with a
+   * TERMINATION_REQUEST. The leader calls this once it has learned that the
+   * search has been stopped. The root abandons the lease rather than
+   * checking it in, so this does not wait for sub-pools being searched.
+   */
+  void NodeDispatcher::stop()
+  {
+    delete m_lease;
+    m_lease = NULL;
+    refill();
+    assert(m_lease == NULL);
+  }
+
+  /**
+   * Records that the given rank of the node has searched the sub-pool it
+   * took last, if any.
+   */
+  void NodeDispatcher::subPoolDone(int nodeRank)
+  {
+    if(m_searching[nodeRank])
+    {
+      m_searching[nodeRank] = false;
+      --m_outstanding;
+    }
+  }
+
+  /**
+   * Removes a guided share of the current lease and returns it for the given
+   * rank of the node to search, leasing more of the keyspace from the root
+   * when the current lease has been handed out entirely. The caller must
+   * make sure that mustWait() is false.
+   */
+  KeyspacePool *NodeDispatcher::takeSubPool(int nodeRank)
+  {
+    assert(!mustWait());
+    if(m_lease == NULL)
+      refill();
+    if(m_lease == NULL)
+      return NULL;
+
+    uint64_t count = std::max(m_lease->poolCount() / (static_cast<uint64_t>(GUIDED_DIVISOR) * m_nodeSize), static_cast<uint64_t>(1));
+    KeyspacePool *pool = m_lease->splitPool(count);
+    if(pool == NULL)
+    {
+      // hand out what is left of the lease
+      pool = m_lease;
+      m_lease = NULL;
+    }
+    m_searching[nodeRank] = true;
+    ++m_outstanding;
+    return pool;
+  }
+
+  /**
+   * Leases more of the keyspace from the root, sending along the results
+   * collected so far, which checks in the previous lease. This blocks until
+   * the root responds.
+   */
+  void NodeDispatcher::refill()
+  {
+    assert(m_lease == NULL);
+    if(m_exhausted)
+      return;
+
+    m_lease = m_requester.requestPool(m_results);
+    m_results.clear();
+    if(m_lease == NULL)
+      m_exhausted = true;
+  }
+
+  /**
+   * Answers the request of the given local rank, which has searched its
+   * previous sub-pool, as soon as a sub-pool can be taken for it.
+   */
+  void NodeDispatcher::respond(int nodeRank)
+  {
+    subPoolDone(nodeRank);
+    m_waiting.push_back(nodeRank);
+    dispatchWaiting();
+  }
+
+  /**
+   * Sends a sub-pool to each waiting local rank, or an empty response if the
+   * keyspace has been exhausted or the search has been stopped, for as long
+   * as no rank must wait for the lease to be searched.
+   */
+  void NodeDispatcher::dispatchWaiting()
+  {
+    while(!m_waiting.empty() && !mustWait())
+    {
+      int nodeRank = m_waiting.front();
+      m_waiting.pop_front();
+      KeyspacePool *pool = takeSubPool(nodeRank);
+      if(pool == NULL)
+      {
+        int tag = m_requester.terminated() ? TERMINATION_REQUEST : KEYSPACE_RESPONSE;
+        MPI_Send(NULL, 0, MPI_BYTE, nodeRank, tag, m_nodeComm);
+        ++m_ranksFinished;
+        continue;
+      }
+      size_t poolDataSize;
+      uint8_t *poolData = pool->serialize(&poolDataSize);
+      MPI_Send(poolData, static_cast<int>(poolDataSize), MPI_BYTE, nodeRank, KEYSPACE_RESPONSE, m_nodeComm);
+      delete[] poolData;
+      delete pool;
+    }
+  }
+}
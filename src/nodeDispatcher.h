@@ -0,0 +1,118 @@
+/*******************************************************************************
+ * Copyright 2012 Jonathan Glines <auntieNeo@gmail.com>                        *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ ******************************************************************************/
+
+#ifndef NODE_DISPATCHER_H_
+#define NODE_DISPATCHER_H_
+
+#include "common.h"
+#include "poolRequester.h"
+#include "tripcodeSearchResult.h"
+
+#include <deque>
+#include <mpi.h>
+
+namespace TripRipper
+{
+  class KeyspacePool;
+
+  /**
+   * The NodeDispatcher class implements the node leader of the hierarchical
+   * dispatch scheme. Rather than having every rank request pools from the
+   * root over the network, the ranks on each node request pools from a
+   * leader on the same node, which leases large pools from the root and
+   * splits them with KeyspacePool::splitPool(). Since the node communicator
+   * is created with MPI_COMM_TYPE_SHARED, traffic between the leader and its
+   * ranks stays within shared memory, and the amount of traffic that the
+   * root handles grows with the number of nodes rather than the number of
+   * cores.
+   *
+   * The leader uses the same KEYSPACE_REQUEST and KEYSPACE_RESPONSE protocol
+   * towards its local ranks that the root uses, so local ranks do not need to
+   * know whether they are talking to a leader or to the root. Because the root
+   * sizes leases by throughput, the lease a leader receives naturally grows
+   * with the number of ranks on its node.
+   *
+   * The leader is a compute rank as well. It services local requests between
+   * KeyBlocks with serviceRequests(), and draws its own pools from the lease
+   * with checkoutPool().
+   *
+   * Results that local ranks send with their requests, and results the
+   * leader adds with addResults(), are collected and sent to the root along
+   * with the next request for a lease. Whatever has been collected when the
+   * keyspace is exhausted is left in results() for the final gather.
+   *
+   * When the search is stopped early, the leader calls stop() and then
+   * finish(). The root's TERMINATION_REQUEST is passed on to the local
+   * ranks.
+   *
+   * The root considers a lease checked in once the leader asks for the next
+   * one, so the leader only does so once every sub-pool of the lease has
+   * been searched. A request from a local rank means that its previous
+   * sub-pool has been searched, and so does the leader drawing its next
+   * pool. Ranks that ask while the lease has been handed out, but not
+   * searched entirely, wait for the next lease. The leader waits with them
+   * and services their requests, so at the end of each lease the node is
+   * idle for at most the time it takes to search its smallest sub-pools.
+   */
+  class NodeDispatcher
+  {
+    public:
+      NodeDispatcher(MPI_Comm nodeComm);
+      ~NodeDispatcher();
+
+      KeyspacePool *checkoutPool();
+      void serviceRequests();
+      void finish();
+      void stop();
+
+      void addResults(const TripcodeSearchResult &results) { m_results.merge(results); }
+      const TripcodeSearchResult &results() const { return m_results; }
+
+    private:
+      static const int GUIDED_DIVISOR = 2;
+
+      bool mustWait() const { return m_lease == NULL && m_outstanding > 0 && !m_exhausted; }
+      void subPoolDone(int nodeRank);
+      KeyspacePool *takeSubPool(int nodeRank);
+      void refill();
+      void respond(int nodeRank);
+      void dispatchWaiting();
+
+      MPI_Comm m_nodeComm;
+      PoolRequester m_requester;
+      TripcodeSearchResult m_results;
+      int m_nodeSize;
+      KeyspacePool *m_lease;
+      bool m_exhausted;
+      // number of local ranks that have been told there are no pools left
+      int m_ranksFinished;
+      // which ranks of the node are searching a sub-pool of the current
+      // lease, and how many
+      std::vector<bool> m_searching;
+      int m_outstanding;
+      // local ranks that asked for a pool while the lease could not be
+      // checked in yet
+      std::deque<int> m_waiting;
+  };
+}
+
+#endif
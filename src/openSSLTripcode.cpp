@@ -20,7 +20,14 @@
  * DEALINGS IN THE SOFTWARE.                                                   *
  ******************************************************************************/
 
+#include "keyspace.h"
 #include "openSSLTripcode.h"
+#include "tripcodeContainer.h"
+
+#define OPENSSL_SUPPRESS_DEPRECATED
+#include <openssl/des.h>
+
+#include <cstring>
 
 namespace TripRipper
 {
@@ -32,8 +39,23 @@ namespace TripRipper
   {
   }
 
+  /**
+   * Computes tripcodes one key at a time with DES_fcrypt(), which is
+   * equivalent to crypt(3). The tripcode is the last ten characters of the
+   * hash.
+   */
   void OpenSSLTripcode::computeTripcodes(const KeyBlock *keys, TripcodeContainer *results)
   {
-    assert(false);  // FIXME
+    char key[KeyBlock::KEY_SIZE + 1];
+    char salt[3];
+    char hash[14];
+    key[KeyBlock::KEY_SIZE] = '\0';
+    for(size_t i = 0; i < keys->numKeys(); ++i)
+    {
+      memcpy(key, keys->key(i), KeyBlock::KEY_SIZE);
+      computeSalt(key, salt);
+      DES_fcrypt(key, salt, hash);
+      results->insert(hash + 3, key);
+    }
   }
 }
@@ -37,13 +37,10 @@ namespace TripRipper
       OpenSSLTripcode();
       ~OpenSSLTripcode();
 
-<<<<<<< HEAD
-=======
       size_t inputAlignment() const { return 1; }
       size_t inputStride() const { return 1; }
       bool inputPackHighBit() const { return false; }
 
->>>>>>> e5d84716872796480dee88415710fe9b15bf7cee
       void computeTripcodes(const KeyBlock *keys, TripcodeContainer *results);
   };
 }
@@ -0,0 +1,150 @@
+/*******************************************************************************
+ * Copyright 2012 Jonathan Glines <auntieNeo@gmail.com>                        *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ ******************************************************************************/
+
+#include "perfCounters.h"
+
+#include <cstdio>
+#include <cstring>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+
+namespace TripRipper
+{
+  PerfCounters::PerfCounters() :
+    m_leader(-1)
+  {
+    for(int i = 0; i < NUM_COUNTERS; ++i)
+      m_fds[i] = -1;
+#ifdef __linux__
+    static const uint32_t TYPES[NUM_COUNTERS] = {
+      PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE, PERF_TYPE_HW_CACHE, PERF_TYPE_HARDWARE
+    };
+    static const uint64_t CONFIGS[NUM_COUNTERS] = {
+      PERF_COUNT_HW_CPU_CYCLES,
+      PERF_COUNT_HW_INSTRUCTIONS,
+      PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+      PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+      PERF_COUNT_HW_BRANCH_MISSES
+    };
+    for(int i = 0; i < NUM_COUNTERS; ++i)
+    {
+      struct perf_event_attr attr;
+      memset(&attr, 0, sizeof(attr));
+      attr.size = sizeof(attr);
+      attr.type = TYPES[i];
+      attr.config = CONFIGS[i];
+      // only the leader is enabled and disabled, which the group follows
+      attr.disabled = m_leader < 0 ? 1 : 0;
+      attr.exclude_kernel = 1;
+      attr.exclude_hv = 1;
+      attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+      m_fds[i] = syscall(__NR_perf_event_open, &attr, 0, -1, m_leader < 0 ? -1 : m_fds[m_leader], 0);
+      if(m_fds[i] >= 0 && m_leader < 0)
+        m_leader = i;
+    }
+#endif
+  }
+
+  PerfCounters::~PerfCounters()
+  {
+    for(int i = 0; i < NUM_COUNTERS; ++i)
+    {
+      if(m_fds[i] >= 0)
+        close(m_fds[i]);
+    }
+  }
+
+  void PerfCounters::start()
+  {
+#ifdef __linux__
+    if(m_leader >= 0)
+      ioctl(m_fds[m_leader], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+#endif
+  }
+
+  void PerfCounters::stop()
+  {
+#ifdef __linux__
+    if(m_leader >= 0)
+      ioctl(m_fds[m_leader], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+#endif
+  }
+
+  /**
+   * Sets every count back to 0.
+   */
+  void PerfCounters::reset()
+  {
+#ifdef __linux__
+    if(m_leader >= 0)
+      ioctl(m_fds[m_leader], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+#endif
+  }
+
+  /**
+   * Reads the count of each Counter since the last reset() into counts,
+   * scaled up if the group was multiplexed. Unsupported counters read 0.
+   */
+  void PerfCounters::read(uint64_t counts[NUM_COUNTERS]) const
+  {
+    for(int i = 0; i < NUM_COUNTERS; ++i)
+      counts[i] = 0;
+    if(m_leader < 0)
+      return;
+    // the number of events, the times enabled and running, then the events
+    // in the order they were opened
+    uint64_t values[3 + NUM_COUNTERS];
+    ssize_t size = ::read(m_fds[m_leader], values, sizeof(values));
+    if(size < static_cast<ssize_t>(3 * sizeof(uint64_t)) || values[2] == 0)
+      return;
+    double scale = static_cast<double>(values[1]) / values[2];
+    uint64_t event = 0;
+    for(int i = 0; i < NUM_COUNTERS && event < values[0]; ++i)
+    {
+      if(m_fds[i] >= 0)
+        counts[i] = static_cast<uint64_t>(values[3 + event++] * scale);
+    }
+  }
+
+  /**
+   * Returns a line describing the given counts for the given number of keys,
+   * as instructions per cycle and events per key.
+   */
+  std::string PerfCounters::describe(const uint64_t counts[NUM_COUNTERS], uint64_t keys)
+  {
+    if(counts[CYCLES] == 0 || keys == 0)
+      return "no counts";
+    char line[256];
+    snprintf(line, sizeof(line), "IPC %.2f, per key: %.1f cycles, %.3f L1D misses, %.4f LLC misses, %.3f branch misses",
+        static_cast<double>(counts[INSTRUCTIONS]) / counts[CYCLES],
+        static_cast<double>(counts[CYCLES]) / keys,
+        static_cast<double>(counts[L1D_MISSES]) / keys,
+        static_cast<double>(counts[LLC_MISSES]) / keys,
+        static_cast<double>(counts[BRANCH_MISSES]) / keys);
+    return line;
+  }
+}
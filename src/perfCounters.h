@@ -0,0 +1,73 @@
+/*******************************************************************************
+ * Copyright 2012 Jonathan Glines <auntieNeo@gmail.com>                        *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ ******************************************************************************/
+
+#ifndef PERF_COUNTERS_H_
+#define PERF_COUNTERS_H_
+
+#include "common.h"
+
+namespace TripRipper
+{
+  /**
+   * The PerfCounters class counts hardware events of the calling thread with
+   * perf_event_open(2) over the regions of code between start() and stop(),
+   * such as the calls to TripcodeAlgorithm::computeTripcodes() or
+   * MatchingAlgorithm::matchTripcodes(). The events are the ones that tell a
+   * kernel bound by its instructions or register spills apart from one bound
+   * by memory or by mispredicted branches: cycles, instructions, L1 data
+   * cache read misses, last level cache read misses and branch misses.
+   *
+   * The events are opened as a single group, so they are counted over exactly
+   * the same instructions. Events that the CPU or kernel doesn't support are
+   * left out, and if the kernel multiplexes the group with other events, the
+   * counts are scaled up to the whole time the group was enabled. Starting
+   * and stopping the counters costs a system call each, so regions should be
+   * a KeyBlock rather than a key.
+   *
+   * If perf_event_open(2) is unavailable, e.g. because of
+   * /proc/sys/kernel/perf_event_paranoid or on systems other than Linux,
+   * available() returns false and every count is 0.
+   */
+  class PerfCounters
+  {
+    public:
+      enum Counter { CYCLES, INSTRUCTIONS, L1D_MISSES, LLC_MISSES, BRANCH_MISSES, NUM_COUNTERS };
+
+      PerfCounters();
+      ~PerfCounters();
+
+      bool available() const { return m_leader >= 0; }
+      void start();
+      void stop();
+      void reset();
+      void read(uint64_t counts[NUM_COUNTERS]) const;
+
+      static std::string describe(const uint64_t counts[NUM_COUNTERS], uint64_t keys);
+
+    private:
+      // the file descriptor of each event, or -1 where it is unsupported
+      int m_fds[NUM_COUNTERS];
+      int m_leader;
+  };
+}
+
+#endif
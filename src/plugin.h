@@ -0,0 +1,76 @@
+/*******************************************************************************
+ * Copyright 2012 Jonathan Glines <auntieNeo@gmail.com>                        *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ ******************************************************************************/
+
+#ifndef PLUGIN_H_
+#define PLUGIN_H_
+
+#include "strategyFactory.h"
+#include "matchingAlgorithm.h"
+#include "tripcodeAlgorithm.h"
+
+/**
+ * The version of the plugin interface, which is checked when a plugin is
+ * loaded. It must be incremented whenever the classes that plugins derive
+ * from or pass across the interface change, such as TripcodeAlgorithm,
+ * MatchingAlgorithm, KeyBlock and TripcodeContainer.
+ */
+#define TRIPRIPPER_PLUGIN_VERSION 2
+
+#define TRIPRIPPER_PLUGIN_EXPORT extern "C" __attribute__((visibility("default")))
+
+/**
+ * A plugin is a shared object that registers tripcode and matching
+ * algorithms with the StrategyFactory when it is loaded. Its source uses
+ * this macro once, with a function that takes the StrategyFactory and calls
+ * StrategyFactory::registerTripcodeAlgorithm() and
+ * StrategyFactory::registerMatchingAlgorithm(). For example:
+ *
+ * \code
+ * static TripRipper::TripcodeAlgorithm *createFastTripcode()
+ * {
+ *   return new FastTripcode;
+ * }
+ *
+ * static void registerFastTripcode(TripRipper::StrategyFactory *factory)
+ * {
+ *   factory->registerTripcodeAlgorithm("fast-avx2", createFastTripcode);
+ * }
+ *
+ * TRIPRIPPER_PLUGIN(registerFastTripcode)
+ * \endcode
+ *
+ * Plugins should be compiled with -fvisibility=hidden, so that the classes
+ * they build for a particular microarchitecture are not resolved to the
+ * copies in the executable or in other plugins. The name of a plugin file
+ * lists the CPU features it needs; see StrategyFactory::pluginSupported().
+ */
+#define TRIPRIPPER_PLUGIN(registerFunction) \
+  TRIPRIPPER_PLUGIN_EXPORT int tripRipperPluginVersion() \
+  { \
+    return TRIPRIPPER_PLUGIN_VERSION; \
+  } \
+  TRIPRIPPER_PLUGIN_EXPORT void tripRipperRegisterPlugin(TripRipper::StrategyFactory *factory) \
+  { \
+    registerFunction(factory); \
+  }
+
+#endif
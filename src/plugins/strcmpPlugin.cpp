@@ -0,0 +1,49 @@
+/*******************************************************************************
+ * Copyright 2012 Jonathan Glines <auntieNeo@gmail.com>                        *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ ******************************************************************************/
+
+#include "plugin.h"
+#include "strcmpMatching.h"
+
+// PLUGIN_VARIANT names the microarchitecture the plugin is built for
+#define STRINGIFY(x) #x
+#define VARIANT_NAME(x) STRINGIFY(x)
+
+namespace TripRipper
+{
+  static MatchingAlgorithm *createStrcmpMatching()
+  {
+    return new StrcmpMatching;
+  }
+
+  /**
+   * Registers the strcmp matching algorithm as built for PLUGIN_VARIANT, as
+   * "strcmp-" followed by the variant, e.g. "strcmp-avx2". This plugin
+   * serves as an example of building the same kernels for several
+   * microarchitectures.
+   */
+  static void registerStrcmpPlugin(StrategyFactory *factory)
+  {
+    factory->registerMatchingAlgorithm(std::string("strcmp-") + VARIANT_NAME(PLUGIN_VARIANT), createStrcmpMatching);
+  }
+}
+
+TRIPRIPPER_PLUGIN(TripRipper::registerStrcmpPlugin)
@@ -0,0 +1,160 @@
+/*******************************************************************************
+ * Copyright 2012 Jonathan Glines <auntieNeo@gmail.com>                        *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ ******************************************************************************/
+
+#include "poolRequester.h"
+#include "keyspace.h"
+#include "keyspaceFactory.h"
+#include "tripcodeSearchResult.h"
+#include "tracer.h"
+
+#include <algorithm>
+
+namespace TripRipper
+{
+  /**
+   * The PoolRequester constructor takes the communicator and the rank within
+   * it that pools are requested from.
+   */
+  PoolRequester::PoolRequester(MPI_Comm comm, int source) :
+    m_comm(comm),
+    m_source(source),
+    m_terminated(false),
+    m_sendRequest(MPI_REQUEST_NULL),
+    m_sendBuffer(NULL),
+    m_sendBufferSize(0)
+  {
+  }
+
+  /**
+   * Waits for the last request to be sent.
+   */
+  PoolRequester::~PoolRequester()
+  {
+    MPI_Wait(&m_sendRequest, MPI_STATUS_IGNORE);
+    delete[] m_sendBuffer;
+  }
+
+  /**
+   * Sends the results of the pool that was last returned, which is thereby
+   * checked in, and blocks until the next pool is received. The caller
+   * assumes ownership of the returned pool. Returns NULL if the keyspace is
+   * exhausted or the search has been stopped.
+   *
+   * The requester takes ownership of recycled, the pool that was searched
+   * last, which is reused for the next pool if it is of the same type, so
+   * that a worker receives pools without allocating.
+   */
+  KeyspacePool *PoolRequester::requestPool(const TripcodeSearchResult &results, KeyspacePool *recycled)
+  {
+    // the previous request has long been answered, so this rarely waits
+    MPI_Wait(&m_sendRequest, MPI_STATUS_IGNORE);
+
+    TRIPRIPPER_TRACE_BEGIN(RESULT_SEND);
+    // the buffer is sized for as many results as the container has room
+    // for, even before there are any, so it only grows with the container
+    size_t size = results.serialSize();
+    if(size > m_sendBufferSize || m_sendBuffer == NULL)
+    {
+      delete[] m_sendBuffer;
+      m_sendBufferSize = std::max(size, results.serialCapacity());
+      m_sendBuffer = new uint8_t[m_sendBufferSize];
+    }
+    if(results.empty())
+    {
+      MPI_Isend(NULL, 0, MPI_BYTE, m_source, KEYSPACE_REQUEST, m_comm, &m_sendRequest);
+    }
+    else
+    {
+      bool done;
+      results.serialize(m_sendBuffer, size, done);
+      assert(done);
+      MPI_Isend(m_sendBuffer, static_cast<int>(size), MPI_BYTE, m_source, POOL_EXHAUSTED_RESULT, m_comm, &m_sendRequest);
+    }
+    TRIPRIPPER_TRACE_END(RESULT_SEND);
+
+    // recieve the serialized KeyspacePool object, or the request to stop
+    MPI_Status status;
+    TRIPRIPPER_TRACE_BEGIN(POOL_REQUEST);
+    MPI_Probe(m_source, MPI_ANY_TAG, m_comm, &status);
+    TRIPRIPPER_TRACE_END(POOL_REQUEST);
+    if(status.MPI_TAG == TERMINATION_REQUEST)
+    {
+      MPI_Recv(NULL, 0, MPI_BYTE, m_source, TERMINATION_REQUEST, m_comm, &status);
+      m_terminated = true;
+      delete recycled;
+      return NULL;
+    }
+    assert(status.MPI_TAG == KEYSPACE_RESPONSE);
+    TRIPRIPPER_TRACE_BEGIN(POOL_RECEIVE);
+    int poolDataSize;
+    MPI_Get_count(&status, MPI_BYTE, &poolDataSize);
+    // the buffer only grows, so pools of one size are received without
+    // allocating
+    if(static_cast<size_t>(poolDataSize) > m_receiveBuffer.size())
+      m_receiveBuffer.resize(poolDataSize);
+    MPI_Recv(m_receiveBuffer.empty() ? NULL : &m_receiveBuffer[0], poolDataSize, MPI_BYTE, m_source, KEYSPACE_RESPONSE, m_comm, &status);
+
+    KeyspacePool *pool = NULL;
+    // an empty response means the keyspace has been exhausted
+    if(poolDataSize > 0)
+    {
+      pool = KeyspaceFactory::deserializeKeyspacePool(&m_receiveBuffer[0], poolDataSize, recycled);
+      // the pool cannot be searched, and cannot be mistaken for the end of
+      // the keyspace either
+      if(pool == NULL)
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+    else
+    {
+      delete recycled;
+    }
+    TRIPRIPPER_TRACE_END(POOL_RECEIVE);
+    return pool;
+  }
+
+  /**
+   * Receives the request that was found with MPI_Probe() or MPI_Iprobe() on
+   * comm, and appends any results it carries to results. The requesting rank
+   * is given by probed.MPI_SOURCE.
+   */
+  void PoolRequester::receiveRequest(MPI_Comm comm, const MPI_Status &probed, TripcodeSearchResult *results)
+  {
+    MPI_Status status;
+    if(probed.MPI_TAG == KEYSPACE_REQUEST)
+    {
+      MPI_Recv(NULL, 0, MPI_BYTE, probed.MPI_SOURCE, KEYSPACE_REQUEST, comm, &status);
+      return;
+    }
+
+    assert(probed.MPI_TAG == POOL_EXHAUSTED_RESULT);
+    int size;
+    MPI_Get_count(&probed, MPI_BYTE, &size);
+    uint8_t *buffer = new uint8_t[size];
+    MPI_Recv(buffer, size, MPI_BYTE, probed.MPI_SOURCE, POOL_EXHAUSTED_RESULT, comm, &status);
+    TripcodeSearchResult received;
+    bool done;
+    received.deserialize(buffer, size, done);
+    assert(done);
+    results->merge(received);
+    delete[] buffer;
+  }
+}
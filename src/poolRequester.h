@@ -0,0 +1,77 @@
+/*******************************************************************************
+ * Copyright 2012 Jonathan Glines <auntieNeo@gmail.com>                        *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ ******************************************************************************/
+
+#ifndef POOL_REQUESTER_H_
+#define POOL_REQUESTER_H_
+
+#include "common.h"
+
+#include <mpi.h>
+
+namespace TripRipper
+{
+  class KeyspacePool;
+  class TripcodeSearchResult;
+
+  /**
+   * The PoolRequester class implements the requesting side of the keyspace
+   * request protocol, which is used by workers towards the root or their
+   * node leader, and by node leaders towards the root.
+   *
+   * A request for a pool also checks in the pool that the requesting rank
+   * searched last, if any. When that pool produced results, the request is a
+   * POOL_EXHAUSTED_RESULT message carrying the serialized
+   * TripcodeSearchResult, so the results, the check-in and the request for
+   * the next pool travel in a single message. Otherwise the request is an
+   * empty KEYSPACE_REQUEST message. Requests are sent with MPI_Isend(), and
+   * are only waited on before the next request reuses the send buffer. The response is a
+   * KEYSPACE_RESPONSE message carrying a serialized KeyspacePool, or an empty
+   * KEYSPACE_RESPONSE message once the keyspace is exhausted. If the search
+   * is stopped early, the response is an empty TERMINATION_REQUEST message
+   * instead, after which terminated() returns true.
+   *
+   * receiveRequest() implements the receiving side for the root and node
+   * leaders.
+   */
+  class PoolRequester
+  {
+    public:
+      PoolRequester(MPI_Comm comm, int source);
+      ~PoolRequester();
+
+      KeyspacePool *requestPool(const TripcodeSearchResult &results, KeyspacePool *recycled = NULL);
+      bool terminated() const { return m_terminated; }
+
+      static void receiveRequest(MPI_Comm comm, const MPI_Status &probed, TripcodeSearchResult *results);
+
+    private:
+      MPI_Comm m_comm;
+      int m_source;
+      bool m_terminated;
+      MPI_Request m_sendRequest;
+      uint8_t *m_sendBuffer;
+      size_t m_sendBufferSize;
+      std::vector<uint8_t> m_receiveBuffer;
+  };
+}
+
+#endif
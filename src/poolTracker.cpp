@@ -0,0 +1,162 @@
+/*******************************************************************************
+ * Copyright 2012 Jonathan Glines <auntieNeo@gmail.com>                        *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ ******************************************************************************/
+
+#include "poolTracker.h"
+#include "serialization.h"
+
+#include <algorithm>
+
+namespace TripRipper
+{
+  PoolTracker::PoolTracker(uint64_t totalPools) :
+    m_totalPools(totalPools)
+  {
+  }
+
+  PoolTracker::~PoolTracker()
+  {
+  }
+
+  /**
+   * Checks out up to maxPools contiguous pools that have been neither
+   * searched nor checked out, starting with the lowest such pool. The range
+   * checked out is returned in firstPool and poolCount. Returns false if
+   * every pool has been claimed.
+   */
+  bool PoolTracker::checkout(uint64_t maxPools, uint64_t *firstPool, uint64_t *poolCount)
+  {
+    assert(maxPools > 0);
+    uint64_t first = m_claimed.firstGap(0);
+    if(first >= m_totalPools)
+      return false;
+    uint64_t end = std::min(m_claimed.nextRange(first), m_totalPools);
+    uint64_t count = std::min(maxPools, end - first);
+    m_claimed.insert(first, first + count);
+    *firstPool = first;
+    *poolCount = count;
+    return true;
+  }
+
+  /**
+   * Marks the given range of pools as searched. Checking in pools that have
+   * already been checked in has no effect, so the first of several
+   * speculative copies of a lease to be checked in wins.
+   */
+  void PoolTracker::checkin(uint64_t firstPool, uint64_t poolCount)
+  {
+    assert(firstPool + poolCount <= m_totalPools);
+    m_completed.insert(firstPool, firstPool + poolCount);
+    m_claimed.insert(firstPool, firstPool + poolCount);
+  }
+
+  /**
+   * Returns the given range of checked out pools to the set of unsearched
+   * pools. Any part of the range that has been searched in the meantime stays
+   * searched.
+   */
+  void PoolTracker::abandon(uint64_t firstPool, uint64_t poolCount)
+  {
+    assert(firstPool + poolCount <= m_totalPools);
+    m_claimed.erase(firstPool, firstPool + poolCount);
+    m_claimed.copyRange(m_completed, firstPool, firstPool + poolCount);
+  }
+
+  /**
+   * Marks every pool outside of the range [begin, end) as searched, so that
+   * only the pools of that range are checked out.
+   */
+  void PoolTracker::restrict(uint64_t begin, uint64_t end)
+  {
+    assert(begin <= end && end <= m_totalPools);
+    checkin(0, begin);
+    checkin(end, m_totalPools - end);
+  }
+
+  /**
+   * Marks the pools of the range [begin, end) that have been searched
+   * according to other as searched in this tracker as well.
+   */
+  void PoolTracker::merge(const PoolTracker &other, uint64_t begin, uint64_t end)
+  {
+    assert(end <= m_totalPools);
+    m_completed.copyRange(other.m_completed, begin, end);
+    m_claimed.copyRange(other.m_completed, begin, end);
+  }
+
+  /**
+   * Returns the end of the shortest range starting at from that holds count
+   * pools which have not been searched, or totalPools() if there are fewer
+   * than count such pools after from.
+   */
+  uint64_t PoolTracker::skipUnsearched(uint64_t from, uint64_t count) const
+  {
+    while(count > 0)
+    {
+      uint64_t first = m_completed.firstGap(from);
+      if(first >= m_totalPools)
+        return m_totalPools;
+      uint64_t end = std::min(m_completed.nextRange(first), m_totalPools);
+      uint64_t taken = std::min(count, end - first);
+      from = first + taken;
+      count -= taken;
+    }
+    return from;
+  }
+
+  /**
+   * Returns the size in bytes of the serial representation of the tracker.
+   */
+  size_t PoolTracker::serialSize() const
+  {
+    return 8 + m_completed.serialSize();
+  }
+
+  /**
+   * Writes the total number of pools followed by the set of searched pools.
+   * Pools that are checked out are not recorded, so they are treated as
+   * abandoned when the tracker is deserialized. The buffer must be at least
+   * serialSize() bytes.
+   */
+  void PoolTracker::serialize(uint8_t *buffer) const
+  {
+    writeUint64(buffer, m_totalPools);
+    m_completed.serialize(buffer + 8);
+  }
+
+  /**
+   * Replaces the state of the tracker with the state serialized in buffer,
+   * and returns the number of bytes read, or 0 if buffer does not hold a
+   * complete serialized tracker, in which case the tracker is left as it
+   * was.
+   */
+  size_t PoolTracker::deserialize(const uint8_t *buffer, size_t size)
+  {
+    RangeSet completed;
+    size_t read = size < 8 ? 0 : completed.deserialize(buffer + 8, size - 8);
+    if(read == 0)
+      return 0;
+    m_totalPools = readUint64(buffer);
+    m_completed = completed;
+    m_claimed = m_completed;
+    return 8 + read;
+  }
+}
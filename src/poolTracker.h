@@ -0,0 +1,77 @@
+/*******************************************************************************
+ * Copyright 2012 Jonathan Glines <auntieNeo@gmail.com>                        *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ ******************************************************************************/
+
+#ifndef POOL_TRACKER_H_
+#define POOL_TRACKER_H_
+
+#include "common.h"
+#include "rangeSet.h"
+
+namespace TripRipper
+{
+  /**
+   * The PoolTracker class keeps track of which pools of a KeyspaceMapping
+   * have been checked out and which have been checked in, for mappings whose
+   * pools are identified by an index. It implements the bookkeeping behind
+   * KeyspaceMapping::checkoutNextPool(), KeyspaceMapping::checkinPool() and
+   * KeyspaceMapping::abandonPool() so that mappings can share it.
+   *
+   * Two RangeSet objects are kept: the pools that have been searched, and the
+   * pools that have been claimed, i.e. searched or currently checked out.
+   * Since both sets coalesce into runs, their size grows with the number of
+   * leases in flight rather than with the size of the keyspace. The next pool
+   * to check out is simply the first gap in the claimed set.
+   */
+  class PoolTracker
+  {
+    public:
+      PoolTracker(uint64_t totalPools);
+      ~PoolTracker();
+
+      uint64_t totalPools() const { return m_totalPools; }
+      uint64_t poolsLeft() const { return m_totalPools - m_completed.count(); }
+      uint64_t poolsCheckedOut() const { return m_claimed.count() - m_completed.count(); }
+
+      bool checkout(uint64_t maxPools, uint64_t *firstPool, uint64_t *poolCount);
+      void checkin(uint64_t firstPool, uint64_t poolCount);
+      void abandon(uint64_t firstPool, uint64_t poolCount);
+
+      void restrict(uint64_t begin, uint64_t end);
+      void merge(const PoolTracker &other, uint64_t begin, uint64_t end);
+      uint64_t skipUnsearched(uint64_t from, uint64_t count) const;
+
+      /**
+       * The set of pools that have been searched.
+       */
+      const RangeSet &completed() const { return m_completed; }
+
+      size_t serialSize() const;
+      void serialize(uint8_t *buffer) const;
+      size_t deserialize(const uint8_t *buffer, size_t size);
+
+    private:
+      uint64_t m_totalPools;
+      RangeSet m_completed, m_claimed;
+  };
+}
+
+#endif
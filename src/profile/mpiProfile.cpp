@@ -0,0 +1,262 @@
+/*******************************************************************************
+ * Copyright 2012 Jonathan Glines <auntieNeo@gmail.com>                        *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ ******************************************************************************/
+
+#include "mpiProfile.h"
+
+#include <cstring>
+#include <vector>
+
+namespace TripRipper
+{
+  static const char *TAG_NAMES[MpiProfile::NUM_TAGS] = {
+    "other", "KEYSPACE_REQUEST", "KEYSPACE_RESPONSE", "POOL_EXHAUSTED_RESULT", "TERMINATION_REQUEST",
+    "TERMINATION_NOTICE"
+  };
+
+  const int MpiProfile::Histogram::BUCKETS;
+
+  void MpiProfile::Histogram::add(uint64_t value)
+  {
+    int bucket = 0;
+    for(uint64_t v = value; v > 0; v >>= 1)
+      ++bucket;
+    ++counts[bucket];
+    ++count;
+    sum += value;
+    if(value > max)
+      max = value;
+  }
+
+  void MpiProfile::Histogram::merge(const Histogram &other)
+  {
+    for(int i = 0; i < BUCKETS; ++i)
+      counts[i] += other.counts[i];
+    count += other.count;
+    sum += other.sum;
+    if(other.max > max)
+      max = other.max;
+  }
+
+  /**
+   * Returns an upper bound of the given fraction of the values, the top of
+   * the bucket that holds it.
+   */
+  uint64_t MpiProfile::Histogram::percentile(double fraction) const
+  {
+    uint64_t seen = 0;
+    for(int i = 0; i < BUCKETS; ++i)
+    {
+      seen += counts[i];
+      if(counts[i] > 0 && seen >= fraction * count)
+      {
+        uint64_t top = i == 0 ? 0 : (i == 64 ? ~0ULL : (1ULL << i) - 1);
+        return top < max ? top : max;
+      }
+    }
+    return max;
+  }
+
+  MpiProfile *MpiProfile::singleton()
+  {
+    static MpiProfile instance;
+    return &instance;
+  }
+
+  MpiProfile::MpiProfile()
+  {
+    memset(&m_stats, 0, sizeof(m_stats));
+  }
+
+  void MpiProfile::sent(MPI_Comm comm, int dest, int tag, uint64_t bytes, double now)
+  {
+    TagStats &stats = m_stats.tags[tagIndex(tag)];
+    ++stats.sends;
+    stats.sizes.add(bytes);
+
+    Peer peer(comm, dest);
+    if(tag == KEYSPACE_REQUEST || tag == POOL_EXHAUSTED_RESULT)
+    {
+      m_requested[peer] = now;
+    }
+    else if(tag == KEYSPACE_RESPONSE || tag == TERMINATION_REQUEST)
+    {
+      std::map<Peer, double>::iterator request = m_serving.find(peer);
+      if(request != m_serving.end())
+      {
+        m_stats.serviceTimes.add(static_cast<uint64_t>((now - request->second) * 1e6));
+        m_serving.erase(request);
+      }
+    }
+  }
+
+  void MpiProfile::received(MPI_Comm comm, int source, int tag, uint64_t bytes, double seconds, double now)
+  {
+    TagStats &stats = m_stats.tags[tagIndex(tag)];
+    ++stats.receives;
+    stats.receiveSeconds += seconds;
+
+    Peer peer(comm, source);
+    if(tag == KEYSPACE_REQUEST || tag == POOL_EXHAUSTED_RESULT)
+    {
+      m_stats.queueDepths.add(m_serving.size());
+      m_serving[peer] = now;
+      m_clients.insert(peer);
+    }
+    else if(tag == KEYSPACE_RESPONSE || tag == TERMINATION_REQUEST)
+    {
+      std::map<Peer, double>::iterator request = m_requested.find(peer);
+      if(request != m_requested.end())
+      {
+        m_stats.roundTrips.add(static_cast<uint64_t>((now - request->second) * 1e6));
+        m_requested.erase(request);
+      }
+    }
+    (void)bytes;
+  }
+
+  /**
+   * Counts the time spent in MPI_Probe() against the tag of the message it
+   * found.
+   */
+  void MpiProfile::probed(int tag, double seconds)
+  {
+    m_stats.tags[tagIndex(tag)].probeSeconds += seconds;
+  }
+
+  /**
+   * Counts a call to MPI_Iprobe(), whose time is counted against the tag of
+   * the message it found, if any, like that of MPI_Probe().
+   */
+  void MpiProfile::iprobed(bool found, int tag, double seconds)
+  {
+    ++m_stats.iprobes;
+    if(found)
+    {
+      ++m_stats.iprobeHits;
+      probed(tag, seconds);
+    }
+    else
+    {
+      m_stats.iprobeSeconds += seconds;
+    }
+  }
+
+  void MpiProfile::printHistogram(FILE *out, const Histogram &histogram, const char *unit)
+  {
+    for(int i = 0; i < Histogram::BUCKETS; ++i)
+    {
+      if(histogram.counts[i] == 0)
+        continue;
+      uint64_t low = i == 0 ? 0 : 1ULL << (i - 1);
+      uint64_t high = i == 0 ? 0 : (i == 64 ? ~0ULL : (1ULL << i) - 1);
+      int bar = static_cast<int>(50 * histogram.counts[i] / histogram.count);
+      fprintf(out, "  %10llu - %-10llu %s %10llu  %.*s\n",
+          static_cast<unsigned long long>(low), static_cast<unsigned long long>(high), unit,
+          static_cast<unsigned long long>(histogram.counts[i]), bar,
+          "##################################################");
+    }
+  }
+
+  /**
+   * Gathers the statistics of every rank of comm on root, which prints them
+   * to out. Every rank must call this.
+   */
+  void MpiProfile::report(MPI_Comm comm, int root, FILE *out, double now)
+  {
+    int rank, size;
+    PMPI_Comm_rank(comm, &rank);
+    PMPI_Comm_size(comm, &size);
+    m_stats.elapsed = now - m_stats.start;
+    m_stats.clients = m_clients.size();
+
+    std::vector<Stats> all(rank == root ? size : 0);
+    PMPI_Gather(&m_stats, sizeof(Stats), MPI_BYTE, rank == root ? &all[0] : NULL, sizeof(Stats), MPI_BYTE, root, comm);
+    if(rank != root)
+      return;
+
+    Stats total;
+    memset(&total, 0, sizeof(total));
+    for(int r = 0; r < size; ++r)
+    {
+      for(int t = 0; t < NUM_TAGS; ++t)
+      {
+        total.tags[t].sends += all[r].tags[t].sends;
+        total.tags[t].receives += all[r].tags[t].receives;
+        total.tags[t].sizes.merge(all[r].tags[t].sizes);
+        total.tags[t].probeSeconds += all[r].tags[t].probeSeconds;
+        total.tags[t].receiveSeconds += all[r].tags[t].receiveSeconds;
+      }
+      total.iprobes += all[r].iprobes;
+      total.iprobeHits += all[r].iprobeHits;
+      total.iprobeSeconds += all[r].iprobeSeconds;
+      total.roundTrips.merge(all[r].roundTrips);
+      if(all[r].elapsed > total.elapsed)
+        total.elapsed = all[r].elapsed;
+    }
+
+    fprintf(out, "MPI profile of %d ranks over %.2f s\n", size, total.elapsed);
+    fprintf(out, "  %-22s %10s %10s %12s %10s %10s %10s\n", "tag", "sends", "receives", "mean bytes", "max bytes", "probe s", "recv s");
+    for(int t = 1; t <= NUM_TAGS; ++t)
+    {
+      // the other tags go last
+      const TagStats &stats = total.tags[t % NUM_TAGS];
+      if(stats.sends == 0 && stats.receives == 0)
+        continue;
+      fprintf(out, "  %-22s %10llu %10llu %12.1f %10llu %10.3f %10.3f\n", TAG_NAMES[t % NUM_TAGS],
+          static_cast<unsigned long long>(stats.sends), static_cast<unsigned long long>(stats.receives),
+          stats.sizes.mean(), static_cast<unsigned long long>(stats.sizes.max),
+          stats.probeSeconds, stats.receiveSeconds);
+    }
+    fprintf(out, "  MPI_Iprobe: %llu calls, %llu found a message, %.3f s finding none\n",
+        static_cast<unsigned long long>(total.iprobes), static_cast<unsigned long long>(total.iprobeHits),
+        total.iprobeSeconds);
+
+    if(total.roundTrips.count > 0)
+    {
+      fprintf(out, "Request round trips: %llu, mean %.1f us, median <= %llu us, 99%% <= %llu us, max %llu us\n",
+          static_cast<unsigned long long>(total.roundTrips.count), total.roundTrips.mean(),
+          static_cast<unsigned long long>(total.roundTrips.percentile(0.5)),
+          static_cast<unsigned long long>(total.roundTrips.percentile(0.99)),
+          static_cast<unsigned long long>(total.roundTrips.max));
+      printHistogram(out, total.roundTrips, "us");
+    }
+
+    // requests that wait for pools to be checked in count as busy time, so
+    // the capacity estimates are conservative
+    for(int r = 0; r < size; ++r)
+    {
+      const Stats &stats = all[r];
+      if(stats.serviceTimes.count == 0)
+        continue;
+      double busy = stats.elapsed > 0.0 ? stats.serviceTimes.sum / 1e6 / stats.elapsed : 0.0;
+      fprintf(out, "Rank %d served %llu ranks: %llu requests, service mean %.1f us, 99%% <= %llu us, "
+          "queue depth mean %.2f max %llu, busy %.2f%%",
+          r, static_cast<unsigned long long>(stats.clients), static_cast<unsigned long long>(stats.serviceTimes.count),
+          stats.serviceTimes.mean(), static_cast<unsigned long long>(stats.serviceTimes.percentile(0.99)),
+          stats.queueDepths.mean(), static_cast<unsigned long long>(stats.queueDepths.max), 100.0 * busy);
+      if(busy > 0.0)
+        fprintf(out, ", saturated at about %.0f ranks", stats.clients / busy);
+      fprintf(out, "\n");
+    }
+    fflush(out);
+  }
+}
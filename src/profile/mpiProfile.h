@@ -0,0 +1,128 @@
+/*******************************************************************************
+ * Copyright 2012 Jonathan Glines <auntieNeo@gmail.com>                        *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ ******************************************************************************/
+
+#ifndef MPI_PROFILE_H_
+#define MPI_PROFILE_H_
+
+#include "common.h"
+
+#include <cstdio>
+#include <map>
+#include <set>
+#include <utility>
+
+#include <mpi.h>
+
+namespace TripRipper
+{
+  /**
+   * The MpiProfile class collects the statistics of the PMPI profiling
+   * layer, which intercepts the point to point calls of the keyspace request
+   * protocol; see pmpi.cpp. Messages are grouped by MessageTag, with every
+   * other tag counted as "other".
+   *
+   * On the requesting side, the time from sending a KEYSPACE_REQUEST or
+   * POOL_EXHAUSTED_RESULT to receiving the KEYSPACE_RESPONSE or
+   * TERMINATION_REQUEST from the same rank is a round trip. On the serving
+   * side, the root or a node leader, the time from receiving a request to
+   * answering it is its service time, and the number of requests received
+   * but not yet answered when another arrives is the queue depth. Requests
+   * that MPI has not delivered yet are not seen, so the depth is a lower
+   * bound, and the round trips include the time spent in that queue.
+   *
+   * report() gathers the statistics of every rank and prints them, along
+   * with an estimate of how many ranks each serving rank could answer before
+   * it was busy all the time: the number of ranks it served divided by the
+   * fraction of the time it spent answering them.
+   *
+   * The statistics are not locked, so only one thread of each rank may make
+   * the intercepted calls.
+   */
+  class MpiProfile
+  {
+    public:
+      enum { OTHER_TAG = 0, NUM_TAGS = TERMINATION_NOTICE + 1 };
+
+      static MpiProfile *singleton();
+
+      void start(double now) { m_stats.start = now; }
+      void sent(MPI_Comm comm, int dest, int tag, uint64_t bytes, double now);
+      void received(MPI_Comm comm, int source, int tag, uint64_t bytes, double seconds, double now);
+      void probed(int tag, double seconds);
+      void iprobed(bool found, int tag, double seconds);
+
+      void report(MPI_Comm comm, int root, FILE *out, double now);
+
+    private:
+      /**
+       * Counts values in buckets of powers of two; bucket b holds the values
+       * from 2^(b-1) to 2^b - 1, and bucket 0 holds 0.
+       */
+      struct Histogram
+      {
+        static const int BUCKETS = 65;
+        uint64_t counts[BUCKETS];
+        uint64_t count, max;
+        double sum;
+
+        void add(uint64_t value);
+        void merge(const Histogram &other);
+        uint64_t percentile(double fraction) const;
+        double mean() const { return count > 0 ? sum / count : 0.0; }
+      };
+
+      struct TagStats
+      {
+        uint64_t sends, receives;
+        Histogram sizes;
+        double probeSeconds, receiveSeconds;
+      };
+
+      // plain old data, so that it can be gathered as bytes
+      struct Stats
+      {
+        TagStats tags[NUM_TAGS];
+        uint64_t iprobes, iprobeHits;
+        double iprobeSeconds;
+        Histogram roundTrips;    // microseconds
+        Histogram serviceTimes;  // microseconds
+        Histogram queueDepths;
+        uint64_t clients;
+        double start, elapsed;
+      };
+
+      typedef std::pair<MPI_Comm, int> Peer;
+
+      MpiProfile();
+
+      static int tagIndex(int tag) { return tag > OTHER_TAG && tag < NUM_TAGS ? tag : OTHER_TAG; }
+      static void printHistogram(FILE *out, const Histogram &histogram, const char *unit);
+
+      Stats m_stats;
+      // when requests were sent to each peer, and when requests from each
+      // peer were received and not yet answered
+      std::map<Peer, double> m_requested, m_serving;
+      std::set<Peer> m_clients;
+  };
+}
+
+#endif
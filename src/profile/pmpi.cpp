@@ -0,0 +1,126 @@
+/*******************************************************************************
+ * Copyright 2012 Jonathan Glines <auntieNeo@gmail.com>                        *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ ******************************************************************************/
+
+/**
+ * The PMPI profiling layer. These definitions of the point to point calls of
+ * the keyspace request protocol take the place of those of the MPI library,
+ * record each call with the MpiProfile, and call the library through its
+ * PMPI entry points. MPI_Finalize() prints the profile of every rank on rank
+ * 0, to stderr, or to the file named by the TRIPRIPPER_MPI_PROFILE
+ * environment variable.
+ *
+ * The layer is a shared library, which is linked into tripripper when built
+ * with TRIPRIPPER_MPI_PROFILE, and can be preloaded into any other build.
+ */
+
+#include "mpiProfile.h"
+
+#include <cstdlib>
+
+using TripRipper::MpiProfile;
+
+static uint64_t messageBytes(int count, MPI_Datatype datatype)
+{
+  int size = 0;
+  PMPI_Type_size(datatype, &size);
+  return static_cast<uint64_t>(count) * size;
+}
+
+extern "C"
+{
+  int MPI_Init(int *argc, char ***argv)
+  {
+    int error = PMPI_Init(argc, argv);
+    MpiProfile::singleton()->start(PMPI_Wtime());
+    return error;
+  }
+
+  int MPI_Finalize()
+  {
+    FILE *out = stderr;
+    const char *path = getenv("TRIPRIPPER_MPI_PROFILE");
+    int rank;
+    PMPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    if(path != NULL && *path != '\0' && rank == 0)
+    {
+      out = fopen(path, "w");
+      if(out == NULL)
+      {
+        fprintf(stderr, "Could not write MPI profile to %s\n", path);
+        out = stderr;
+      }
+    }
+    MpiProfile::singleton()->report(MPI_COMM_WORLD, 0, out, PMPI_Wtime());
+    if(out != stderr)
+      fclose(out);
+    return PMPI_Finalize();
+  }
+
+  int MPI_Send(const void *buf, int count, MPI_Datatype datatype, int dest, int tag, MPI_Comm comm)
+  {
+    MpiProfile::singleton()->sent(comm, dest, tag, messageBytes(count, datatype), PMPI_Wtime());
+    return PMPI_Send(buf, count, datatype, dest, tag, comm);
+  }
+
+  int MPI_Isend(const void *buf, int count, MPI_Datatype datatype, int dest, int tag, MPI_Comm comm, MPI_Request *request)
+  {
+    MpiProfile::singleton()->sent(comm, dest, tag, messageBytes(count, datatype), PMPI_Wtime());
+    return PMPI_Isend(buf, count, datatype, dest, tag, comm, request);
+  }
+
+  int MPI_Recv(void *buf, int count, MPI_Datatype datatype, int source, int tag, MPI_Comm comm, MPI_Status *status)
+  {
+    MPI_Status received;
+    double start = PMPI_Wtime();
+    int error = PMPI_Recv(buf, count, datatype, source, tag, comm, &received);
+    double now = PMPI_Wtime();
+    int receivedCount = 0;
+    PMPI_Get_count(&received, datatype, &receivedCount);
+    MpiProfile::singleton()->received(comm, received.MPI_SOURCE, received.MPI_TAG,
+        messageBytes(receivedCount, datatype), now - start, now);
+    if(status != MPI_STATUS_IGNORE)
+      *status = received;
+    return error;
+  }
+
+  int MPI_Probe(int source, int tag, MPI_Comm comm, MPI_Status *status)
+  {
+    MPI_Status probed;
+    double start = PMPI_Wtime();
+    int error = PMPI_Probe(source, tag, comm, &probed);
+    MpiProfile::singleton()->probed(probed.MPI_TAG, PMPI_Wtime() - start);
+    if(status != MPI_STATUS_IGNORE)
+      *status = probed;
+    return error;
+  }
+
+  int MPI_Iprobe(int source, int tag, MPI_Comm comm, int *flag, MPI_Status *status)
+  {
+    MPI_Status probed;
+    double start = PMPI_Wtime();
+    int error = PMPI_Iprobe(source, tag, comm, flag, &probed);
+    MpiProfile::singleton()->iprobed(*flag != 0, probed.MPI_TAG, PMPI_Wtime() - start);
+    if(status != MPI_STATUS_IGNORE)
+      *status = probed;
+    return error;
+  }
+}
@@ -0,0 +1,214 @@
+/*******************************************************************************
+ * Copyright 2012 Jonathan Glines <auntieNeo@gmail.com>                        *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ ******************************************************************************/
+
+#include "rangeSet.h"
+#include "serialization.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace TripRipper
+{
+  RangeSet::RangeSet() :
+    m_count(0)
+  {
+  }
+
+  RangeSet::~RangeSet()
+  {
+  }
+
+  /**
+   * Adds the integers in [begin, end) to the set.
+   */
+  void RangeSet::insert(uint64_t begin, uint64_t end)
+  {
+    if(begin >= end)
+      return;
+
+    // find the first range that could touch [begin, end)
+    std::map<uint64_t, uint64_t>::iterator i = m_ranges.upper_bound(begin);
+    if(i != m_ranges.begin())
+    {
+      std::map<uint64_t, uint64_t>::iterator previous = i;
+      --previous;
+      if(previous->second >= begin)
+        i = previous;
+    }
+
+    // absorb every range that overlaps or is adjacent to [begin, end)
+    while(i != m_ranges.end() && i->first <= end)
+    {
+      begin = std::min(begin, i->first);
+      end = std::max(end, i->second);
+      m_count -= i->second - i->first;
+      m_ranges.erase(i++);
+    }
+
+    m_ranges[begin] = end;
+    m_count += end - begin;
+  }
+
+  /**
+   * Removes the integers in [begin, end) from the set.
+   */
+  void RangeSet::erase(uint64_t begin, uint64_t end)
+  {
+    if(begin >= end)
+      return;
+
+    std::map<uint64_t, uint64_t>::iterator i = m_ranges.upper_bound(begin);
+    if(i != m_ranges.begin())
+    {
+      std::map<uint64_t, uint64_t>::iterator previous = i;
+      --previous;
+      if(previous->second > begin)
+        i = previous;
+    }
+
+    while(i != m_ranges.end() && i->first < end)
+    {
+      uint64_t rangeBegin = i->first, rangeEnd = i->second;
+      m_count -= rangeEnd - rangeBegin;
+      m_ranges.erase(i++);
+      // keep the parts of the range outside of [begin, end)
+      if(rangeBegin < begin)
+      {
+        m_ranges[rangeBegin] = begin;
+        m_count += begin - rangeBegin;
+      }
+      if(rangeEnd > end)
+      {
+        m_ranges[end] = rangeEnd;
+        m_count += rangeEnd - end;
+      }
+    }
+  }
+
+  /**
+   * Adds to this set the integers of source that lie within [begin, end).
+   */
+  void RangeSet::copyRange(const RangeSet &source, uint64_t begin, uint64_t end)
+  {
+    if(begin >= end)
+      return;
+
+    const_iterator i = source.m_ranges.upper_bound(begin);
+    if(i != source.m_ranges.begin())
+    {
+      const_iterator previous = i;
+      --previous;
+      if(previous->second > begin)
+        i = previous;
+    }
+    for(; i != source.m_ranges.end() && i->first < end; ++i)
+      insert(std::max(begin, i->first), std::min(end, i->second));
+  }
+
+  void RangeSet::clear()
+  {
+    m_ranges.clear();
+    m_count = 0;
+  }
+
+  bool RangeSet::contains(uint64_t value) const
+  {
+    const_iterator i = m_ranges.upper_bound(value);
+    if(i == m_ranges.begin())
+      return false;
+    --i;
+    return value < i->second;
+  }
+
+  /**
+   * Returns the smallest integer greater than or equal to from that is not in
+   * the set.
+   */
+  uint64_t RangeSet::firstGap(uint64_t from) const
+  {
+    const_iterator i = m_ranges.upper_bound(from);
+    if(i == m_ranges.begin())
+      return from;
+    --i;
+    // ranges are never adjacent, so the end of a range is always a gap
+    return from < i->second ? i->second : from;
+  }
+
+  /**
+   * Returns the beginning of the first range that begins after from, or the
+   * largest representable integer if there is no such range. Together with
+   * firstGap() this gives the extent of a gap in the set.
+   */
+  uint64_t RangeSet::nextRange(uint64_t from) const
+  {
+    const_iterator i = m_ranges.upper_bound(from);
+    if(i == m_ranges.end())
+      return std::numeric_limits<uint64_t>::max();
+    return i->first;
+  }
+
+  /**
+   * Returns the size in bytes of the serial representation of the set.
+   */
+  size_t RangeSet::serialSize() const
+  {
+    return 8 + 16 * m_ranges.size();
+  }
+
+  /**
+   * Writes the serial representation of the set, which is the number of
+   * ranges followed by the beginning and end of each range, in network byte
+   * order. The buffer must be at least serialSize() bytes.
+   */
+  void RangeSet::serialize(uint8_t *buffer) const
+  {
+    writeUint64(buffer, m_ranges.size());
+    buffer += 8;
+    for(const_iterator i = m_ranges.begin(); i != m_ranges.end(); ++i)
+    {
+      writeUint64(buffer, i->first);
+      writeUint64(buffer + 8, i->second);
+      buffer += 16;
+    }
+  }
+
+  /**
+   * Replaces the contents of the set with the set serialized in buffer, and
+   * returns the number of bytes read, or 0 if buffer is too small to hold
+   * the set.
+   */
+  size_t RangeSet::deserialize(const uint8_t *buffer, size_t size)
+  {
+    clear();
+    if(size < 8)
+      return 0;
+    uint64_t numRanges = readUint64(buffer);
+    if(numRanges > (size - 8) / 16)
+      return 0;
+    for(uint64_t i = 0; i < numRanges; ++i)
+    {
+      const uint8_t *range = buffer + 8 + 16 * i;
+      insert(readUint64(range), readUint64(range + 8));
+    }
+    return 8 + 16 * numRanges;
+  }
+}
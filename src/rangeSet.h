@@ -0,0 +1,91 @@
+/*******************************************************************************
+ * Copyright 2012 Jonathan Glines <auntieNeo@gmail.com>                        *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ ******************************************************************************/
+
+#ifndef RANGE_SET_H_
+#define RANGE_SET_H_
+
+#include "common.h"
+
+#include <map>
+
+namespace TripRipper
+{
+  /**
+   * The RangeSet class is a set of 64 bit integers stored as a sorted map of
+   * disjoint, half-open ranges. Adjacent and overlapping ranges are merged on
+   * insertion, so the memory used by a RangeSet grows with the number of
+   * separate runs in the set rather than with the number of integers in it.
+   * This makes it suitable for tracking which of the possibly billions of
+   * pools of a KeyspaceMapping have been searched.
+   *
+   * All queries, including firstGap(), take logarithmic time in the number of
+   * ranges.
+   *
+   * \sa PoolTracker
+   */
+  class RangeSet
+  {
+    public:
+      typedef std::map<uint64_t, uint64_t>::const_iterator const_iterator;
+
+      RangeSet();
+      ~RangeSet();
+
+      void insert(uint64_t begin, uint64_t end);
+      void erase(uint64_t begin, uint64_t end);
+      void copyRange(const RangeSet &source, uint64_t begin, uint64_t end);
+      void clear();
+
+      bool contains(uint64_t value) const;
+      uint64_t firstGap(uint64_t from) const;
+      uint64_t nextRange(uint64_t from) const;
+
+      /**
+       * Returns the number of integers in the set.
+       */
+      uint64_t count() const { return m_count; }
+      /**
+       * Returns the number of disjoint ranges the set is stored as.
+       */
+      size_t numRanges() const { return m_ranges.size(); }
+      bool empty() const { return m_ranges.empty(); }
+
+      /**
+       * Iterators over the ranges of the set in ascending order. The first
+       * member of each element is the beginning of a range and the second
+       * member is one past its end.
+       */
+      const_iterator begin() const { return m_ranges.begin(); }
+      const_iterator end() const { return m_ranges.end(); }
+
+      size_t serialSize() const;
+      void serialize(uint8_t *buffer) const;
+      size_t deserialize(const uint8_t *buffer, size_t size);
+
+    private:
+      // maps the beginning of each range to one past its end
+      std::map<uint64_t, uint64_t> m_ranges;
+      uint64_t m_count;
+  };
+}
+
+#endif
@@ -0,0 +1,65 @@
+/*******************************************************************************
+ * Copyright 2012 Jonathan Glines <auntieNeo@gmail.com>                        *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ ******************************************************************************/
+
+#ifndef SERIALIZATION_H_
+#define SERIALIZATION_H_
+
+#include "common.h"
+
+namespace TripRipper
+{
+  /**
+   * Helper functions for reading and writing integers in network byte order.
+   * These are used by the serialize() and deserialize() methods of objects
+   * that are sent over the wire between MPI ranks, since ranks in a cluster
+   * are not guaranteed to share an endianness.
+   */
+  inline void writeUint32(uint8_t *buffer, uint32_t value)
+  {
+    buffer[0] = static_cast<uint8_t>(value >> 24);
+    buffer[1] = static_cast<uint8_t>(value >> 16);
+    buffer[2] = static_cast<uint8_t>(value >> 8);
+    buffer[3] = static_cast<uint8_t>(value);
+  }
+
+  inline uint32_t readUint32(const uint8_t *buffer)
+  {
+    return (static_cast<uint32_t>(buffer[0]) << 24) |
+           (static_cast<uint32_t>(buffer[1]) << 16) |
+           (static_cast<uint32_t>(buffer[2]) << 8) |
+           static_cast<uint32_t>(buffer[3]);
+  }
+
+  inline void writeUint64(uint8_t *buffer, uint64_t value)
+  {
+    writeUint32(buffer, static_cast<uint32_t>(value >> 32));
+    writeUint32(buffer + 4, static_cast<uint32_t>(value));
+  }
+
+  inline uint64_t readUint64(const uint8_t *buffer)
+  {
+    return (static_cast<uint64_t>(readUint32(buffer)) << 32) |
+           static_cast<uint64_t>(readUint32(buffer + 4));
+  }
+}
+
+#endif
@@ -0,0 +1,306 @@
+/*******************************************************************************
+ * Copyright 2012 Jonathan Glines <auntieNeo@gmail.com>                        *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ ******************************************************************************/
+
+#include "shardKeyspace.h"
+#include "checkpoint.h"
+#include "keyspaceFactory.h"
+#include "logger.h"
+#include "matchLog.h"
+#include "poolTracker.h"
+#include "serialization.h"
+
+#include <sstream>
+
+namespace TripRipper
+{
+  ShardKeyspace::ShardKeyspace() :
+    m_base(NULL),
+    m_searchId(0),
+    m_shard(0), m_shardCount(0),
+    m_firstPool(0), m_endPool(0)
+  {
+  }
+
+  /**
+   * Constructs shard number shard of shardCount of the search with the given
+   * id, covering the pools of base from firstPool up to but not including
+   * endPool. Every other pool of base is marked as searched. The shard takes
+   * ownership of base.
+   */
+  ShardKeyspace::ShardKeyspace(KeyspaceMapping *base, uint64_t searchId, uint32_t shard, uint32_t shardCount, uint64_t firstPool, uint64_t endPool) :
+    m_base(base),
+    m_searchId(searchId),
+    m_shard(shard), m_shardCount(shardCount),
+    m_firstPool(firstPool), m_endPool(endPool)
+  {
+    assert(m_base->poolTracker() != NULL);
+    assert(m_shard < m_shardCount);
+    m_base->poolTracker()->restrict(m_firstPool, m_endPool);
+  }
+
+  ShardKeyspace::~ShardKeyspace()
+  {
+    delete m_base;
+  }
+
+  uint64_t ShardKeyspace::totalPools()
+  {
+    return m_base->totalPools();
+  }
+
+  uint64_t ShardKeyspace::poolsLeft()
+  {
+    return m_base->poolsLeft();
+  }
+
+  size_t ShardKeyspace::poolSize()
+  {
+    return m_base->poolSize();
+  }
+
+  KeyspacePool *ShardKeyspace::checkoutNextPool()
+  {
+    return checkoutPools(1);
+  }
+
+  KeyspacePool *ShardKeyspace::checkoutPools(uint64_t poolCount)
+  {
+    m_base->setOutputAlignment(outputAlignment());
+    m_base->setOutputStride(outputStride());
+    return m_base->checkoutPools(poolCount);
+  }
+
+  void ShardKeyspace::checkinPool(KeyspacePool *pool)
+  {
+    m_base->checkinPool(pool);
+  }
+
+  void ShardKeyspace::abandonPool(KeyspacePool *pool)
+  {
+    m_base->abandonPool(pool);
+  }
+
+  PoolTracker *ShardKeyspace::poolTracker()
+  {
+    return m_base->poolTracker();
+  }
+
+  size_t ShardKeyspace::serialSize() const
+  {
+    return HEADER_SIZE + m_base->serialSize();
+  }
+
+  /**
+   * The serial representation of a ShardKeyspace is the
+   * KeyspaceMapping::SHARD type, followed by the search id, the number of
+   * the shard, the number of shards, the first pool and one past the last
+   * pool of the shard, and the serialized base mapping.
+   */
+  void ShardKeyspace::serialize(unsigned char *buffer, size_t size, bool &done) const
+  {
+    done = false;
+    if(size < serialSize())
+      return;
+    writeUint32(buffer, KeyspaceMapping::SHARD);
+    writeUint64(buffer + 4, m_searchId);
+    writeUint32(buffer + 12, m_shard);
+    writeUint32(buffer + 16, m_shardCount);
+    writeUint64(buffer + 20, m_firstPool);
+    writeUint64(buffer + 28, m_endPool);
+    m_base->serialize(buffer + HEADER_SIZE, size - HEADER_SIZE, done);
+  }
+
+  void ShardKeyspace::deserialize(const unsigned char *buffer, size_t size, bool &done)
+  {
+    done = false;
+    if(size < HEADER_SIZE || readUint32(buffer) != KeyspaceMapping::SHARD)
+      return;
+    KeyspaceMapping *base = KeyspaceFactory::deserializeKeyspaceMapping(buffer + HEADER_SIZE, size - HEADER_SIZE);
+    if(base == NULL)
+      return;
+    if(base->poolTracker() == NULL)
+    {
+      delete base;
+      return;
+    }
+    delete m_base;
+    m_base = base;
+    m_searchId = readUint64(buffer + 4);
+    m_shard = readUint32(buffer + 12);
+    m_shardCount = readUint32(buffer + 16);
+    m_firstPool = readUint64(buffer + 20);
+    m_endPool = readUint64(buffer + 28);
+    done = true;
+  }
+
+  /**
+   * Snapshots the given mapping with checkpoint, and then divides its
+   * unsearched pools into shardCount shards, writing the checkpoint of each
+   * shard next to it, with ".shard" and the number of the shard appended.
+   * Returns false if the mapping cannot be divided or a checkpoint could not
+   * be written.
+   */
+  bool ShardKeyspace::exportShards(Checkpoint *checkpoint, KeyspaceMapping *mapping, uint32_t shardCount)
+  {
+    PoolTracker *tracker = mapping->poolTracker();
+    if(tracker == NULL || shardCount == 0)
+    {
+      Logger::error("The keyspace mapping cannot be divided into shards");
+      return false;
+    }
+    if(!checkpoint->snapshot(mapping, 0.0))
+      return false;
+
+    size_t stateSize = mapping->serialSize();
+    std::vector<uint8_t> state(stateSize);
+    bool done;
+    mapping->serialize(&state[0], stateSize, done);
+    assert(done);
+
+    uint64_t searchId = computeSearchId(mapping);
+    uint64_t poolsLeft = tracker->poolsLeft();
+    uint64_t firstPool = 0;
+    for(uint32_t i = 0; i < shardCount; ++i)
+    {
+      // the first shards get the remainder of the division
+      uint64_t shardPools = poolsLeft / shardCount + (i < poolsLeft % shardCount ? 1 : 0);
+      uint64_t endPool = tracker->skipUnsearched(firstPool, shardPools);
+      if(i + 1 == shardCount)
+        endPool = tracker->totalPools();
+
+      KeyspaceMapping *base = KeyspaceFactory::deserializeKeyspaceMapping(&state[0], stateSize);
+      if(base == NULL)
+        return false;
+      ShardKeyspace shard(base, searchId, i, shardCount, firstPool, endPool);
+      std::ostringstream path;
+      path << checkpoint->path() << ".shard" << i;
+      Checkpoint shardCheckpoint(path.str(), false);
+      if(!shardCheckpoint.snapshot(&shard, 0.0))
+        return false;
+      Logger::info("%s: pools %llu to %llu, %llu unsearched", path.str().c_str(), static_cast<unsigned long long>(firstPool),
+          static_cast<unsigned long long>(endPool), static_cast<unsigned long long>(shard.poolsLeft()));
+      firstPool = endPool;
+    }
+    return true;
+  }
+
+  /**
+   * Merges each of the given shard checkpoints and match logs into the
+   * search of mapping, and then snapshots the mapping with checkpoint. For
+   * each shard checkpoint, the pools searched within the range of the shard
+   * are marked as searched. Match logs are appended to the match log at
+   * matchLogPath, which is then indexed. Returns false if any of the files
+   * could not be merged, in which case the rest are still merged.
+   *
+   * Merging a shard more than once, or merging a shard before its search
+   * has finished and again afterwards, is harmless: pools are marked as
+   * searched, and MatchLog::appendLog() only appends the matches a match log
+   * gained since it was last merged.
+   */
+  bool ShardKeyspace::mergeShards(Checkpoint *checkpoint, KeyspaceMapping *mapping, const std::string &matchLogPath, const std::vector<std::string> &paths)
+  {
+    PoolTracker *tracker = mapping->poolTracker();
+    if(tracker == NULL)
+    {
+      Logger::error("The keyspace mapping cannot be divided into shards");
+      return false;
+    }
+    uint64_t searchId = computeSearchId(mapping);
+    MatchLog *matchLog = NULL;
+    if(!matchLogPath.empty())
+      matchLog = new MatchLog(matchLogPath);
+
+    bool merged = true;
+    for(size_t i = 0; i < paths.size(); ++i)
+    {
+      const std::string &path = paths[i];
+      if(MatchLog::isMatchLog(path))
+      {
+        if(matchLog == NULL)
+        {
+          Logger::error("Merging match log %s requires --match-log", path.c_str());
+          merged = false;
+        }
+        else if(!matchLog->appendLog(path))
+        {
+          merged = false;
+        }
+        continue;
+      }
+
+      Checkpoint shardCheckpoint(path, true);
+      KeyspaceMapping *resumed = shardCheckpoint.resume();
+      ShardKeyspace *shard = dynamic_cast<ShardKeyspace*>(resumed);
+      if(shard == NULL || shard->searchId() != searchId || shard->totalPools() != mapping->totalPools())
+      {
+        Logger::error("%s is not a shard of the search in %s", path.c_str(), checkpoint->path().c_str());
+        delete resumed;
+        merged = false;
+        continue;
+      }
+      tracker->merge(*shard->poolTracker(), shard->firstPool(), shard->endPool());
+      Logger::info("%s: shard %u of %u, %llu pools left", path.c_str(), shard->shard() + 1, shard->shardCount(),
+          static_cast<unsigned long long>(shard->poolsLeft()));
+      delete resumed;
+    }
+
+    if(!checkpoint->snapshot(mapping, 0.0))
+      merged = false;
+    Logger::info("%llu of %llu pools left", static_cast<unsigned long long>(mapping->poolsLeft()),
+        static_cast<unsigned long long>(mapping->totalPools()));
+    if(matchLog != NULL)
+    {
+      if(!matchLog->buildIndex())
+        merged = false;
+      delete matchLog;
+    }
+    return merged;
+  }
+
+  /**
+   * Returns the id of the search of the given mapping, which is the
+   * Checkpoint::checksum() of the serialized mapping with none of its pools
+   * searched, so that it depends on the parameters of the mapping but not on
+   * the progress of the search. Returns 0 if the mapping cannot be copied.
+   */
+  uint64_t ShardKeyspace::computeSearchId(const KeyspaceMapping *mapping)
+  {
+    size_t size = mapping->serialSize();
+    std::vector<uint8_t> state(size);
+    bool done;
+    mapping->serialize(&state[0], size, done);
+    assert(done);
+    KeyspaceMapping *copy = KeyspaceFactory::deserializeKeyspaceMapping(&state[0], size);
+    if(copy == NULL || copy->poolTracker() == NULL)
+    {
+      delete copy;
+      return 0;
+    }
+    *copy->poolTracker() = PoolTracker(copy->poolTracker()->totalPools());
+    size = copy->serialSize();
+    state.resize(size);
+    copy->serialize(&state[0], size, done);
+    assert(done);
+    delete copy;
+    return Checkpoint::checksum(&state[0], size);
+  }
+}
@@ -0,0 +1,107 @@
+/*******************************************************************************
+ * Copyright 2012 Jonathan Glines <auntieNeo@gmail.com>                        *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ ******************************************************************************/
+
+#ifndef SHARD_KEYSPACE_H_
+#define SHARD_KEYSPACE_H_
+
+#include "keyspace.h"
+
+namespace TripRipper
+{
+  class Checkpoint;
+
+  /**
+   * The ShardKeyspace class restricts another KeyspaceMapping, the base
+   * mapping, to one shard of its pools, so that a search too large for one
+   * job can be divided among jobs that do not share an MPI world, such as
+   * jobs on separate clusters.
+   *
+   * exportShards() divides the unsearched pools of a checkpointed search into
+   * contiguous ranges holding about the same number of unsearched pools, and
+   * writes a checkpoint of a ShardKeyspace for each. Each shard is searched
+   * by resuming from its checkpoint, and the base mapping of the shard has
+   * every pool outside of the shard marked as searched, so nothing is
+   * searched twice. mergeShards() then copies the searched pools of each
+   * shard's range back into the original checkpoint, along with the matches
+   * of each shard.
+   *
+   * Each shard carries the id of the search it was exported from, a hash of
+   * the parameters of the base mapping, so that mergeShards() rejects shards
+   * of other searches, even of the same size.
+   *
+   * Pools are those of the base mapping, which must provide a
+   * KeyspaceMapping::poolTracker(). Since every rank would need to
+   * construct the shard, it does not support ATOMIC_DISPATCH.
+   */
+  class ShardKeyspace : public KeyspaceMapping
+  {
+    public:
+      ShardKeyspace();
+      ShardKeyspace(KeyspaceMapping *base, uint64_t searchId, uint32_t shard, uint32_t shardCount, uint64_t firstPool, uint64_t endPool);
+      ~ShardKeyspace();
+
+      KeyspaceMapping *base() { return m_base; }
+      uint64_t searchId() const { return m_searchId; }
+      /**
+       * Returns the number of this shard, counting from 0.
+       */
+      uint32_t shard() const { return m_shard; }
+      uint32_t shardCount() const { return m_shardCount; }
+      /**
+       * Returns the index of the first pool of the base mapping in the shard.
+       */
+      uint64_t firstPool() const { return m_firstPool; }
+      /**
+       * Returns one past the index of the last pool of the base mapping in
+       * the shard.
+       */
+      uint64_t endPool() const { return m_endPool; }
+
+      uint64_t totalPools();
+      uint64_t poolsLeft();
+      size_t poolSize();
+      KeyspacePool *checkoutNextPool();
+      KeyspacePool *checkoutPools(uint64_t poolCount);
+      void checkinPool(KeyspacePool *pool);
+      void abandonPool(KeyspacePool *pool);
+      PoolTracker *poolTracker();
+
+      size_t serialSize() const;
+      void serialize(unsigned char *buffer, size_t size, bool &done) const;
+      void deserialize(const unsigned char *buffer, size_t size, bool &done);
+
+      static bool exportShards(Checkpoint *checkpoint, KeyspaceMapping *mapping, uint32_t shardCount);
+      static bool mergeShards(Checkpoint *checkpoint, KeyspaceMapping *mapping, const std::string &matchLogPath, const std::vector<std::string> &paths);
+
+      static uint64_t computeSearchId(const KeyspaceMapping *mapping);
+
+    private:
+      static const size_t HEADER_SIZE = 4 + 8 + 4 + 4 + 8 + 8;
+
+      KeyspaceMapping *m_base;
+      uint64_t m_searchId;
+      uint32_t m_shard, m_shardCount;
+      uint64_t m_firstPool, m_endPool;
+  };
+}
+
+#endif
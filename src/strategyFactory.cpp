@@ -22,16 +22,85 @@
 
 #include "strategyFactory.h"
 #include "linearKeyspace.h"
+#include "logger.h"
+#include "manglingKeyspace.h"
+#include "maskKeyspace.h"
+#include "wordlistKeyspace.h"
 #include "openSSLTripcode.h"
 #include "strcmpMatching.h"
 
+#include <climits>
+#include <unistd.h>
+
+#ifdef TRIPRIPPER_PLUGINS
+#include "engineSelector.h"
+#include "plugin.h"
+
+#include <algorithm>
+#include <sstream>
+#include <dirent.h>
+#include <dlfcn.h>
+#endif
+
 namespace TripRipper
 {
-  KeyspaceMapping *createLinearKeyspace()
+  KeyspaceMapping *createLinearKeyspace(const std::string &/*argument*/)
   {
     return new LinearKeyspace;
   }
 
+  KeyspaceMapping *createMaskKeyspace(const std::string &argument)
+  {
+    MaskKeyspace *mapping = new MaskKeyspace;
+    if(!mapping->setMask(argument))
+    {
+      Logger::error("Invalid mask \"%s\"", argument.c_str());
+      delete mapping;
+      return NULL;
+    }
+    return mapping;
+  }
+
+  KeyspaceMapping *createWordlistKeyspace(const std::string &argument)
+  {
+    WordlistKeyspace *mapping = new WordlistKeyspace;
+    if(!mapping->setPath(argument))
+    {
+      delete mapping;
+      return NULL;
+    }
+    return mapping;
+  }
+
+  /**
+   * The argument is the path of a file of mangling rules, followed by a colon
+   * and the mapping to mangle, e.g. "rules.txt:wordlist:words.txt".
+   */
+  KeyspaceMapping *createManglingKeyspace(const std::string &argument)
+  {
+    size_t colon = argument.find(':');
+    if(colon == std::string::npos)
+    {
+      Logger::error("Missing base mapping in \"%s\"", argument.c_str());
+      return NULL;
+    }
+    ManglingRules rules;
+    if(!rules.load(argument.substr(0, colon)))
+      return NULL;
+    KeyspaceMapping *base = StrategyFactory::singleton()->createKeyspaceMapping(argument.substr(colon + 1));
+    if(base == NULL)
+      return NULL;
+    ManglingKeyspace *mapping = new ManglingKeyspace;
+    if(!mapping->setMangling(rules, base))
+    {
+      Logger::error("Cannot mangle \"%s\"", argument.substr(colon + 1).c_str());
+      delete base;
+      delete mapping;
+      return NULL;
+    }
+    return mapping;
+  }
+
   TripcodeAlgorithm *createOpenSSLTripcode()
   {
     return new OpenSSLTripcode;
@@ -45,7 +114,10 @@ namespace TripRipper
   StrategyFactory::StrategyFactory()
   {
     // populate m_keyspaceMappingCreators
-    m_keyspaceMappingCreators.insert(std::pair<std::string, KeyspaceMapping*(*)()>("linear", createLinearKeyspace));
+    m_keyspaceMappingCreators.insert(std::pair<std::string, KeyspaceMapping*(*)(const std::string &)>("linear", createLinearKeyspace));
+    m_keyspaceMappingCreators.insert(std::pair<std::string, KeyspaceMapping*(*)(const std::string &)>("mask", createMaskKeyspace));
+    m_keyspaceMappingCreators.insert(std::pair<std::string, KeyspaceMapping*(*)(const std::string &)>("wordlist", createWordlistKeyspace));
+    m_keyspaceMappingCreators.insert(std::pair<std::string, KeyspaceMapping*(*)(const std::string &)>("mangle", createManglingKeyspace));
 
     // populate m_tripcodeAlgorithmCreators
     m_tripcodeAlgorithmCreators.insert(std::pair<std::string, TripcodeAlgorithm*(*)()>("openssl", createOpenSSLTripcode));
@@ -66,22 +138,203 @@ namespace TripRipper
 
   KeyspaceMapping *StrategyFactory::createKeyspaceMapping(const std::string &type)
   {
-    std::map<std::string, KeyspaceMapping *(*)()>::iterator i = m_keyspaceMappingCreators.find(type);
-    assert(i != m_keyspaceMappingCreators.end()); // FIXME: Handle this error properly. This is part of the external interface.
-    return ((*i).second)();
+    size_t colon = type.find(':');
+    std::string argument;
+    if(colon != std::string::npos)
+      argument = type.substr(colon + 1);
+    std::map<std::string, KeyspaceMapping *(*)(const std::string &)>::iterator i = m_keyspaceMappingCreators.find(type.substr(0, colon));
+    if(i == m_keyspaceMappingCreators.end())
+    {
+      Logger::error("Unknown keyspace mapping \"%s\"", type.substr(0, colon).c_str());
+      return NULL;
+    }
+    return ((*i).second)(argument);
   }
 
   TripcodeAlgorithm *StrategyFactory::createTripcodeAlgorithm(const std::string &type)
   {
     std::map<std::string, TripcodeAlgorithm *(*)()>::iterator i = m_tripcodeAlgorithmCreators.find(type);
-    assert(i != m_tripcodeAlgorithmCreators.end()); // FIXME: Handle this error properly. This is part of the external interface.
+    if(i == m_tripcodeAlgorithmCreators.end())
+    {
+      Logger::error("Unknown tripcode algorithm \"%s\"", type.c_str());
+      return NULL;
+    }
     return ((*i).second)();
   }
 
   MatchingAlgorithm *StrategyFactory::createMatchingAlgorithm(const std::string &type)
   {
     std::map<std::string, MatchingAlgorithm *(*)()>::iterator i = m_matchingAlgorithmCreators.find(type);
-    assert(i != m_matchingAlgorithmCreators.end()); // FIXME: Handle this error properly. This is part of the external interface.
+    if(i == m_matchingAlgorithmCreators.end())
+    {
+      Logger::error("Unknown matching algorithm \"%s\"", type.c_str());
+      return NULL;
+    }
     return ((*i).second)();
   }
+
+  /**
+   * Returns the names of the tripcode algorithms, in alphabetical order.
+   */
+  std::vector<std::string> StrategyFactory::tripcodeAlgorithmNames() const
+  {
+    std::vector<std::string> names;
+    std::map<std::string, TripcodeAlgorithm *(*)()>::const_iterator i;
+    for(i = m_tripcodeAlgorithmCreators.begin(); i != m_tripcodeAlgorithmCreators.end(); ++i)
+      names.push_back((*i).first);
+    return names;
+  }
+
+  /**
+   * Returns the names of the matching algorithms, in alphabetical order.
+   */
+  std::vector<std::string> StrategyFactory::matchingAlgorithmNames() const
+  {
+    std::vector<std::string> names;
+    std::map<std::string, MatchingAlgorithm *(*)()>::const_iterator i;
+    for(i = m_matchingAlgorithmCreators.begin(); i != m_matchingAlgorithmCreators.end(); ++i)
+      names.push_back((*i).first);
+    return names;
+  }
+
+  /**
+   * Registers a tripcode algorithm under the given name, as plugins do.
+   * Returns false if there already is an algorithm of that name.
+   */
+  bool StrategyFactory::registerTripcodeAlgorithm(const std::string &name, TripcodeAlgorithm *(*creator)())
+  {
+    if(!m_tripcodeAlgorithmCreators.insert(std::pair<std::string, TripcodeAlgorithm*(*)()>(name, creator)).second)
+    {
+      Logger::error("Tripcode algorithm \"%s\" is already registered", name.c_str());
+      return false;
+    }
+    return true;
+  }
+
+  /**
+   * Registers a matching algorithm under the given name, as plugins do.
+   * Returns false if there already is an algorithm of that name.
+   */
+  bool StrategyFactory::registerMatchingAlgorithm(const std::string &name, MatchingAlgorithm *(*creator)())
+  {
+    if(!m_matchingAlgorithmCreators.insert(std::pair<std::string, MatchingAlgorithm*(*)()>(name, creator)).second)
+    {
+      Logger::error("Matching algorithm \"%s\" is already registered", name.c_str());
+      return false;
+    }
+    return true;
+  }
+
+  /**
+   * Loads the plugins in the given directory, in alphabetical order, that
+   * the CPU supports according to pluginSupported(). Returns the number of
+   * plugins loaded. A missing directory is not an error, since plugins are
+   * optional.
+   */
+  int StrategyFactory::loadPlugins(const std::string &directory)
+  {
+#ifdef TRIPRIPPER_PLUGINS
+    DIR *dir = opendir(directory.c_str());
+    if(dir == NULL)
+      return 0;
+    std::vector<std::string> paths;
+    struct dirent *entry;
+    while((entry = readdir(dir)) != NULL)
+    {
+      std::string name = entry->d_name;
+      if(name.size() > 3 && name.compare(name.size() - 3, 3, ".so") == 0)
+        paths.push_back(directory + "/" + name);
+    }
+    closedir(dir);
+    std::sort(paths.begin(), paths.end());
+
+    int loaded = 0;
+    for(size_t i = 0; i < paths.size(); ++i)
+    {
+      if(pluginSupported(paths[i]) && loadPlugin(paths[i]))
+        ++loaded;
+    }
+    return loaded;
+#else
+    (void)directory;
+    return 0;
+#endif
+  }
+
+  /**
+   * Loads the plugin at the given path and lets it register its algorithms.
+   * Returns false if the plugin could not be loaded or was built for another
+   * version of the plugin interface. Plugins are never unloaded, since the
+   * algorithms they create may live until the process exits.
+   */
+  bool StrategyFactory::loadPlugin(const std::string &path)
+  {
+#ifdef TRIPRIPPER_PLUGINS
+    void *handle = dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+    if(handle == NULL)
+    {
+      Logger::error("Could not load plugin %s: %s", path.c_str(), dlerror());
+      return false;
+    }
+    int (*version)() = reinterpret_cast<int (*)()>(dlsym(handle, "tripRipperPluginVersion"));
+    void (*registerPlugin)(StrategyFactory *) = reinterpret_cast<void (*)(StrategyFactory *)>(dlsym(handle, "tripRipperRegisterPlugin"));
+    if(version == NULL || registerPlugin == NULL)
+    {
+      Logger::error("Plugin %s is not a TripRipper plugin", path.c_str());
+      dlclose(handle);
+      return false;
+    }
+    if(version() != TRIPRIPPER_PLUGIN_VERSION)
+    {
+      Logger::error("Plugin %s was built for another version of TripRipper", path.c_str());
+      dlclose(handle);
+      return false;
+    }
+    registerPlugin(this);
+    return true;
+#else
+    Logger::error("Could not load plugin %s: TripRipper was built without plugins", path.c_str());
+    return false;
+#endif
+  }
+
+  /**
+   * Returns the "plugins" directory next to the executable, which is where
+   * the build puts the plugins.
+   */
+  std::string StrategyFactory::defaultPluginDirectory()
+  {
+    char path[PATH_MAX];
+    ssize_t size = readlink("/proc/self/exe", path, sizeof(path) - 1);
+    if(size <= 0)
+      return "plugins";
+    std::string executable(path, size);
+    return executable.substr(0, executable.rfind('/') + 1) + "plugins";
+  }
+
+  /**
+   * The file name of a plugin lists the CPU features that its code was
+   * compiled for between its name and the ".so" extension, separated by
+   * dots, e.g. "des.avx2.so" or "des.avx512f.so". The features are checked
+   * before the plugin is loaded, since even its initialization may use
+   * instructions the CPU lacks. Returns true if the CPU has all of them.
+   */
+  bool StrategyFactory::pluginSupported(const std::string &path)
+  {
+#ifdef TRIPRIPPER_PLUGINS
+    std::string name = path.substr(path.rfind('/') + 1);
+    std::istringstream features(name.substr(0, name.size() - 3));
+    std::string feature;
+    std::getline(features, feature, '.');
+    while(std::getline(features, feature, '.'))
+    {
+      if(!EngineSelector::cpuSupports(feature))
+        return false;
+    }
+    return true;
+#else
+    (void)path;
+    return false;
+#endif
+  }
 }
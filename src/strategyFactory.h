@@ -25,6 +25,7 @@
 
 #include <string>
 #include <map>
+#include <vector>
 
 namespace TripRipper
 {
@@ -38,6 +39,21 @@ namespace TripRipper
    * changed based on user configuration parameters. The three strategy classes
    * that StrategyFactory constructs include KeyspaceMapping,
    * TripcodeAlgorithm, and MatchingAlgorithm.
+   *
+   * Keyspace mappings can take an argument, which follows the name of the
+   * mapping and a colon, as in "mask:?l?l?l?l?d?d". The part after the colon
+   * is passed to the function that creates the mapping, which returns NULL if
+   * the argument is invalid.
+   *
+   * The create methods return NULL if there is no strategy of the given name.
+   * The tripcode and matching algorithm "auto" is not created here, since
+   * choosing it takes a benchmark; see EngineSelector.
+   *
+   * Besides the algorithms built into the executable, tripcode and matching
+   * algorithms can be registered by plugins, which are shared objects loaded
+   * with loadPlugins() at startup; see plugin.h. This allows the same kernels
+   * to be built for several microarchitectures, with each node loading the
+   * builds that its CPU can run.
    */
   class StrategyFactory
   {
@@ -52,8 +68,20 @@ namespace TripRipper
       TripcodeAlgorithm *createTripcodeAlgorithm(const std::string &type);
       MatchingAlgorithm *createMatchingAlgorithm(const std::string &type);
 
+      std::vector<std::string> tripcodeAlgorithmNames() const;
+      std::vector<std::string> matchingAlgorithmNames() const;
+
+      bool registerTripcodeAlgorithm(const std::string &name, TripcodeAlgorithm *(*creator)());
+      bool registerMatchingAlgorithm(const std::string &name, MatchingAlgorithm *(*creator)());
+
+      int loadPlugins(const std::string &directory);
+      bool loadPlugin(const std::string &path);
+
+      static std::string defaultPluginDirectory();
+      static bool pluginSupported(const std::string &path);
+
     private:
-      std::map<std::string, KeyspaceMapping *(*)()> m_keyspaceMappingCreators;
+      std::map<std::string, KeyspaceMapping *(*)(const std::string &)> m_keyspaceMappingCreators;
       std::map<std::string, TripcodeAlgorithm *(*)()> m_tripcodeAlgorithmCreators;
       std::map<std::string, MatchingAlgorithm *(*)()> m_matchingAlgorithmCreators;
   };
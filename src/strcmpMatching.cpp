@@ -21,6 +21,9 @@
  ******************************************************************************/
 
 #include "strcmpMatching.h"
+#include "tripcodeContainer.h"
+
+#include <cstring>
 
 namespace TripRipper
 {
@@ -33,9 +36,18 @@ namespace TripRipper
   }
 
   /**
-   * Match tripcodes using simple calls to strcmp().
+   * Match tripcodes using simple calls to strstr(), so that the match string
+   * may appear anywhere in the tripcode. An empty match string matches
+   * nothing.
    */
   void StrcmpMatching::matchTripcodes(const TripcodeContainer *tripcodes, TripcodeContainer *matches)
   {
+    if(m_matchString.empty())
+      return;
+    for(size_t i = 0; i < tripcodes->size(); ++i)
+    {
+      if(strstr(tripcodes->tripcode(i), m_matchString.c_str()) != NULL)
+        matches->insert(tripcodes->tripcode(i), tripcodes->key(i));
+    }
   }
 }
@@ -0,0 +1,246 @@
+/*******************************************************************************
+ * Copyright 2012 Jonathan Glines <auntieNeo@gmail.com>                        *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ ******************************************************************************/
+
+#include "telemetry.h"
+#include "logger.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <unistd.h>
+
+namespace TripRipper
+{
+  const double Telemetry::DEFAULT_INTERVAL = 10.0;
+  const double Telemetry::OUTLIER_FRACTION = 0.5;
+  const size_t Telemetry::MAX_OUTLIERS;
+
+  static std::string formatDuration(double seconds)
+  {
+    uint64_t s = static_cast<uint64_t>(seconds + 0.5);
+    std::ostringstream out;
+    if(s >= 3600)
+      out << s / 3600 << "h" << std::setw(2) << std::setfill('0') << s / 60 % 60 << "m";
+    else if(s >= 60)
+      out << s / 60 << "m" << std::setw(2) << std::setfill('0') << s % 60 << "s";
+    else
+      out << s << "s";
+    return out.str();
+  }
+
+  Telemetry::Telemetry(MPI_Comm comm, int root, double interval) :
+    m_parentComm(comm), m_root(root), m_interval(interval), m_previousTime(0.0), m_request(MPI_REQUEST_NULL),
+    m_pending(false), m_posted(0), m_poolsLeft(0), m_totalPools(0), m_poolSize(0)
+  {
+    MPI_Comm_dup(comm, &m_comm);
+    MPI_Comm_rank(m_comm, &m_rank);
+    MPI_Comm_size(m_comm, &m_size);
+    for(int i = 0; i < NUM_COUNTERS; ++i)
+      m_counters[i] = m_snapshot[i] = 0;
+    if(m_rank == m_root)
+    {
+      m_gathered.resize(m_size * NUM_COUNTERS, 0);
+      m_previous.resize(m_size * NUM_COUNTERS, 0);
+    }
+    m_startTime = m_previousTime = MPI_Wtime();
+    m_nextPost = m_startTime + m_interval;
+  }
+
+  Telemetry::~Telemetry()
+  {
+    // finish() completes any gather still pending
+    assert(!m_pending);
+    MPI_Comm_free(&m_comm);
+  }
+
+  void Telemetry::setPools(uint64_t poolsLeft, uint64_t totalPools, size_t poolSize)
+  {
+    m_poolsLeft = poolsLeft;
+    m_totalPools = totalPools;
+    m_poolSize = poolSize;
+  }
+
+  void Telemetry::poll(double now)
+  {
+    if(m_pending)
+    {
+      int done = 0;
+      MPI_Test(&m_request, &done, MPI_STATUS_IGNORE);
+      if(!done)
+        return;
+      m_pending = false;
+      if(m_rank == m_root)
+        report(now, false);
+    }
+    if(m_interval > 0.0 && now >= m_nextPost)
+    {
+      post(now);
+      m_pending = true;
+    }
+  }
+
+  void Telemetry::finish(double now)
+  {
+    // every rank must take part in as many gathers as the rank that has
+    // posted the most, plus one final gather of the finished counters
+    uint64_t posted = m_posted, mostPosted = 0;
+    MPI_Allreduce(&posted, &mostPosted, 1, MPI_UINT64_T, MPI_MAX, m_parentComm);
+    if(m_pending)
+    {
+      MPI_Wait(&m_request, MPI_STATUS_IGNORE);
+      m_pending = false;
+    }
+    while(m_posted <= mostPosted)
+    {
+      post(now);
+      MPI_Wait(&m_request, MPI_STATUS_IGNORE);
+    }
+    if(m_rank == m_root)
+      report(MPI_Wtime(), true);
+  }
+
+  void Telemetry::post(double now)
+  {
+    for(int i = 0; i < NUM_COUNTERS; ++i)
+      m_snapshot[i] = __sync_fetch_and_add(&m_counters[i], 0);
+    MPI_Igather(m_snapshot, NUM_COUNTERS, MPI_UINT64_T,
+        m_rank == m_root ? &m_gathered[0] : NULL, NUM_COUNTERS, MPI_UINT64_T,
+        m_root, m_comm, &m_request);
+    ++m_posted;
+    m_nextPost = now + m_interval;
+  }
+
+  void Telemetry::report(double now, bool final)
+  {
+    assert(m_rank == m_root);
+    double elapsed = now - m_startTime;
+    double dt = std::max(now - m_previousTime, 1e-9);
+
+    uint64_t totals[NUM_COUNTERS] = { 0 }, previousKeys = 0, idle = 0;
+    std::vector<double> rates(m_size, 0.0), activeRates;
+    int active = 0;
+    for(int r = 0; r < m_size; ++r)
+    {
+      const uint64_t *counters = &m_gathered[r * NUM_COUNTERS];
+      const uint64_t *previous = &m_previous[r * NUM_COUNTERS];
+      for(int i = 0; i < NUM_COUNTERS; ++i)
+        totals[i] += counters[i];
+      previousKeys += previous[KEYS];
+      idle += counters[IDLE_MICROSECONDS] - previous[IDLE_MICROSECONDS];
+      rates[r] = (counters[KEYS] - previous[KEYS]) / dt;
+      // ranks that have never searched, like a dispatching root, take no
+      // part in the rate and idle statistics
+      if(counters[KEYS] > 0)
+      {
+        activeRates.push_back(rates[r]);
+        ++active;
+      }
+    }
+
+    // the rate of the last interval is reported while searching, and the
+    // average rate once finished; the estimate of the time left always uses
+    // the average, which is steadier
+    double averageRate = elapsed > 0.0 ? totals[KEYS] / elapsed : 0.0;
+    double rate = final ? averageRate : (totals[KEYS] - previousKeys) / dt;
+    uint64_t poolsLeft = m_poolsLeft > totals[POOLS] ? m_poolsLeft - totals[POOLS] : 0;
+    double idleFraction = active > 0 && !final ? idle / 1e6 / (dt * active) : 0.0;
+
+    std::vector<std::pair<double, int> > outliers;
+    if(!final && activeRates.size() > 1)
+    {
+      std::nth_element(activeRates.begin(), activeRates.begin() + activeRates.size() / 2, activeRates.end());
+      double median = activeRates[activeRates.size() / 2];
+      for(int r = 0; r < m_size; ++r)
+      {
+        if(m_gathered[r * NUM_COUNTERS + KEYS] > 0 && rates[r] < OUTLIER_FRACTION * median)
+          outliers.push_back(std::make_pair(rates[r] / median, r));
+      }
+      std::sort(outliers.begin(), outliers.end());
+      if(outliers.size() > MAX_OUTLIERS)
+        outliers.resize(MAX_OUTLIERS);
+    }
+
+    std::ostringstream line;
+    line << std::fixed << std::setprecision(2);
+    if(final)
+      line << "Searched " << totals[KEYS] << " keys in " << formatDuration(elapsed) << ", ";
+    else
+      line << "[" << formatDuration(elapsed) << "] ";
+    line << rate / 1e6 << " Mkeys/s";
+    if(m_totalPools > 0)
+    {
+      uint64_t poolsDone = m_totalPools - std::min(poolsLeft, m_totalPools);
+      line << ", " << poolsDone << "/" << m_totalPools << " pools ("
+           << std::setprecision(1) << 100.0 * poolsDone / m_totalPools << "%)" << std::setprecision(2);
+      if(!final)
+      {
+        line << ", ETA ";
+        if(averageRate > 0.0)
+          line << formatDuration(poolsLeft * static_cast<double>(m_poolSize) / averageRate);
+        else
+          line << "unknown";
+      }
+    }
+    line << ", " << totals[HITS] << " hits";
+    if(!final)
+    {
+      line << ", " << std::setprecision(1) << 100.0 * idleFraction << "% idle";
+      for(size_t i = 0; i < outliers.size(); ++i)
+        line << (i == 0 ? ", slow: " : " ") << "rank " << outliers[i].second << " (" << std::setprecision(2)
+             << outliers[i].first << "x)";
+    }
+    Logger::info("%s", line.str().c_str());
+
+    if(!m_statusPath.empty())
+    {
+      std::ostringstream tempPath;
+      tempPath << m_statusPath << ".tmp" << getpid();
+      std::ofstream file(tempPath.str().c_str());
+      file << line.str() << "\n";
+      file << "elapsed " << elapsed << "\n"
+           << "keys " << totals[KEYS] << "\n"
+           << "keys_per_second " << rate << "\n"
+           << "pools_left " << poolsLeft << "\n"
+           << "total_pools " << m_totalPools << "\n"
+           << "hits " << totals[HITS] << "\n"
+           << "finished " << (final ? 1 : 0) << "\n";
+      for(int r = 0; r < m_size; ++r)
+      {
+        const uint64_t *counters = &m_gathered[r * NUM_COUNTERS];
+        file << "rank " << r << " keys " << counters[KEYS] << " keys_per_second " << rates[r]
+             << " blocks " << counters[BLOCKS] << " pools " << counters[POOLS] << " hits " << counters[HITS]
+             << " idle_seconds " << counters[IDLE_MICROSECONDS] / 1e6 << "\n";
+      }
+      file.close();
+      if(!file || rename(tempPath.str().c_str(), m_statusPath.c_str()) != 0)
+      {
+        Logger::warning("Could not write %s", m_statusPath.c_str());
+        remove(tempPath.str().c_str());
+      }
+    }
+
+    m_previous = m_gathered;
+    m_previousTime = now;
+  }
+}
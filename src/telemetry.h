@@ -0,0 +1,104 @@
+/*******************************************************************************
+ * Copyright 2012 Jonathan Glines <auntieNeo@gmail.com>                        *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ ******************************************************************************/
+
+#ifndef TELEMETRY_H_
+#define TELEMETRY_H_
+
+#include "common.h"
+
+#include <mpi.h>
+
+namespace TripRipper
+{
+  /**
+   * The Telemetry class reports the progress of a search across the cluster
+   * while it runs.
+   *
+   * Each rank counts the keys, KeyBlocks and pools it has searched, the
+   * matches it has found, and the time it has spent waiting for pools, in
+   * counters that are updated with atomic instructions and without locks.
+   * Every interval seconds, each rank contributes a snapshot of its counters
+   * to an MPI_Igather() to the root over a private duplicate of the
+   * communicator, so no rank ever blocks on telemetry. A rank only starts
+   * its next contribution once its previous one has completed, so the ranks
+   * are kept in step by the root, which only gathers again once every rank
+   * has contributed.
+   *
+   * Whenever a gather completes, the root prints a line with the keys per
+   * second of the cluster since the previous gather, the pools searched, an
+   * estimate of the time left, the matches found, the fraction of time ranks
+   * spent waiting for pools, and the ranks that searched at less than
+   * OUTLIER_FRACTION of the median rate. The pools left are those reported
+   * with setPools() at the start of the search, less the pools searched
+   * since. With a status file set, the line and a line for each rank are
+   * also written to it, replacing what it held.
+   *
+   * Ranks that run out of pools stop contributing until finish(), so reports
+   * may pause while the last leases are searched. finish() is collective over
+   * the communicator given to the constructor.
+   */
+  class Telemetry
+  {
+    public:
+      enum Counter { KEYS, BLOCKS, POOLS, HITS, IDLE_MICROSECONDS, NUM_COUNTERS };
+
+      static const double DEFAULT_INTERVAL;
+      static const double OUTLIER_FRACTION;
+      static const size_t MAX_OUTLIERS = 5;
+
+      Telemetry(MPI_Comm comm, int root, double interval);
+      ~Telemetry();
+
+      void add(Counter counter, uint64_t amount) { __sync_fetch_and_add(&m_counters[counter], amount); }
+      void addIdleTime(double seconds) { add(IDLE_MICROSECONDS, static_cast<uint64_t>(seconds * 1e6)); }
+
+      void setPools(uint64_t poolsLeft, uint64_t totalPools, size_t poolSize);
+      void setStatusPath(const std::string &path) { m_statusPath = path; }
+
+      void poll(double now);
+      void finish(double now);
+
+    private:
+      void post(double now);
+      void report(double now, bool final);
+
+      MPI_Comm m_parentComm, m_comm;
+      int m_root, m_rank, m_size;
+      double m_interval, m_startTime, m_nextPost;
+      uint64_t m_counters[NUM_COUNTERS];
+
+      // the snapshot being contributed, and on the root the snapshots of
+      // every rank being gathered and those of the previous report
+      uint64_t m_snapshot[NUM_COUNTERS];
+      std::vector<uint64_t> m_gathered, m_previous;
+      double m_previousTime;
+      MPI_Request m_request;
+      bool m_pending;
+      uint64_t m_posted;
+
+      uint64_t m_poolsLeft, m_totalPools;
+      size_t m_poolSize;
+      std::string m_statusPath;
+  };
+}
+
+#endif
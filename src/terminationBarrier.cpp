@@ -0,0 +1,84 @@
+/*******************************************************************************
+ * Copyright 2012 Jonathan Glines <auntieNeo@gmail.com>                        *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ ******************************************************************************/
+
+#include "terminationBarrier.h"
+
+namespace TripRipper
+{
+  /**
+   * The TerminationBarrier constructor duplicates comm, so that the barrier
+   * cannot be confused with other collectives. The signalling rank passes
+   * false for listen, and every other rank passes true.
+   */
+  TerminationBarrier::TerminationBarrier(MPI_Comm comm, bool listen) :
+    m_request(MPI_REQUEST_NULL),
+    m_entered(false),
+    m_complete(false)
+  {
+    MPI_Comm_dup(comm, &m_comm);
+    if(listen)
+      signal();
+  }
+
+  TerminationBarrier::~TerminationBarrier()
+  {
+    assert(m_complete);
+    MPI_Comm_free(&m_comm);
+  }
+
+  /**
+   * Enters the barrier. On the signalling rank, this tells the listening
+   * ranks to stop.
+   */
+  void TerminationBarrier::signal()
+  {
+    if(m_entered)
+      return;
+    MPI_Ibarrier(m_comm, &m_request);
+    m_entered = true;
+  }
+
+  /**
+   * Returns true once the signalling rank has called signal(). This never
+   * blocks.
+   */
+  bool TerminationBarrier::test()
+  {
+    if(m_complete || !m_entered)
+      return m_complete;
+    int complete;
+    MPI_Test(&m_request, &complete, MPI_STATUS_IGNORE);
+    m_complete = complete != 0;
+    return m_complete;
+  }
+
+  /**
+   * Enters the barrier if needed and blocks until it completes.
+   */
+  void TerminationBarrier::wait()
+  {
+    signal();
+    if(!m_complete)
+      MPI_Wait(&m_request, MPI_STATUS_IGNORE);
+    m_complete = true;
+  }
+}
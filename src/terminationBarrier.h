@@ -0,0 +1,66 @@
+/*******************************************************************************
+ * Copyright 2012 Jonathan Glines <auntieNeo@gmail.com>                        *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ ******************************************************************************/
+
+#ifndef TERMINATION_BARRIER_H_
+#define TERMINATION_BARRIER_H_
+
+#include "common.h"
+
+#include <mpi.h>
+
+namespace TripRipper
+{
+  /**
+   * The TerminationBarrier class lets a single rank tell every other rank
+   * to stop, in a way that the other ranks can check for cheaply and without
+   * blocking.
+   *
+   * It is built on MPI_Ibarrier() over a private duplicate of the
+   * communicator. Listening ranks enter the barrier as soon as the
+   * TerminationBarrier is constructed, while the signalling rank enters it
+   * only when signal() is called, so the barrier completes exactly when the
+   * signal is given. Listening ranks call test() at KeyBlock granularity;
+   * MPI_Test() only polls local progress, so this costs next to nothing.
+   *
+   * Every rank must call wait() before the TerminationBarrier is destroyed,
+   * which also enters the barrier on the signalling rank if it has not yet
+   * signalled. The constructor is collective over the given communicator.
+   */
+  class TerminationBarrier
+  {
+    public:
+      TerminationBarrier(MPI_Comm comm, bool listen);
+      ~TerminationBarrier();
+
+      void signal();
+      bool test();
+      void wait();
+
+    private:
+      MPI_Comm m_comm;
+      MPI_Request m_request;
+      bool m_entered;
+      bool m_complete;
+  };
+}
+
+#endif
@@ -0,0 +1,235 @@
+/*******************************************************************************
+ * Copyright 2012 Jonathan Glines <auntieNeo@gmail.com>                        *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ ******************************************************************************/
+
+#include <getopt.h>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+#include "allocationTracker.h"
+#include "common.h"
+#include "keyspace.h"
+#include "strategyFactory.h"
+#include "tripcodeAlgorithm.h"
+#include "tripcodeCrawler.h"
+#include "tripcodeSearchResult.h"
+
+#include <mpi.h>
+
+#define USAGE(status) do { \
+  fprintf(stderr, "Usage: tripripper_allocation_test [options]\n"); \
+  fprintf(stderr, "\n"); \
+  fprintf(stderr, "   Searches pools of a keyspace mapping with TripcodeCrawler::runWorker()\n"); \
+  fprintf(stderr, "   and counts the allocations of each stage. Fails if the worker allocates\n"); \
+  fprintf(stderr, "   after its first pool, or if nothing matches the search string.\n"); \
+  fprintf(stderr, "\n"); \
+  fprintf(stderr, "   Options\n"); \
+  fprintf(stderr, "   -k --keyspace-mapping=[mapping]\n"); \
+  fprintf(stderr, "      The keyspace mapping to search, \"%s\" by default.\n", DEFAULT_MAPPING); \
+  fprintf(stderr, "   -t --tripcode-algorithm=[algorithm]\n"); \
+  fprintf(stderr, "      The tripcode algorithm, \"%s\" by default.\n", DEFAULT_TRIPCODE_ALGORITHM); \
+  fprintf(stderr, "   -m --matching-algorithm=[algorithm]\n"); \
+  fprintf(stderr, "      The matching algorithm, \"%s\" by default.\n", DEFAULT_MATCHING_ALGORITHM); \
+  fprintf(stderr, "   -s --search=[string]\n"); \
+  fprintf(stderr, "      The string to match, \"%s\" by default.\n", DEFAULT_SEARCH); \
+  fprintf(stderr, "   -p --pools=[count]\n"); \
+  fprintf(stderr, "      The number of pools to search, %d by default.\n", DEFAULT_POOLS); \
+  exit(status); \
+  } while (0)
+
+using namespace TripRipper;
+
+static const char *DEFAULT_MAPPING = "mask:?d?d?d?d?d?d?d";
+static const char *DEFAULT_TRIPCODE_ALGORITHM = "openssl";
+static const char *DEFAULT_MATCHING_ALGORITHM = "strcmp";
+// found about thirty times in every million tripcodes
+static const char *DEFAULT_SEARCH = "Abc";
+static const int DEFAULT_POOLS = 3;
+// room for the results of a pool, each of which is a few dozen bytes
+static const int RESULT_BUFFER_SIZE = 1 << 20;
+
+int main(int argc, char **argv)
+{
+  std::string mappingStrategy = DEFAULT_MAPPING;
+  std::string tripcodeStrategy = DEFAULT_TRIPCODE_ALGORITHM;
+  std::string matchingStrategy = DEFAULT_MATCHING_ALGORITHM;
+  std::string search = DEFAULT_SEARCH;
+  int pools = DEFAULT_POOLS;
+
+  while(1)
+  {
+    static struct option long_options[] = {
+      {"keyspace-mapping", required_argument, NULL, 'k'},
+      {"tripcode-algorithm", required_argument, NULL, 't'},
+      {"matching-algorithm", required_argument, NULL, 'm'},
+      {"search", required_argument, NULL, 's'},
+      {"pools", required_argument, NULL, 'p'},
+      {"help", no_argument, NULL, 'h'},
+      {NULL, 0, NULL, 0}
+    };
+
+    char opt = getopt_long(argc, argv, "k:t:m:s:p:h", long_options, NULL);
+
+    if(opt == -1)
+      break;
+
+    switch(opt)
+    {
+      case 'k':
+        mappingStrategy = std::string(optarg);
+        break;
+      case 't':
+        tripcodeStrategy = std::string(optarg);
+        break;
+      case 'm':
+        matchingStrategy = std::string(optarg);
+        break;
+      case 's':
+        search = std::string(optarg);
+        break;
+      case 'p':
+        pools = atoi(optarg);
+        if(pools <= 0)
+          USAGE(EXIT_FAILURE);
+        break;
+      case 'h':
+        USAGE(EXIT_SUCCESS);
+        break;
+      default:
+        USAGE(EXIT_FAILURE);
+        break;
+    };
+  }
+
+  MPI_Init(&argc, &argv);
+
+  if(!AllocationTracker::active())
+  {
+    std::cerr << "Could not count allocations: operator new is not replaced in this executable" << std::endl;
+    MPI_Finalize();
+    return EXIT_FAILURE;
+  }
+
+  // an algorithm that is not implemented would fail for the wrong reason
+  TripcodeAlgorithm *tripcodeAlgorithm = StrategyFactory::singleton()->createTripcodeAlgorithm(tripcodeStrategy);
+  bool working = tripcodeAlgorithm != NULL && tripcodeAlgorithm->selfTest();
+  delete tripcodeAlgorithm;
+  if(!working)
+  {
+    std::cerr << "The tripcode algorithm \"" << tripcodeStrategy << "\" does not compute correct tripcodes" << std::endl;
+    MPI_Finalize();
+    return EXIT_FAILURE;
+  }
+
+  bool passed = false;
+  {
+    TripcodeCrawler crawler(mappingStrategy, tripcodeStrategy, matchingStrategy, search);
+    KeyspaceMapping *mapping = StrategyFactory::singleton()->createKeyspaceMapping(mappingStrategy);
+    if(mapping == NULL)
+      MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+
+    // this process plays the root for its own worker loop on MPI_COMM_SELF:
+    // the worker's requests are received by receives posted up front, so
+    // its probes only ever see the pools, which are all sent before the
+    // worker starts, followed by the end of the keyspace
+    std::vector<MPI_Request> requests;
+    std::vector<std::vector<uint8_t> > resultBuffers(pools + 1, std::vector<uint8_t>(RESULT_BUFFER_SIZE));
+    for(int i = 0; i <= pools; ++i)
+    {
+      requests.push_back(MPI_REQUEST_NULL);
+      MPI_Irecv(NULL, 0, MPI_BYTE, 0, KEYSPACE_REQUEST, MPI_COMM_SELF, &requests.back());
+      requests.push_back(MPI_REQUEST_NULL);
+      MPI_Irecv(&resultBuffers[i][0], RESULT_BUFFER_SIZE, MPI_BYTE, 0, POOL_EXHAUSTED_RESULT, MPI_COMM_SELF, &requests.back());
+    }
+    size_t resultRequests = requests.size();
+    std::vector<uint8_t *> poolData;
+    int sentPools = 0;
+    for(; sentPools < pools; ++sentPools)
+    {
+      KeyspacePool *pool = mapping->checkoutNextPool();
+      if(pool == NULL)
+        break;
+      size_t size;
+      poolData.push_back(pool->serialize(&size));
+      delete pool;
+      requests.push_back(MPI_REQUEST_NULL);
+      MPI_Isend(poolData.back(), static_cast<int>(size), MPI_BYTE, 0, KEYSPACE_RESPONSE, MPI_COMM_SELF, &requests.back());
+    }
+    requests.push_back(MPI_REQUEST_NULL);
+    MPI_Isend(NULL, 0, MPI_BYTE, 0, KEYSPACE_RESPONSE, MPI_COMM_SELF, &requests.back());
+
+    AllocationTracker::reset();
+    crawler.runWorker(MPI_COMM_SELF, 0);
+
+    // the receives of the requests that the worker did not make are left
+    TripcodeSearchResult results;
+    for(size_t i = 0; i < resultRequests; ++i)
+    {
+      int received;
+      MPI_Status status;
+      MPI_Test(&requests[i], &received, &status);
+      if(!received)
+      {
+        MPI_Cancel(&requests[i]);
+        MPI_Wait(&requests[i], MPI_STATUS_IGNORE);
+      }
+      else if(status.MPI_TAG == POOL_EXHAUSTED_RESULT)
+      {
+        int size;
+        MPI_Get_count(&status, MPI_BYTE, &size);
+        TripcodeSearchResult received;
+        bool done;
+        received.deserialize(&resultBuffers[i / 2][0], size, done);
+        if(done)
+          results.merge(received);
+      }
+    }
+    MPI_Waitall(static_cast<int>(requests.size() - resultRequests), &requests[resultRequests], MPI_STATUSES_IGNORE);
+    for(size_t i = 0; i < poolData.size(); ++i)
+      delete[] poolData[i];
+
+    uint64_t counts[AllocationTracker::NUM_STAGES][AllocationTracker::NUM_COUNTERS];
+    for(int i = 0; i < AllocationTracker::NUM_STAGES; ++i)
+    {
+      for(int j = 0; j < AllocationTracker::NUM_COUNTERS; ++j)
+        counts[i][j] = AllocationTracker::count(static_cast<AllocationTracker::Stage>(i), static_cast<AllocationTracker::Counter>(j));
+    }
+    std::cout << "Allocations searching " << mappingStrategy << ":" << std::endl;
+    std::cout << AllocationTracker::describe(counts, AllocationTracker::pools(), AllocationTracker::blocks(), AllocationTracker::steadyAllocations());
+    std::cout << results.size() << " matches for \"" << search << "\"" << std::endl;
+
+    // storing and sending matches is part of the steady state, so a search
+    // that never matches would not test it
+    if(AllocationTracker::pools() < 2)
+      std::cerr << "Could not test the steady state: fewer than two pools were searched" << std::endl;
+    else if(results.empty())
+      std::cerr << "Could not test the steady state: nothing matched \"" << search << "\"" << std::endl;
+    else if(AllocationTracker::steadyAllocations() > 0)
+      std::cerr << "The search allocated after the first pool" << std::endl;
+    else
+      passed = true;
+    delete mapping;
+  }
+
+  MPI_Finalize();
+  return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
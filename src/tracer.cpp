@@ -0,0 +1,188 @@
+/*******************************************************************************
+ * Copyright 2012 Jonathan Glines <auntieNeo@gmail.com>                        *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ ******************************************************************************/
+
+#include "tracer.h"
+#include "logger.h"
+
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <sys/time.h>
+#include <unistd.h>
+
+namespace TripRipper
+{
+  const size_t Tracer::BUFFER_EVENTS;
+
+  __thread Tracer::Buffer *Tracer::s_buffer = NULL;
+
+#ifdef TRIPRIPPER_TRACE
+  static const char *EVENT_NAMES[Tracer::NUM_EVENTS] = {
+    "pool request", "pool receive", "block compute", "match", "result send", "root request", "root response"
+  };
+#endif
+
+  Tracer *Tracer::singleton()
+  {
+    static Tracer instance;
+    return &instance;
+  }
+
+  Tracer::Tracer()
+  {
+    pthread_mutex_init(&m_mutex, NULL);
+    m_startTimestamp = timestamp();
+    m_startTime = wallClock();
+  }
+
+  Tracer::~Tracer()
+  {
+    // threads may still hold their buffers, so they are left to the OS
+    pthread_mutex_destroy(&m_mutex);
+  }
+
+  /**
+   * Allocates the ring buffer of the calling thread.
+   */
+  Tracer::Buffer *Tracer::addBuffer()
+  {
+    Buffer *buffer = new Buffer;
+    buffer->recorded = 0;
+    pthread_mutex_lock(&m_mutex);
+    buffer->thread = static_cast<int>(m_buffers.size());
+    m_buffers.push_back(buffer);
+    pthread_mutex_unlock(&m_mutex);
+    s_buffer = buffer;
+    return buffer;
+  }
+
+  double Tracer::wallClock()
+  {
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    return now.tv_sec * 1e6 + now.tv_usec;
+  }
+
+  /**
+   * Writes the events recorded by every rank of comm to the Chrome trace
+   * event file at path on the given root. Every rank must call this, while
+   * no other thread is recording. Returns false on the root if the file could
+   * not be written, or if TRIPRIPPER_TRACE was not defined.
+   */
+  bool Tracer::dump(MPI_Comm comm, int root, const std::string &path)
+  {
+#ifdef TRIPRIPPER_TRACE
+    int rank, size;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &size);
+
+    // the time stamp counter is calibrated against the wall clock over the
+    // whole run, and the root's start is the start of the trace
+    double ticksPerMicrosecond = 1.0;
+    double elapsed = wallClock() - m_startTime;
+    if(elapsed > 0.0)
+      ticksPerMicrosecond = (timestamp() - m_startTimestamp) / elapsed;
+    double epoch = m_startTime;
+    MPI_Bcast(&epoch, 1, MPI_DOUBLE, root, comm);
+
+    char hostname[256] = "";
+    gethostname(hostname, sizeof(hostname) - 1);
+    std::ostringstream events;
+    events << std::fixed << std::setprecision(3);
+    events << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << rank
+           << ",\"args\":{\"name\":\"rank " << rank << " (" << hostname << ")\"}},\n"
+           << "{\"name\":\"process_sort_index\",\"ph\":\"M\",\"pid\":" << rank
+           << ",\"args\":{\"sort_index\":" << rank << "}}";
+    pthread_mutex_lock(&m_mutex);
+    for(size_t i = 0; i < m_buffers.size(); ++i)
+    {
+      const Buffer *buffer = m_buffers[i];
+      uint64_t first = buffer->recorded > BUFFER_EVENTS ? buffer->recorded - BUFFER_EVENTS : 0;
+      // the beginnings of the oldest events may have been overwritten
+      int open[NUM_EVENTS] = { 0 };
+      for(uint64_t j = first; j < buffer->recorded; ++j)
+      {
+        const Record &record = buffer->records[j % BUFFER_EVENTS];
+        if(record.phase == END)
+        {
+          if(open[record.event] == 0)
+            continue;
+          --open[record.event];
+        }
+        else
+        {
+          ++open[record.event];
+        }
+        double time = m_startTime - epoch + (record.timestamp - m_startTimestamp) / ticksPerMicrosecond;
+        events << ",\n{\"name\":\"" << EVENT_NAMES[record.event] << "\",\"cat\":\"tripripper\",\"ph\":\""
+               << (record.phase == BEGIN ? "B" : "E") << "\",\"ts\":" << time
+               << ",\"pid\":" << rank << ",\"tid\":" << buffer->thread << "}";
+      }
+    }
+    pthread_mutex_unlock(&m_mutex);
+
+    std::string fragment = events.str();
+    int length = static_cast<int>(fragment.size());
+    std::vector<int> lengths(size), displacements(size);
+    MPI_Gather(&length, 1, MPI_INT, &lengths[0], 1, MPI_INT, root, comm);
+    std::vector<char> gathered;
+    if(rank == root)
+    {
+      int total = 0;
+      for(int r = 0; r < size; ++r)
+      {
+        displacements[r] = total;
+        total += lengths[r];
+      }
+      gathered.resize(total + 1);
+    }
+    MPI_Gatherv(const_cast<char *>(fragment.data()), length, MPI_CHAR,
+        rank == root ? &gathered[0] : NULL, &lengths[0], &displacements[0], MPI_CHAR, root, comm);
+    if(rank != root)
+      return true;
+
+    std::ofstream file(path.c_str());
+    file << "{\"traceEvents\":[\n";
+    for(int r = 0; r < size; ++r)
+    {
+      if(r > 0)
+        file << ",\n";
+      file.write(&gathered[displacements[r]], lengths[r]);
+    }
+    file << "\n],\"displayTimeUnit\":\"ns\"}\n";
+    file.close();
+    if(!file)
+    {
+      Logger::error("Could not write trace to %s", path.c_str());
+      return false;
+    }
+    return true;
+#else
+    int rank;
+    MPI_Comm_rank(comm, &rank);
+    if(rank == root)
+      Logger::error("Could not write trace to %s: built without TRIPRIPPER_TRACE", path.c_str());
+    return false;
+#endif
+  }
+}
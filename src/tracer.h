@@ -0,0 +1,146 @@
+/*******************************************************************************
+ * Copyright 2012 Jonathan Glines <auntieNeo@gmail.com>                        *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ ******************************************************************************/
+
+#ifndef TRACER_H_
+#define TRACER_H_
+
+#include "common.h"
+
+#include <mpi.h>
+#include <pthread.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <time.h>
+#endif
+
+namespace TripRipper
+{
+  /**
+   * The Tracer class records when each stage of the search pipeline begins
+   * and ends on each thread, to show where ranks stall: waiting for pools,
+   * receiving them, computing and matching KeyBlocks, sending results, and
+   * the root answering requests.
+   *
+   * Each thread records into its own ring buffer of BUFFER_EVENTS events, so
+   * recording takes no lock and costs a read of the time stamp counter and a
+   * store of 16 bytes. When a buffer is full, the oldest events are
+   * overwritten. dump() converts the time stamps of every rank to
+   * microseconds since the Tracer of the root was constructed, using the
+   * wall clock, and writes the events of every rank and thread as a single
+   * Chrome trace event file that chrome://tracing and Perfetto can open.
+   * Ranks on different nodes are only aligned as well as their clocks are
+   * synchronized.
+   *
+   * The trace points in the code are the TRIPRIPPER_TRACE_BEGIN() and
+   * TRIPRIPPER_TRACE_END() macros, which compile to nothing unless
+   * TRIPRIPPER_TRACE is defined.
+   */
+  class Tracer
+  {
+    public:
+      enum Event {
+        POOL_REQUEST,   // waiting for the answer to a request for a pool
+        POOL_RECEIVE,   // receiving and deserializing a pool
+        BLOCK_COMPUTE,  // computing the tripcodes of a KeyBlock
+        MATCH,          // matching the tripcodes of a KeyBlock
+        RESULT_SEND,    // serializing and sending results with a request
+        ROOT_REQUEST,   // the root receiving a request and its results
+        ROOT_RESPONSE,  // the root leasing, serializing and sending a pool
+        NUM_EVENTS
+      };
+
+      static const size_t BUFFER_EVENTS = 1 << 16;
+
+      static Tracer *singleton();
+
+      void begin(Event event) { record(event, BEGIN); }
+      void end(Event event) { record(event, END); }
+
+      bool dump(MPI_Comm comm, int root, const std::string &path);
+
+      static uint64_t timestamp()
+      {
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        return static_cast<uint64_t>(now.tv_sec) * 1000000000 + now.tv_nsec;
+#endif
+      }
+
+    private:
+      enum Phase { BEGIN, END };
+
+      struct Record
+      {
+        uint64_t timestamp;
+        uint32_t event;
+        uint32_t phase;
+      };
+
+      struct Buffer
+      {
+        Record records[BUFFER_EVENTS];
+        uint64_t recorded;
+        int thread;
+      };
+
+      Tracer();
+      ~Tracer();
+
+      void record(Event event, Phase phase)
+      {
+        Buffer *buffer = s_buffer;
+        if(buffer == NULL)
+          buffer = addBuffer();
+        Record &record = buffer->records[buffer->recorded++ % BUFFER_EVENTS];
+        record.timestamp = timestamp();
+        record.event = event;
+        record.phase = phase;
+      }
+
+      Buffer *addBuffer();
+      static double wallClock();
+
+      static __thread Buffer *s_buffer;
+
+      pthread_mutex_t m_mutex;
+      std::vector<Buffer *> m_buffers;
+      // the time stamp counter and the wall clock in microseconds when the
+      // Tracer was constructed, to convert time stamps with
+      uint64_t m_startTimestamp;
+      double m_startTime;
+  };
+}
+
+#ifdef TRIPRIPPER_TRACE
+#define TRIPRIPPER_TRACE_BEGIN(event) TripRipper::Tracer::singleton()->begin(TripRipper::Tracer::event)
+#define TRIPRIPPER_TRACE_END(event) TripRipper::Tracer::singleton()->end(TripRipper::Tracer::event)
+#else
+#define TRIPRIPPER_TRACE_BEGIN(event) do { } while(0)
+#define TRIPRIPPER_TRACE_END(event) do { } while(0)
+#endif
+
+#endif
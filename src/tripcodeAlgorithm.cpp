@@ -21,9 +21,32 @@
  ******************************************************************************/
 
 #include "tripcodeAlgorithm.h"
+#include "keyspace.h"
+#include "tripcodeContainer.h"
+
+#include <cstring>
 
 namespace TripRipper
 {
+  /**
+   * Keys and their tripcodes, as computed with crypt(3), that cover the
+   * padding of short keys, the translation of the salt and keys with the
+   * high bit set.
+   */
+  struct KnownTripcode
+  {
+    const char *key;
+    const char *tripcode;
+  };
+
+  static const KnownTripcode KNOWN_TRIPCODES[] = {
+    { "a", "ZnBI2EKkq." },
+    { "tea", "WokonZwxw2" },
+    { "TripRipp", "xxJPoIRFio" },
+    { "#!/bin/s", "opAs2QK/cs" },
+    { "\xb1\xb2\xb3", "zkIhcSWiPo" }
+  };
+
   TripcodeAlgorithm::TripcodeAlgorithm()
   {
   }
@@ -31,4 +54,64 @@ namespace TripRipper
   TripcodeAlgorithm::~TripcodeAlgorithm()
   {
   }
+
+  /**
+   * Computes the tripcodes of a few known keys and returns true if they are
+   * all correct. Algorithms that fail this, such as ones that are not
+   * implemented yet, are not benchmarked or chosen automatically.
+   */
+  bool TripcodeAlgorithm::selfTest()
+  {
+    const size_t count = sizeof(KNOWN_TRIPCODES) / sizeof(KNOWN_TRIPCODES[0]);
+    KeyBlock block;
+    block.resize(count, inputStride());
+    for(size_t i = 0; i < count; ++i)
+    {
+      memset(block.key(i), 0, KeyBlock::KEY_SIZE);
+      memcpy(block.key(i), KNOWN_TRIPCODES[i].key, strlen(KNOWN_TRIPCODES[i].key));
+    }
+    TripcodeContainer tripcodes;
+    computeTripcodes(&block, &tripcodes);
+    if(tripcodes.size() != count)
+      return false;
+    // algorithms may return the tripcodes in any order
+    for(size_t i = 0; i < count; ++i)
+    {
+      bool found = false;
+      for(size_t j = 0; j < count && !found; ++j)
+      {
+        found = strcmp(tripcodes.key(j), KNOWN_TRIPCODES[i].key) == 0 &&
+          strcmp(tripcodes.tripcode(j), KNOWN_TRIPCODES[i].tripcode) == 0;
+      }
+      if(!found)
+        return false;
+    }
+    return true;
+  }
+
+  /**
+   * Writes the two character salt of the given key, which must be
+   * terminated, to salt, followed by a terminator. The salt is the second
+   * and third characters of the key with "H.." appended, with characters
+   * outside of '.' to 'z' replaced with '.' and the punctuation between
+   * the digits and letters replaced with letters.
+   */
+  void TripcodeAlgorithm::computeSalt(const char *key, char *salt)
+  {
+    static const char PUNCTUATION[] = ":;<=>?@[\\]^_`";
+    static const char LETTERS[] = "ABCDEFGabcdef";
+    size_t length = strlen(key);
+    salt[0] = length > 1 ? key[1] : (length == 1 ? 'H' : '.');
+    salt[1] = length > 2 ? key[2] : (length == 2 ? 'H' : '.');
+    salt[2] = '\0';
+    for(int i = 0; i < 2; ++i)
+    {
+      unsigned char character = salt[i];
+      const char *punctuation = strchr(PUNCTUATION, character);
+      if(character < '.' || character > 'z')
+        salt[i] = '.';
+      else if(punctuation != NULL)
+        salt[i] = LETTERS[punctuation - PUNCTUATION];
+    }
+  }
 }
@@ -97,37 +97,6 @@ namespace TripRipper
       TripcodeAlgorithm();
       virtual ~TripcodeAlgorithm();
 
-<<<<<<< HEAD
-//      /**
-//       * The outputAlignment property specifies how the output from a
-//       * TripcodeAlgorithm object is to be aligned. Implementing classes must
-//       * place the first byte of the output at an address evenly divisable by
-//       * the outputAlignment. Additionally, the last byte of the output must be
-//       * at an address directly before an address evenly divisable by the
-//       * outputAlignment. If the output must be padded to fulfill this last
-//       * requirement, implementors can simply duplicate any of the results in
-//       * the output, to avoid returning erroneous results.
-//       */
-//      size_t outputAlignment() const { return m_outputAlignment; }
-//      /**
-//       * Sets the outputAlignment property. See outputAlignment().
-//       */
-//      void setOutputAlignment(size_t alignment) { m_outputAlignment = alignment; }
-//
-//      /**
-//       * The outputStride property specifies the number of bytes that occur
-//       * between 
-//       */
-//      size_t outputStride() const { return m_outputStride; }
-//      /**
-//       * Sets the outputStride property. See outputStride().
-//       */
-//      void setOutputStride(size_t stride) { m_outputStride = stride; }
-//
-//      virtual size_t inputAlignment() const = 0;
-//      virtual size_t inputStride() const = 0;
-//      virtual bool inputPackHighBit() const = 0;
-=======
       /**
        * The inputAlignment() method returns the number of bytes to which
        * tripcode key input to the algorithm must be aligned. Valid alignments
@@ -155,10 +124,17 @@ namespace TripRipper
        * bits with the high bit on each byte irrelevant to the key.
        */
       virtual bool inputPackHighBit() const = 0;
->>>>>>> e5d84716872796480dee88415710fe9b15bf7cee
 
+      /**
+       * The computeTripcodes() method computes the tripcode of every key in
+       * keys and adds it to results, along with its key.
+       */
       virtual void computeTripcodes(const KeyBlock *keys, TripcodeContainer *results) = 0;
 
+      bool selfTest();
+
+      static void computeSalt(const char *key, char *salt);
+
     private:
 //      size_t m_outputAlignment, m_outputStride;
   };
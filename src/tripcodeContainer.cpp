@@ -22,8 +22,13 @@
 
 #include "tripcodeContainer.h"
 
+#include <cstring>
+
 namespace TripRipper
 {
+  const size_t TripcodeContainer::TRIPCODE_SIZE;
+  const size_t TripcodeContainer::KEY_SIZE;
+
   TripcodeContainer::TripcodeContainer()
   {
   }
@@ -31,4 +36,19 @@ namespace TripRipper
   TripcodeContainer::~TripcodeContainer()
   {
   }
+
+  /**
+   * Adds a tripcode to the container along with its key. Both are
+   * terminated strings, and are truncated to TRIPCODE_SIZE and KEY_SIZE
+   * characters.
+   */
+  void TripcodeContainer::insert(const char *tripcode, const char *key)
+  {
+    m_tripcodes.resize(m_tripcodes.size() + 1);
+    Entry &entry = m_tripcodes.back();
+    strncpy(entry.tripcode, tripcode, TRIPCODE_SIZE);
+    entry.tripcode[TRIPCODE_SIZE] = '\0';
+    strncpy(entry.key, key, KEY_SIZE);
+    entry.key[KEY_SIZE] = '\0';
+  }
 }
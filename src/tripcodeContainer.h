@@ -43,6 +43,9 @@ namespace TripRipper
   class TripcodeContainer
   {
     public:
+      static const size_t TRIPCODE_SIZE = 10;
+      static const size_t KEY_SIZE = 8;
+
       TripcodeContainer();
       ~TripcodeContainer();
 
@@ -53,10 +56,26 @@ namespace TripRipper
 
       bool verify();
 
-      void insert(const std::pair<std::string, std::string> &tripcode);
+      void insert(const char *tripcode, const char *key);
+
+      size_t size() const { return m_tripcodes.size(); }
+      const char *tripcode(size_t index) const { return m_tripcodes[index].tripcode; }
+      const char *key(size_t index) const { return m_tripcodes[index].key; }
+      void clear() { m_tripcodes.clear(); }
+      void reserve(size_t count) { m_tripcodes.reserve(count); }
 
     private:
-      std::vector<std::pair<std::string, std::string> > m_tripcodes;
+      /**
+       * Entries are stored inline, so that a container that is cleared and
+       * refilled for every KeyBlock only allocates while it grows.
+       */
+      struct Entry
+      {
+        char tripcode[TRIPCODE_SIZE + 1];
+        char key[KEY_SIZE + 1];
+      };
+
+      std::vector<Entry> m_tripcodes;
   };
 
   class TripcodeBlock
@@ -22,40 +22,108 @@
 
 #include "tripcodeCrawler.h"
 #include "common.h"
+#include "allocationTracker.h"
+#include "autotuner.h"
+#include "engineSelector.h"
 #include "strategyFactory.h"
-#include "keyspacePoolFactory.h"
-#include "keyspaceMapping.h"
+#include "keyspaceFactory.h"
+#include "keyspace.h"
+#include "keyspaceDispatcher.h"
+#include "logger.h"
+#include "nodeDispatcher.h"
+#include "poolRequester.h"
+#include "atomicPoolCounter.h"
+#include "checkpoint.h"
+#include "terminationBarrier.h"
+#include "matchLog.h"
+#include "perfCounters.h"
+#include "telemetry.h"
+#include "tracer.h"
 #include "tripcodeAlgorithm.h"
 #include "matchingAlgorithm.h"
 #include "tripcodeContainer.h"
 
-#include <iostream>
+#include <algorithm>
+#include <csignal>
+#include <deque>
+#include <vector>
 using namespace std;
 
 #include <mpi.h>
+#include <unistd.h>
 
 namespace TripRipper
 {
+  // microseconds the root sleeps when polling finds no requests
+  static const useconds_t ROOT_POLL_INTERVAL = 1000;
+  // seconds between reads of the stop flag on the root in ATOMIC_DISPATCH
+  // mode, each of which is a round trip over the network
+  static const double STOP_POLL_INTERVAL = 0.05;
+  // results a worker makes room for up front, so that storing and sending
+  // the matches of a pool does not allocate
+  static const size_t RESERVED_RESULTS = 4096;
+
+  // set by the SIGTERM handler, which stops the search
+  static volatile sig_atomic_t terminateRequested = 0;
+
+  static void handleTerminate(int)
+  {
+    terminateRequested = 1;
+  }
+
   /**
    * The TripcodeCrawler constructor takes as its arguments a number of strings
    * that identify the strategies to be used when searching for tripcodes. These
    * are the same strings that are used for the command line arguments.
    */
   TripcodeCrawler::TripcodeCrawler(const std::string &keyspaceStrategy, const std::string &tripcodeStrategy, const std::string &matchingStrategy, const std::string &matchString) :
+    m_keyspaceStrategy(keyspaceStrategy),
     m_keyspaceMapping(NULL),
+    m_keyspaceDispatcher(NULL),
+    m_nodeDispatcher(NULL),
+    m_dispatchMode(ROOT_DISPATCH),
+    m_resume(false),
+    m_checkpoint(NULL),
+    m_matchLog(NULL),
+    m_matchesLogged(0),
+    m_maxMatches(0),
+    m_timeLimit(0.0),
+    m_startTime(0.0),
+    m_terminationBarrier(NULL),
+    m_stopFlag(NULL),
+    m_stopped(false),
+    m_lastStopPoll(0.0),
+    m_terminationNoticeSent(false),
+    m_terminationNotices(0),
     m_tripcodeAlgorithm(NULL),
-    m_matchingAlgorithm(NULL)
- {
-    m_matchingAlgorithm = StrategyFactory::singleton()->createMatchingAlgorithm(matchingStrategy);
+    m_matchingAlgorithm(NULL),
+    m_blockKeys(0),
+    m_computeCounters(NULL),
+    m_matchCounters(NULL),
+    m_keysSearched(0),
+    m_statusInterval(Telemetry::DEFAULT_INTERVAL),
+    m_telemetry(NULL)
+  {
+    std::string tripcodeAlgorithm = tripcodeStrategy, matchingAlgorithm = matchingStrategy;
+    if(tripcodeStrategy == EngineSelector::AUTO || matchingStrategy == EngineSelector::AUTO)
+      selectEngines(matchString, &tripcodeAlgorithm, &matchingAlgorithm);
+
+    m_matchingAlgorithm = StrategyFactory::singleton()->createMatchingAlgorithm(matchingAlgorithm);
+    m_tripcodeAlgorithm = StrategyFactory::singleton()->createTripcodeAlgorithm(tripcodeAlgorithm);
+    if(m_matchingAlgorithm == NULL || m_tripcodeAlgorithm == NULL)
+      MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
     m_matchingAlgorithm->setMatchString(matchString);
 
-    m_tripcodeAlgorithm = StrategyFactory::singleton()->createTripcodeAlgorithm(tripcodeStrategy);
+    m_profileKey = Autotuner::profileKey(tripcodeAlgorithm, matchingAlgorithm, keyspaceStrategy);
+    m_blockKeys = Autotuner::loadBlockKeys(m_profileKey);
 
     int worldRank;
     MPI_Comm_rank(MPI_COMM_WORLD, &worldRank);
     if(worldRank == ROOT_RANK)
     {
       m_keyspaceMapping = StrategyFactory::singleton()->createKeyspaceMapping(keyspaceStrategy);
+      if(m_keyspaceMapping == NULL)
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
       m_keyspaceMapping->setOutputAlignment(m_tripcodeAlgorithm->inputAlignment());
       m_keyspaceMapping->setOutputStride(m_tripcodeAlgorithm->inputStride());
     }
@@ -65,24 +133,103 @@ namespace TripRipper
   {
     delete m_matchingAlgorithm;
     delete m_tripcodeAlgorithm;
+    delete m_keyspaceDispatcher;  // abandons outstanding leases
+    delete m_nodeDispatcher;
     delete m_keyspaceMapping;
+    delete m_checkpoint;
+    delete m_matchLog;
+    delete m_computeCounters;
+    delete m_matchCounters;
+  }
+
+  void TripcodeCrawler::setPerfCounters(bool enabled)
+  {
+    delete m_computeCounters;
+    delete m_matchCounters;
+    m_computeCounters = m_matchCounters = NULL;
+    if(enabled)
+    {
+      m_computeCounters = new PerfCounters;
+      m_matchCounters = new PerfCounters;
+    }
+  }
+
+  /**
+   * Resolves the "auto" strategies to the algorithms that the EngineSelector
+   * finds fastest. Only the leader of each node benchmarks, so that ranks
+   * don't compete with each other for the CPU, and the other ranks of the
+   * node use its choice. Nodes may choose differently, so doSearch() formats
+   * each pool for the local algorithms.
+   */
+  void TripcodeCrawler::selectEngines(const std::string &matchString, std::string *tripcodeAlgorithm, std::string *matchingAlgorithm)
+  {
+    int worldRank, nodeRank;
+    MPI_Comm nodeComm;
+    MPI_Comm_rank(MPI_COMM_WORLD, &worldRank);
+    MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, worldRank, MPI_INFO_NULL, &nodeComm);
+    MPI_Comm_rank(nodeComm, &nodeRank);
+
+    std::string choice;
+    if(nodeRank == 0)
+    {
+      EngineSelector selector(matchString);
+      if(selector.select(*tripcodeAlgorithm, *matchingAlgorithm, tripcodeAlgorithm, matchingAlgorithm))
+      {
+        char hostname[256] = "";
+        gethostname(hostname, sizeof(hostname) - 1);
+        Logger::info("%s: using tripcode algorithm \"%s\" and matching algorithm \"%s\"",
+            hostname, tripcodeAlgorithm->c_str(), matchingAlgorithm->c_str());
+        choice = *tripcodeAlgorithm + " " + *matchingAlgorithm;
+      }
+      else
+      {
+        Logger::error("No usable tripcode algorithm was found");
+      }
+    }
+
+    int length = choice.size();
+    MPI_Bcast(&length, 1, MPI_INT, 0, nodeComm);
+    std::vector<char> buffer(choice.begin(), choice.end());
+    buffer.resize(length + 1);
+    MPI_Bcast(&buffer[0], length, MPI_CHAR, 0, nodeComm);
+    MPI_Comm_free(&nodeComm);
+    if(length == 0)
+      MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+
+    choice = &buffer[0];
+    size_t space = choice.find(' ');
+    *tripcodeAlgorithm = choice.substr(0, space);
+    *matchingAlgorithm = choice.substr(space + 1);
   }
 
   /**
    * This method contains most of the MPI code that coordinates the efforts
-   * among the crawlers. This method doesn't return until the root MPI process
-   * recieves a SIGTERM signal.
+   * among the crawlers. This method doesn't return until the keyspace has
+   * been exhausted, one of the stop conditions set with setStopConditions()
+   * has been met, or any MPI process recieves a SIGTERM signal.
    *
    * One of the crawlers is designated the root crawler based on its MPI rank.
    * The root crawler instantiates a KeyspaceMapping object to coordinate the
-   * keyspace mapping among the crawlers. In reality the root crawler forks its
-   * tripcode generating thread and continues to listen for KeyspacePool
-   * requests in the main thread.
+   * keyspace mapping among the crawlers. It does not search itself, but
+   * listens for KeyspacePool requests, except in ATOMIC_DISPATCH mode.
+   *
+   * When the root crawler recieves a SIGTERM signal or a stop condition is
+   * met, it signals all of the crawlers to abandon their current pools through
+   * a TerminationBarrier, which the crawlers check between KeyBlocks, and
+   * answers any further requests for pools with TERMINATION_REQUEST. The
+   * KeyspaceMapping object is optionally serialized to disk to allow for the
+   * search to be resumed in the future. Finally, the results that have not
+   * yet reached the root are gathered collectively.
    *
-   * When the root crawler recieves a SIGTERM signal, it signals all of the
-   * crawlers to finish their current pools and optionally serialize the
-   * KeyspaceMapping object to disk to allow for the search to be resumed in the
-   * future.
+   * How ranks obtain their pools depends on dispatchMode(). See
+   * DispatchMode.
+   *
+   * Every rank installs the SIGTERM handler, since job schedulers and
+   * mpirun may deliver the signal to any of them. The handler only sets a
+   * flag. The root checks it between messages, and other ranks check it
+   * between KeyBlocks and send the root a TERMINATION_NOTICE, upon which the
+   * root stops the search through the TerminationBarrier as if it had
+   * received the signal itself.
    *
    * \fixme Catching the SIGTERM signal in a thread that makes MPI calls might
    * not be safe. See section 2.9.2 of the MPI specification.
@@ -93,74 +240,790 @@ namespace TripRipper
     MPI_Comm_rank(MPI_COMM_WORLD, &worldRank);
     MPI_Comm_size(MPI_COMM_WORLD, &worldSize);
 
+    m_startTime = MPI_Wtime();
+    // the allocations of setting up the crawler are not those of the search
+    AllocationTracker::reset();
+    signal(SIGTERM, handleTerminate);
     if(worldRank == ROOT_RANK)
     {
-      /// \todo Spawn a thread so the root process can compute tripcodes and
-      /// coordinate the threads at the same time.
+      if(!m_matchLogPath.empty())
+      {
+        m_matchLog = new MatchLog(m_matchLogPath);
+        if(!m_matchLog->isOpen())
+          MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+      }
+    }
 
-      while(true)
+    // the telemetry of the search is gathered on its own communicator
+    Telemetry telemetry(MPI_COMM_WORLD, ROOT_RANK, m_statusInterval);
+    if(worldRank == ROOT_RANK)
+      telemetry.setStatusPath(m_statusPath);
+    m_telemetry = &telemetry;
+
+    if(m_dispatchMode == ATOMIC_DISPATCH)
+    {
+      runAtomic();
+      telemetry.finish(MPI_Wtime());
+      m_telemetry = NULL;
+      gatherResults();
+      reportCounters();
+      reportAllocations();
+      if(!m_tracePath.empty())
+        Tracer::singleton()->dump(MPI_COMM_WORLD, ROOT_RANK, m_tracePath);
+      return;
+    }
+
+    MPI_Comm poolComm = MPI_COMM_WORLD;
+    int poolSource = ROOT_RANK;
+    if(m_dispatchMode == NODE_DISPATCH)
+      joinNode(&poolComm, &poolSource);
+
+    // the root needs to know how many ranks request pools from it directly
+    int requestsFromRoot = (worldRank != ROOT_RANK && poolComm == MPI_COMM_WORLD) ? 1 : 0;
+    int rootClients = 0;
+    MPI_Reduce(&requestsFromRoot, &rootClients, 1, MPI_INT, MPI_SUM, ROOT_RANK, MPI_COMM_WORLD);
+
+    m_terminationBarrier = new TerminationBarrier(MPI_COMM_WORLD, worldRank != ROOT_RANK);
+    if(worldRank == ROOT_RANK)
+      runRoot(rootClients);
+    else if(m_nodeDispatcher != NULL)
+      runLeader();
+    else
+      runWorker(poolComm, poolSource);
+    m_terminationBarrier->wait();
+    delete m_terminationBarrier;
+    m_terminationBarrier = NULL;
+    // every notice has been sent by now, but the root may have stopped
+    // listening before some of them arrived
+    int noticeSent = m_terminationNoticeSent ? 1 : 0, noticesSent = 0;
+    MPI_Reduce(&noticeSent, &noticesSent, 1, MPI_INT, MPI_SUM, ROOT_RANK, MPI_COMM_WORLD);
+    for(; worldRank == ROOT_RANK && m_terminationNotices < noticesSent; ++m_terminationNotices)
+      MPI_Recv(NULL, 0, MPI_BYTE, MPI_ANY_SOURCE, TERMINATION_NOTICE, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+    telemetry.finish(MPI_Wtime());
+    m_telemetry = NULL;
+    gatherResults();
+    reportCounters();
+    reportAllocations();
+    if(!m_tracePath.empty())
+      Tracer::singleton()->dump(MPI_COMM_WORLD, ROOT_RANK, m_tracePath);
+
+    if(poolComm != MPI_COMM_WORLD)
+      MPI_Comm_free(&poolComm);
+  }
+
+  /**
+   * Collects the results that have not reached the root during the search,
+   * such as those that node leaders collected after their last request to the
+   * root, or every result in ATOMIC_DISPATCH mode. Every rank must call this.
+   * The root then stores the results in the match log, if any, and indexes
+   * the log.
+   */
+  void TripcodeCrawler::gatherResults()
+  {
+    int worldRank, worldSize;
+    MPI_Comm_rank(MPI_COMM_WORLD, &worldRank);
+    MPI_Comm_size(MPI_COMM_WORLD, &worldSize);
+
+    // the root contributes nothing, since its results are already in place
+    int size = 0;
+    uint8_t *buffer = NULL;
+    if(worldRank != ROOT_RANK && !m_results.empty())
+    {
+      size = static_cast<int>(m_results.serialSize());
+      buffer = new uint8_t[size];
+      bool done;
+      m_results.serialize(buffer, size, done);
+      assert(done);
+      m_results.clear();
+    }
+
+    int *sizes = NULL, *offsets = NULL;
+    uint8_t *gathered = NULL;
+    if(worldRank == ROOT_RANK)
+    {
+      sizes = new int[worldSize];
+      offsets = new int[worldSize];
+    }
+    MPI_Gather(&size, 1, MPI_INT, sizes, 1, MPI_INT, ROOT_RANK, MPI_COMM_WORLD);
+    int total = 0;
+    if(worldRank == ROOT_RANK)
+    {
+      for(int i = 0; i < worldSize; ++i)
       {
-        cout << "doing things" << endl;
-        MPI_Status status;
+        offsets[i] = total;
+        total += sizes[i];
+      }
+      gathered = new uint8_t[std::max(total, 1)];
+    }
+    MPI_Gatherv(buffer, size, MPI_BYTE, gathered, sizes, offsets, MPI_BYTE, ROOT_RANK, MPI_COMM_WORLD);
 
-        // blocking receive for requests for keyspace pools
-        MPI_Recv(NULL, 0, MPI_INT, MPI_ANY_SOURCE, KEYSPACE_REQUEST, MPI_COMM_WORLD, &status);
+    if(worldRank == ROOT_RANK)
+    {
+      for(int i = 0; i < worldSize; ++i)
+      {
+        if(sizes[i] == 0)
+          continue;
+        TripcodeSearchResult received;
+        bool done;
+        received.deserialize(gathered + offsets[i], sizes[i], done);
+        assert(done);
+        m_results.merge(received);
+      }
+      storeResults();
+      if(m_matchLog != NULL)
+        m_matchLog->buildIndex();
+    }
+
+    delete[] buffer;
+    delete[] sizes;
+    delete[] offsets;
+    delete[] gathered;
+  }
+
+  /**
+   * Gathers the counts of the PerfCounters of every rank, if enabled, and
+   * prints them per key on the root, for each rank that searched and for all
+   * of them together. Every rank must call this.
+   */
+  void TripcodeCrawler::reportCounters()
+  {
+    if(m_computeCounters == NULL)
+      return;
+    int worldRank, worldSize;
+    MPI_Comm_rank(MPI_COMM_WORLD, &worldRank);
+    MPI_Comm_size(MPI_COMM_WORLD, &worldSize);
+
+    // the keys searched, then the counts of computing and of matching
+    const int FIELDS = 1 + 2 * PerfCounters::NUM_COUNTERS;
+    uint64_t counts[FIELDS];
+    counts[0] = m_keysSearched;
+    m_computeCounters->read(counts + 1);
+    m_matchCounters->read(counts + 1 + PerfCounters::NUM_COUNTERS);
+    std::vector<uint64_t> gathered(worldRank == ROOT_RANK ? FIELDS * worldSize : 1);
+    MPI_Gather(counts, FIELDS, MPI_UINT64_T, &gathered[0], FIELDS, MPI_UINT64_T, ROOT_RANK, MPI_COMM_WORLD);
+    if(worldRank != ROOT_RANK)
+      return;
+
+    uint64_t totals[FIELDS] = { 0 };
+    Logger::info("Performance counters:");
+    for(int rank = 0; rank < worldSize; ++rank)
+    {
+      const uint64_t *rankCounts = &gathered[rank * FIELDS];
+      if(rankCounts[0] == 0)
+        continue;
+      Logger::info("  rank %d compute: %s", rank, PerfCounters::describe(rankCounts + 1, rankCounts[0]).c_str());
+      Logger::info("  rank %d match: %s", rank, PerfCounters::describe(rankCounts + 1 + PerfCounters::NUM_COUNTERS, rankCounts[0]).c_str());
+      for(int i = 0; i < FIELDS; ++i)
+        totals[i] += rankCounts[i];
+    }
+    Logger::info("  all ranks compute: %s", PerfCounters::describe(totals + 1, totals[0]).c_str());
+    Logger::info("  all ranks match: %s", PerfCounters::describe(totals + 1 + PerfCounters::NUM_COUNTERS, totals[0]).c_str());
+  }
+
+  /**
+   * Sums the allocations counted by the AllocationTracker on every rank, if
+   * it is active, and prints them per stage on the root, with the number of
+   * allocations per pool and per block. Every rank must call this.
+   */
+  void TripcodeCrawler::reportAllocations()
+  {
+    if(!AllocationTracker::active())
+      return;
+    int worldRank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &worldRank);
+
+    // the counts of each stage, then the pools, blocks and steady state
+    const int STAGE_FIELDS = AllocationTracker::NUM_STAGES * AllocationTracker::NUM_COUNTERS;
+    uint64_t counts[STAGE_FIELDS + 3];
+    for(int i = 0; i < AllocationTracker::NUM_STAGES; ++i)
+    {
+      for(int j = 0; j < AllocationTracker::NUM_COUNTERS; ++j)
+        counts[i * AllocationTracker::NUM_COUNTERS + j] = AllocationTracker::count(static_cast<AllocationTracker::Stage>(i), static_cast<AllocationTracker::Counter>(j));
+    }
+    counts[STAGE_FIELDS] = AllocationTracker::pools();
+    counts[STAGE_FIELDS + 1] = AllocationTracker::blocks();
+    counts[STAGE_FIELDS + 2] = AllocationTracker::steadyAllocations();
+    uint64_t totals[STAGE_FIELDS + 3];
+    MPI_Reduce(counts, totals, STAGE_FIELDS + 3, MPI_UINT64_T, MPI_SUM, ROOT_RANK, MPI_COMM_WORLD);
+    if(worldRank != ROOT_RANK)
+      return;
+
+    uint64_t stages[AllocationTracker::NUM_STAGES][AllocationTracker::NUM_COUNTERS];
+    std::copy(totals, totals + STAGE_FIELDS, &stages[0][0]);
+    Logger::info("Allocations of all ranks:");
+    Logger::info("%s", AllocationTracker::describe(stages, totals[STAGE_FIELDS], totals[STAGE_FIELDS + 1], totals[STAGE_FIELDS + 2]).c_str());
+  }
+
+  /**
+   * Moves the results held by the root into the match log, if there is one.
+   */
+  void TripcodeCrawler::storeResults()
+  {
+    if(m_matchLog == NULL)
+      return;
+    m_matchLog->append(m_results);
+    m_matchesLogged += m_results.size();
+    m_results.clear();
+  }
+
+  /**
+   * Returns true if one of the stop conditions has been met. In
+   * ATOMIC_DISPATCH mode, where every rank checks the time limit itself,
+   * only the SIGTERM handler and the time limit are considered; the
+   * match limit is checked in runAtomic().
+   */
+  bool TripcodeCrawler::goalReached(double now)
+  {
+    if(terminateRequested)
+      return true;
+    if(m_timeLimit > 0.0 && now - m_startTime >= m_timeLimit)
+      return true;
+    return m_stopFlag == NULL && m_maxMatches > 0 && m_matchesLogged + m_results.size() >= m_maxMatches;
+  }
 
-        /// \todo Need to document the ownership of a lot of these buffers.
-        // construct a KeyspacePool object suitable for serialization and
-        // transmission
-        assert(m_keyspaceMapping != NULL);
-        KeyspacePool *keyspacePool = m_keyspaceMapping->getNextPool();
+  /**
+   * Returns true if the search has been stopped. This is called between
+   * KeyBlocks, so it must not block. Outside of ATOMIC_DISPATCH mode, this
+   * tests the TerminationBarrier, and tells the root once if this rank has
+   * received SIGTERM. In ATOMIC_DISPATCH mode, this raises the stop flag on
+   * the root if a stop condition has been met locally, and otherwise reads
+   * it at most every STOP_POLL_INTERVAL seconds.
+   */
+  bool TripcodeCrawler::stopRequested()
+  {
+    if(m_stopped)
+      return true;
+    if(m_stopFlag != NULL)
+    {
+      double now = MPI_Wtime();
+      if(goalReached(now))
+      {
+        m_stopFlag->fetchAndAdd(1);
+        m_stopped = true;
+      }
+      else if(now - m_lastStopPoll >= STOP_POLL_INTERVAL)
+      {
+        m_lastStopPoll = now;
+        m_stopped = m_stopFlag->fetchAndAdd(0) > 0;
+      }
+    }
+    else if(m_terminationBarrier != NULL)
+    {
+      m_stopped = m_terminationBarrier->test();
+      if(!m_stopped && terminateRequested && !m_terminationNoticeSent)
+      {
+        MPI_Send(NULL, 0, MPI_BYTE, ROOT_RANK, TERMINATION_NOTICE, MPI_COMM_WORLD);
+        m_terminationNoticeSent = true;
+      }
+    }
+    return m_stopped;
+  }
+
+  /**
+   * Splits MPI_COMM_WORLD into one communicator per shared memory node and
+   * elects a node leader for each, which becomes the source of pools for the
+   * other ranks on the node. Ranks on the same node as the root request pools
+   * from the root directly, since there is nothing to be gained by
+   * interposing a leader there.
+   *
+   * The communicator of the node is returned in poolComm, and the rank in
+   * poolComm from which pools should be requested is returned in poolSource.
+   * Node leaders construct m_nodeDispatcher.
+   */
+  void TripcodeCrawler::joinNode(MPI_Comm *poolComm, int *poolSource)
+  {
+    int worldRank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &worldRank);
+
+    MPI_Comm nodeComm;
+    MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, worldRank, MPI_INFO_NULL, &nodeComm);
+    int nodeRank, nodeSize;
+    MPI_Comm_rank(nodeComm, &nodeRank);
+    MPI_Comm_size(nodeComm, &nodeSize);
+    int hasRoot = (worldRank == ROOT_RANK) ? 1 : 0;
+    MPI_Allreduce(MPI_IN_PLACE, &hasRoot, 1, MPI_INT, MPI_MAX, nodeComm);
+
+    if(hasRoot || nodeSize == 1)
+    {
+      MPI_Comm_free(&nodeComm);
+      return;
+    }
+
+    // the node leader is the lowest world rank on the node, since nodeComm
+    // was ordered by world rank
+    *poolComm = nodeComm;
+    *poolSource = 0;
+    if(nodeRank == 0)
+      m_nodeDispatcher = new NodeDispatcher(nodeComm);
+  }
+
+  /**
+   * The main loop of the root process, which hands out leases until each of
+   * the given number of ranks that request pools from the root have been
+   * told that the keyspace is exhausted. Leases that outlive their deadline
+   * are expired, and straggling leases are re-executed speculatively near the
+   * end of the search; see KeyspaceDispatcher.
+   */
+  void TripcodeCrawler::runRoot(int clients)
+  {
+    /// \todo Spawn a thread so the root process can compute tripcodes and
+    /// coordinate the threads at the same time.
+
+    int worldSize;
+    MPI_Comm_size(MPI_COMM_WORLD, &worldSize);
+
+    if(!m_checkpointPath.empty())
+    {
+      m_checkpoint = new Checkpoint(m_checkpointPath, m_resume);
+      m_checkpoint->setMatchLog(m_matchLog);
+      if(m_resume)
+      {
+        KeyspaceMapping *resumed = m_checkpoint->resume();
+        if(resumed == NULL)
+        {
+          Logger::error("Could not resume from checkpoint %s", m_checkpointPath.c_str());
+          MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+        }
+        delete m_keyspaceMapping;
+        m_keyspaceMapping = resumed;
+        m_keyspaceMapping->setOutputAlignment(m_tripcodeAlgorithm->inputAlignment());
+        m_keyspaceMapping->setOutputStride(m_tripcodeAlgorithm->inputStride());
+      }
+      // compacts the log replayed on resume, and replaces the checkpoint of
+      // any previous search otherwise
+      m_checkpoint->snapshot(m_keyspaceMapping, MPI_Wtime());
+    }
+
+    m_keyspaceDispatcher = new KeyspaceDispatcher(m_keyspaceMapping, worldSize);
+    m_telemetry->setPools(m_keyspaceMapping->poolsLeft(), m_keyspaceMapping->totalPools(), m_keyspaceMapping->poolSize());
+
+    // ranks that are waiting for a pool while every pool is leased out
+    std::deque<int> waiting;
+    // number of ranks that have been told there are no pools left
+    int ranksFinished = 0;
+    // set once a stop condition has been met
+    bool stopping = false;
+    double lastMatchSync = MPI_Wtime();
+    while(ranksFinished < clients)
+    {
+      MPI_Status status;
+      int pending;
+
+      // poll for requests for keyspace pools, so that leases can expire while
+      // no requests arrive. Requests that carry results arrive as
+      // POOL_EXHAUSTED_RESULT rather than KEYSPACE_REQUEST.
+      MPI_Iprobe(MPI_ANY_SOURCE, MPI_ANY_TAG, MPI_COMM_WORLD, &pending, &status);
+      double now = MPI_Wtime();
+      if(pending && status.MPI_TAG == TERMINATION_NOTICE)
+      {
+        // another rank has received SIGTERM
+        MPI_Recv(NULL, 0, MPI_BYTE, status.MPI_SOURCE, TERMINATION_NOTICE, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+        ++m_terminationNotices;
+        terminateRequested = 1;
+      }
+      else if(pending)
+      {
+        TRIPRIPPER_TRACE_BEGIN(ROOT_REQUEST);
+        PoolRequester::receiveRequest(MPI_COMM_WORLD, status, &m_results);
+        storeResults();
+
+        // a request for a new pool means the previous lease of that rank has
+        // been exhausted, unless the rank abandoned it because the search
+        // was stopped
+        KeyspacePool *lease = m_keyspaceDispatcher->lease(status.MPI_SOURCE);
+        if(stopping)
+        {
+          m_keyspaceDispatcher->abandonLease(status.MPI_SOURCE);
+        }
+        else
+        {
+          if(lease != NULL && m_checkpoint != NULL)
+            m_checkpoint->logCheckin(lease, now);
+          m_keyspaceDispatcher->checkinLease(status.MPI_SOURCE, now);
+        }
+        waiting.push_back(status.MPI_SOURCE);
+        TRIPRIPPER_TRACE_END(ROOT_REQUEST);
+      }
+      else
+      {
+        // return the pools of hung or straggling ranks to the mapping
+        int expired = m_keyspaceDispatcher->expireLeases(now);
+        if(expired == 0)
+          usleep(ROOT_POLL_INTERVAL);
+        else
+          Logger::debug("%d leases expired", expired);
+      }
+
+      if(!stopping && goalReached(now))
+      {
+        // ranks abandon their pools at the next KeyBlock
+        stopping = true;
+        m_terminationBarrier->signal();
+      }
+
+      if(m_checkpoint != NULL && m_checkpoint->snapshotDue(now))
+        m_checkpoint->snapshot(m_keyspaceMapping, now);
+      // without a checkpoint, the match log is synced on its own
+      if(m_checkpoint == NULL && m_matchLog != NULL && now - lastMatchSync >= Checkpoint::SYNC_INTERVAL)
+      {
+        m_matchLog->sync();
+        lastMatchSync = now;
+      }
+
+      m_telemetry->poll(now);
+
+      // give each waiting rank a lease, sized according to its throughput,
+      // or a speculative copy of a straggling lease. Ranks are only told
+      // that the keyspace is exhausted once every pool has been checked in,
+      // since expired leases can return pools to the mapping until then.
+      // Once one rank has to keep waiting, so do the rest, so they are not
+      // asked for, which would scan every lease for each of them.
+      bool leasesLeft = true;
+      for(size_t i = waiting.size(); i > 0; --i)
+      {
+        int rank = waiting.front();
+        waiting.pop_front();
+        if(stopping)
+        {
+          MPI_Send(NULL, 0, MPI_BYTE, rank, TERMINATION_REQUEST, MPI_COMM_WORLD);
+          ++ranksFinished;
+          continue;
+        }
+        if(!leasesLeft)
+        {
+          waiting.push_back(rank);
+          continue;
+        }
+        TRIPRIPPER_TRACE_BEGIN(ROOT_RESPONSE);
+        KeyspacePool *keyspacePool = m_keyspaceDispatcher->checkoutLease(rank, now);
+        if(keyspacePool == NULL)
+        {
+          TRIPRIPPER_TRACE_END(ROOT_RESPONSE);
+          if(m_keyspaceDispatcher->finished())
+          {
+            // an empty response tells the rank that the keyspace is exhausted
+            MPI_Send(NULL, 0, MPI_BYTE, rank, KEYSPACE_RESPONSE, MPI_COMM_WORLD);
+            ++ranksFinished;
+            Logger::debug("No pools left for rank %d", rank);
+          }
+          else
+          {
+            waiting.push_back(rank);
+            leasesLeft = false;
+          }
+          continue;
+        }
+        // the dispatcher retains ownership of keyspacePool; we own poolData
         size_t poolDataSize;
         uint8_t *poolData = keyspacePool->serialize(&poolDataSize);
         // blocking response to keyspace pool request with serialized
         // KeyspacePool object
-        MPI_Send(poolData, static_cast<int>(poolDataSize), MPI_BYTE, status.MPI_SOURCE, KEYSPACE_RESPONSE, MPI_COMM_WORLD);
-        delete keyspacePool;
-        delete poolData;
+        MPI_Send(poolData, static_cast<int>(poolDataSize), MPI_BYTE, rank, KEYSPACE_RESPONSE, MPI_COMM_WORLD);
+        delete[] poolData;
+        TRIPRIPPER_TRACE_END(ROOT_RESPONSE);
+        Logger::debug("Leased %llu pools to rank %d", static_cast<unsigned long long>(keyspacePool->poolCount()), rank);
       }
     }
-    else
+
+    // outstanding leases are treated as abandoned by the snapshot
+    if(m_checkpoint != NULL)
+    {
+      m_checkpoint->snapshot(m_keyspaceMapping, MPI_Wtime());
+      if(terminateRequested)
+        Logger::warning("Terminated; checkpoint written to %s", m_checkpointPath.c_str());
+    }
+  }
+
+  /**
+   * The main loop of a node leader, which searches pools from its own lease
+   * while handing out the rest of the lease to the ranks on its node.
+   */
+  void TripcodeCrawler::runLeader()
+  {
+    assert(m_nodeDispatcher != NULL);
+    KeyspacePool *keyspacePool;
+    TripcodeSearchResult results;
+    while(true)
+    {
+      double start = MPI_Wtime();
+      {
+        AllocationStage stage(AllocationTracker::POOL_REQUEST);
+        keyspacePool = m_nodeDispatcher->checkoutPool();
+      }
+      m_telemetry->addIdleTime(MPI_Wtime() - start);
+      if(keyspacePool == NULL)
+        break;
+      doSearch(keyspacePool, &results);
+      delete keyspacePool;
+      m_nodeDispatcher->addResults(results);
+      results.clear();
+      if(stopRequested())
+      {
+        m_nodeDispatcher->stop();
+        break;
+      }
+    }
+    m_nodeDispatcher->finish();
+    // what has been collected since the last lease is gathered at the end
+    m_results.merge(m_nodeDispatcher->results());
+  }
+
+  /**
+   * The main loop of a worker, which requests pools from the given rank of
+   * the given communicator until the keyspace is exhausted. The pool source
+   * is either the root or the leader of the node. The results of each pool
+   * are sent along with the request for the next pool; see PoolRequester.
+   *
+   * Each pool is recycled for the next one, and the containers keep their
+   * capacity, so once the first pool has been searched the loop does not
+   * allocate; everything after it is counted as steady state by the
+   * AllocationTracker.
+   */
+  void TripcodeCrawler::runWorker(MPI_Comm poolComm, int poolSource)
+  {
+    PoolRequester requester(poolComm, poolSource);
+    TripcodeSearchResult results;
+    results.reserve(RESERVED_RESULTS);
+    KeyspacePool *keyspacePool = NULL;
+    while(true)
     {
-      while(true)
+      double start = MPI_Wtime();
       {
-        MPI_Status status;
+        AllocationStage stage(AllocationTracker::POOL_REQUEST);
+        keyspacePool = requester.requestPool(results, keyspacePool);
+      }
+      if(m_telemetry != NULL)
+        m_telemetry->addIdleTime(MPI_Wtime() - start);
+      results.clear();
+      if(keyspacePool == NULL)
+        break;  // the keyspace has been exhausted
 
-        // request a new keyspace pool
-        MPI_Send(NULL, 0, MPI_INT, ROOT_RANK, KEYSPACE_REQUEST, MPI_COMM_WORLD);
+      // a stopped search ends the pool early; the root answers the next
+      // request with TERMINATION_REQUEST
+      doSearch(keyspacePool, &results);
+      AllocationTracker::setSteadyState(true);
+    }
+    AllocationTracker::setSteadyState(false);
+  }
 
-        // recieve the serialized KeyspacePool object
-        MPI_Probe(ROOT_RANK, KEYSPACE_RESPONSE, MPI_COMM_WORLD, &status);
-        size_t poolDataSize;
-        MPI_Get_count(&status, MPI_BYTE, reinterpret_cast<int*>(poolDataSize));
-        uint8_t *poolData = new uint8_t[poolDataSize];
-        MPI_Recv(poolData, static_cast<int>(poolDataSize), MPI_BYTE, ROOT_RANK, KEYSPACE_RESPONSE, MPI_COMM_WORLD, &status);
-        KeyspacePool *keyspacePool = KeyspacePoolFactory::singleton()->createKeyspacePool(poolData, poolDataSize);
-        delete poolData;  /// \todo We might want to explore the speed benefit
-        /// of a custom memory allocater here and a few other places.
-
-        TripcodeContainer tripcodes, matches;
-        KeyBlock *currentBlock;
-        while((currentBlock = keyspacePool->getNextBlock()) != NULL)
-        {
-          m_tripcodeAlgorithm->computeTripcodes(currentBlock, &tripcodes);
-          m_matchingAlgorithm->matchTripcodes(&tripcodes, &matches);
-        }
+  /**
+   * The main loop of every rank in ATOMIC_DISPATCH mode. Ranks claim ranges
+   * of pool indices from an AtomicPoolCounter hosted on the root and
+   * construct the pools with KeyspaceMapping::createPool(), so pools are
+   * handed out without the root's CPU being involved. The size of each claim
+   * follows the same throughput based, guided sizing that the root's
+   * KeyspaceDispatcher uses, with the throughput measured locally.
+   *
+   * Without a dispatcher to stop the search, ranks share a stop flag and a
+   * count of matches on the root, both also AtomicPoolCounter objects. A rank
+   * that meets a stop condition raises the flag, and every rank reads it
+   * between KeyBlocks.
+   *
+   * \note The root's KeyspaceMapping does not learn which pools have been
+   * searched in this mode, so its state cannot be used to resume a search.
+   */
+  void TripcodeCrawler::runAtomic()
+  {
+    int worldRank, worldSize;
+    MPI_Comm_rank(MPI_COMM_WORLD, &worldRank);
+    MPI_Comm_size(MPI_COMM_WORLD, &worldSize);
+
+    // every rank needs its own mapping to construct pools from indices
+    if(m_keyspaceMapping == NULL)
+    {
+      m_keyspaceMapping = StrategyFactory::singleton()->createKeyspaceMapping(m_keyspaceStrategy);
+      if(m_keyspaceMapping == NULL)
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+      m_keyspaceMapping->setOutputAlignment(m_tripcodeAlgorithm->inputAlignment());
+      m_keyspaceMapping->setOutputStride(m_tripcodeAlgorithm->inputStride());
+    }
+    uint64_t totalPools = m_keyspaceMapping->totalPools();
+    KeyspacePool *probe = m_keyspaceMapping->createPool(0, 1);
+    if(probe == NULL)
+    {
+      Logger::error("The keyspace mapping \"%s\" does not support atomic dispatch.", m_keyspaceStrategy.c_str());
+      MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+    delete probe;
+
+    AtomicPoolCounter counter(MPI_COMM_WORLD, ROOT_RANK, 0);
+    AtomicPoolCounter matchCounter(MPI_COMM_WORLD, ROOT_RANK, 0);
+    AtomicPoolCounter stopFlag(MPI_COMM_WORLD, ROOT_RANK, 0);
+    m_stopFlag = &stopFlag;
+    // every pool is left, since the mapping cannot be resumed in this mode
+    if(worldRank == ROOT_RANK)
+      m_telemetry->setPools(totalPools, totalPools, m_keyspaceMapping->poolSize());
+    uint64_t claimSize = 1;
+    while(!stopRequested())
+    {
+      double claimStart = MPI_Wtime();
+      TRIPRIPPER_TRACE_BEGIN(POOL_REQUEST);
+      uint64_t firstPool = counter.fetchAndAdd(claimSize);
+      TRIPRIPPER_TRACE_END(POOL_REQUEST);
+      m_telemetry->addIdleTime(MPI_Wtime() - claimStart);
+      if(firstPool >= totalPools)
+        break;
+      uint64_t poolCount = std::min(claimSize, totalPools - firstPool);
+      KeyspacePool *keyspacePool;
+      {
+        AllocationStage stage(AllocationTracker::POOL_REQUEST);
+        keyspacePool = m_keyspaceMapping->createPool(firstPool, poolCount);
+      }
 
-        // TODO: send TripcodeSearchResult to ROOT_RANK
+      double start = MPI_Wtime();
+      size_t matches = m_results.size();
+      doSearch(keyspacePool, &m_results);
+      double elapsed = MPI_Wtime() - start;
+      delete keyspacePool;
 
-        delete keyspacePool;
+      matches = m_results.size() - matches;
+      if(m_maxMatches > 0 && matches > 0 && matchCounter.fetchAndAdd(matches) + matches >= m_maxMatches)
+        stopFlag.fetchAndAdd(1);
+      storeResults();
 
-        // TODO: check for termination signal
+      double throughput = 0.0;
+      if(elapsed > 0.0)
+        throughput = static_cast<double>(poolCount) * m_keyspaceMapping->poolSize() / elapsed;
+      // the pools after our claim are a lower bound on the pools left
+      claimSize = KeyspaceDispatcher::guidedLeaseSize(throughput,
+          KeyspaceDispatcher::DEFAULT_LEASE_TIME, m_keyspaceMapping->poolSize(),
+          totalPools - (firstPool + poolCount), worldSize);
+    }
+    m_stopFlag = NULL;
+  }
+
+  /**
+   * Measures the fastest block size for the algorithms of each node on the
+   * keyspace given to the constructor, and stores it in the profile of the
+   * node, instead of searching. The root hands every rank a copy of the first
+   * pool of the keyspace to measure with, and the leader of each node runs
+   * the Autotuner while the other ranks of the node wait, so that they don't
+   * compete with it for the CPU.
+   */
+  void TripcodeCrawler::tune()
+  {
+    int worldRank, nodeRank;
+    MPI_Comm nodeComm;
+    MPI_Comm_rank(MPI_COMM_WORLD, &worldRank);
+    MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, worldRank, MPI_INFO_NULL, &nodeComm);
+    MPI_Comm_rank(nodeComm, &nodeRank);
+
+    uint64_t poolSize = 0;
+    uint8_t *poolData = NULL;
+    if(worldRank == ROOT_RANK)
+    {
+      KeyspacePool *pool = m_keyspaceMapping->checkoutNextPool();
+      if(pool != NULL)
+      {
+        size_t size;
+        poolData = pool->serialize(&size);
+        poolSize = size;
+        m_keyspaceMapping->abandonPool(pool);
+        delete pool;
+      }
+      else
+      {
+        Logger::error("The keyspace has no pools to tune with");
       }
     }
+    MPI_Bcast(&poolSize, 1, MPI_UINT64_T, ROOT_RANK, MPI_COMM_WORLD);
+    if(poolSize > 0)
+    {
+      if(poolData == NULL)
+        poolData = new uint8_t[poolSize];
+      MPI_Bcast(poolData, poolSize, MPI_BYTE, ROOT_RANK, MPI_COMM_WORLD);
+      if(nodeRank == 0)
+      {
+        Autotuner tuner(m_tripcodeAlgorithm, m_matchingAlgorithm);
+        double rate;
+        size_t blockKeys = tuner.tuneBlockKeys(poolData, poolSize, &rate);
+        char hostname[256] = "";
+        gethostname(hostname, sizeof(hostname) - 1);
+        if(blockKeys > 0)
+        {
+          Autotuner::saveBlockKeys(m_profileKey, blockKeys, rate);
+          Logger::info("%s: %llu keys per block, %llu keys per second", hostname,
+              static_cast<unsigned long long>(blockKeys), static_cast<unsigned long long>(rate));
+        }
+        else
+        {
+          Logger::error("%s: the keyspace could not be searched", hostname);
+        }
+      }
+    }
+    delete[] poolData;
+    MPI_Barrier(nodeComm);
+    MPI_Comm_free(&nodeComm);
   }
 
   /**
    * This method coordinates the three classes KeyspacePool, TripcodeAlgorithm,
-   * and MatchingAlgorithm to perform the actual tripcode search.
+   * and MatchingAlgorithm to perform the actual tripcode search of the given
+   * pool. Matches are appended to results. Node leaders answer requests from
+   * their local ranks between blocks. If the search is stopped, the rest of
+   * the pool is abandoned.
+   *
+   * The containers keep their capacity from pool to pool, so only the first
+   * pool that is searched may allocate; see runWorker().
    */
-  void TripcodeCrawler::doSearch()
+  void TripcodeCrawler::doSearch(KeyspacePool *keyspacePool, TripcodeSearchResult *results)
   {
+    // the pool was formatted for the algorithms of the root, which may differ
+    keyspacePool->setOutputAlignment(m_tripcodeAlgorithm->inputAlignment());
+    keyspacePool->setOutputStride(m_tripcodeAlgorithm->inputStride());
+    keyspacePool->setBlockKeys(m_blockKeys);
+    if(m_telemetry != NULL)
+      m_telemetry->add(Telemetry::POOLS, keyspacePool->poolCount());
+
+    AllocationTracker::countPool();
+    while(true)
+    {
+      KeyBlock *currentBlock;
+      {
+        AllocationStage stage(AllocationTracker::KEY_GENERATION);
+        currentBlock = keyspacePool->getNextBlock();
+      }
+      if(currentBlock == NULL)
+        break;
+      AllocationTracker::countBlock();
+      TRIPRIPPER_TRACE_BEGIN(BLOCK_COMPUTE);
+      if(m_computeCounters != NULL)
+        m_computeCounters->start();
+      AllocationTracker::setStage(AllocationTracker::TRIPCODES);
+      m_tripcodeAlgorithm->computeTripcodes(currentBlock, &m_tripcodes);
+      if(m_computeCounters != NULL)
+      {
+        m_computeCounters->stop();
+        m_matchCounters->start();
+      }
+      TRIPRIPPER_TRACE_END(BLOCK_COMPUTE);
+      TRIPRIPPER_TRACE_BEGIN(MATCH);
+      AllocationTracker::setStage(AllocationTracker::MATCHING);
+      // every tripcode of a block may match, so matching never grows the
+      // container after the first block
+      m_matches.reserve(m_tripcodes.size());
+      m_matchingAlgorithm->matchTripcodes(&m_tripcodes, &m_matches);
+      if(m_matchCounters != NULL)
+        m_matchCounters->stop();
+      TRIPRIPPER_TRACE_END(MATCH);
+      AllocationTracker::setStage(AllocationTracker::RESULTS);
+      m_keysSearched += currentBlock->numKeys();
+      for(size_t i = 0; i < m_matches.size(); ++i)
+        results->insert(m_matches.key(i), m_matches.tripcode(i));
+      AllocationTracker::setStage(AllocationTracker::OTHER);
+      if(m_telemetry != NULL)
+      {
+        m_telemetry->add(Telemetry::KEYS, currentBlock->numKeys());
+        m_telemetry->add(Telemetry::BLOCKS, 1);
+        m_telemetry->add(Telemetry::HITS, m_matches.size());
+        m_telemetry->poll(MPI_Wtime());
+      }
+      m_tripcodes.clear();
+      m_matches.clear();
+      if(m_nodeDispatcher != NULL)
+        m_nodeDispatcher->serviceRequests();
+      if(stopRequested())
+        break;
+    }
   }
 }
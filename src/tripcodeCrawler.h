@@ -23,14 +23,27 @@
 #ifndef TRIPCODE_CRAWLER_H_
 #define TRIPCODE_CRAWLER_H_
 
+#include "tripcodeContainer.h"
+#include "tripcodeSearchResult.h"
+
 #include <string>
 
+#include <mpi.h>
+
 namespace TripRipper
 {
   class KeyspaceMapping;
   class TripcodeAlgorithm;
   class MatchingAlgorithm;
   class KeyspacePool;
+  class KeyspaceDispatcher;
+  class NodeDispatcher;
+  class Checkpoint;
+  class TerminationBarrier;
+  class MatchLog;
+  class AtomicPoolCounter;
+  class PerfCounters;
+  class Telemetry;
 
   /**
    * The TripcodeCrawler class is the main workhorse class for computing
@@ -45,13 +58,133 @@ namespace TripRipper
       TripcodeCrawler(const std::string &keyspaceStrategy, const std::string &tripcodeStrategy, const std::string &matchingStrategy, const std::string &matchString);
       ~TripcodeCrawler();
 
+      /**
+       * DispatchMode determines how ranks obtain keyspace pools.
+       *
+       * With ROOT_DISPATCH, every rank requests pools from the root, which
+       * sizes leases with a KeyspaceDispatcher. With NODE_DISPATCH, ranks
+       * request pools from a leader on their node, which in turn leases from
+       * the root; see NodeDispatcher. With ATOMIC_DISPATCH, ranks claim pool
+       * indices from an AtomicPoolCounter on the root and construct the pools
+       * themselves, and the root searches the keyspace like any other rank.
+       */
+      enum DispatchMode { ROOT_DISPATCH = 1, NODE_DISPATCH, ATOMIC_DISPATCH };
+
+      DispatchMode dispatchMode() const { return m_dispatchMode; }
+      void setDispatchMode(DispatchMode mode) { m_dispatchMode = mode; }
+
+      /**
+       * If a checkpoint path is set, the root persists the state of the
+       * keyspace mapping to that path, and if resume is true the mapping is
+       * restored from the checkpoint before the search starts. See
+       * Checkpoint.
+       */
+      const std::string &checkpointPath() const { return m_checkpointPath; }
+      void setCheckpoint(const std::string &path, bool resume) { m_checkpointPath = path; m_resume = resume; }
+
+      /**
+       * The search stops early once at least maxMatches matches have been
+       * found, or once timeLimit seconds have passed since run() was called.
+       * Zero disables either condition. The search also stops when any rank
+       * receives SIGTERM.
+       */
+      void setStopConditions(uint64_t maxMatches, double timeLimit) { m_maxMatches = maxMatches; m_timeLimit = timeLimit; }
+
+      /**
+       * If enabled, each rank counts hardware events around the calls to the
+       * tripcode and matching algorithms, and run() prints them per key for
+       * each rank once the search is over. Every rank must be given the same
+       * setting. See PerfCounters.
+       */
+      void setPerfCounters(bool enabled);
+
+      /**
+       * Every interval seconds, the root prints the throughput of the
+       * cluster, the pools searched, an estimate of the time left and the
+       * ranks that are falling behind, and writes them to the status file, if
+       * any. Zero disables the periodic reports; a summary is printed once the
+       * search is over either way. Every rank must be given the same
+       * interval. See Telemetry.
+       */
+      void setStatus(double interval, const std::string &path) { m_statusInterval = interval; m_statusPath = path; }
+
+      /**
+       * If a trace path is set, run() writes the events that every rank has
+       * recorded with the Tracer to that path once the search is over. Only
+       * builds with TRIPRIPPER_TRACE record events.
+       */
+      const std::string &tracePath() const { return m_tracePath; }
+      void setTrace(const std::string &path) { m_tracePath = path; }
+
       void run();
-      void doSearch();
+      void tune();
+      void doSearch(KeyspacePool *keyspacePool, TripcodeSearchResult *results);
+      void runWorker(MPI_Comm poolComm, int poolSource);
+
+      /**
+       * If a match log path is set, the root streams matches into a MatchLog
+       * at that path rather than keeping them in memory, and indexes the log
+       * once the search is over.
+       */
+      const std::string &matchLogPath() const { return m_matchLogPath; }
+      void setMatchLog(const std::string &path) { m_matchLogPath = path; }
+
+      /**
+       * Returns the results of the search. Only the root holds the results
+       * once run() has returned, and only if no match log is set.
+       */
+      const TripcodeSearchResult &results() const { return m_results; }
 
     private:
+      void selectEngines(const std::string &matchString, std::string *tripcodeAlgorithm, std::string *matchingAlgorithm);
+      void joinNode(MPI_Comm *poolComm, int *poolSource);
+      void runRoot(int clients);
+      void runLeader();
+      void runAtomic();
+      void gatherResults();
+      void storeResults();
+      bool goalReached(double now);
+      bool stopRequested();
+      void reportCounters();
+      void reportAllocations();
+
+      std::string m_keyspaceStrategy;
       KeyspaceMapping *m_keyspaceMapping;
+      KeyspaceDispatcher *m_keyspaceDispatcher;
+      NodeDispatcher *m_nodeDispatcher;
+      DispatchMode m_dispatchMode;
+      std::string m_checkpointPath;
+      bool m_resume;
+      Checkpoint *m_checkpoint;
+      TripcodeSearchResult m_results;
+      std::string m_matchLogPath;
+      MatchLog *m_matchLog;
+      uint64_t m_matchesLogged;
+      uint64_t m_maxMatches;
+      double m_timeLimit;
+      double m_startTime;
+      TerminationBarrier *m_terminationBarrier;
+      AtomicPoolCounter *m_stopFlag;
+      bool m_stopped;
+      double m_lastStopPoll;
+      // whether this rank has asked the root to stop after SIGTERM, and how
+      // many ranks have asked the root
+      bool m_terminationNoticeSent;
+      int m_terminationNotices;
       TripcodeAlgorithm *m_tripcodeAlgorithm;
       MatchingAlgorithm *m_matchingAlgorithm;
+      // the key of the Autotuner profile of the algorithms and keyspace, and
+      // the number of keys per block stored in it, or 0 for the default
+      std::string m_profileKey;
+      size_t m_blockKeys;
+      PerfCounters *m_computeCounters, *m_matchCounters;
+      uint64_t m_keysSearched;
+      double m_statusInterval;
+      std::string m_statusPath;
+      Telemetry *m_telemetry;
+      std::string m_tracePath;
+      // reused by every block, so that the search does not allocate them
+      TripcodeContainer m_tripcodes, m_matches;
   };
 }
 
@@ -21,9 +21,17 @@
  ******************************************************************************/
 
 #include "tripcodeSearchResult.h"
+#include "serialization.h"
+
+#include <algorithm>
+#include <cstring>
 
 namespace TripRipper
 {
+  const size_t TripcodeSearchResult::KEY_SIZE;
+  const size_t TripcodeSearchResult::TRIPCODE_SIZE;
+  const size_t TripcodeSearchResult::RECORD_SIZE;
+
   TripcodeSearchResult::TripcodeSearchResult()
   {
   }
@@ -32,11 +40,94 @@ namespace TripRipper
   {
   }
 
-  void TripcodeSearchResult::serialize(unsigned char *buffer, size_t size, bool &done)
+  /**
+   * Adds a result. Keys longer than KEY_SIZE are truncated, which loses
+   * nothing since crypt(3) ignores everything past the eighth character.
+   */
+  void TripcodeSearchResult::insert(const std::string &key, const std::string &tripcode)
+  {
+    assert(tripcode.size() == TRIPCODE_SIZE);
+    size_t offset = m_records.size();
+    m_records.resize(offset + RECORD_SIZE, 0);
+    memcpy(&m_records[offset], key.data(), std::min(key.size(), KEY_SIZE));
+    memcpy(&m_records[offset + KEY_SIZE], tripcode.data(), TRIPCODE_SIZE);
+  }
+
+  /**
+   * Adds a result from a key of at most KEY_SIZE characters, which is NUL
+   * terminated if shorter, and the TRIPCODE_SIZE characters of its tripcode.
+   * Unlike insert() with strings, this only allocates when the results
+   * outgrow the room they have.
+   */
+  void TripcodeSearchResult::insert(const char *key, const char *tripcode)
+  {
+    size_t offset = m_records.size();
+    m_records.resize(offset + RECORD_SIZE, 0);
+    memcpy(&m_records[offset], key, strnlen(key, KEY_SIZE));
+    memcpy(&m_records[offset + KEY_SIZE], tripcode, TRIPCODE_SIZE);
+  }
+
+  std::string TripcodeSearchResult::key(size_t index) const
+  {
+    const char *key = reinterpret_cast<const char*>(record(index));
+    return std::string(key, strnlen(key, KEY_SIZE));
+  }
+
+  std::string TripcodeSearchResult::tripcode(size_t index) const
   {
+    return std::string(reinterpret_cast<const char*>(record(index)) + KEY_SIZE, TRIPCODE_SIZE);
   }
 
+  size_t TripcodeSearchResult::serialSize() const
+  {
+    return 4 + m_records.size();
+  }
+
+  /**
+   * Returns the largest serialSize() the results can reach without
+   * allocating.
+   */
+  size_t TripcodeSearchResult::serialCapacity() const
+  {
+    return 4 + m_records.capacity() / RECORD_SIZE * RECORD_SIZE;
+  }
+
+  /**
+   * Writes the serial representation of the results to buffer, which is size
+   * bytes large. done is set to true if the results fit.
+   */
+  void TripcodeSearchResult::serialize(unsigned char *buffer, size_t size, bool &done) const
+  {
+    done = false;
+    if(size < serialSize())
+      return;
+    writeUint32(buffer, static_cast<uint32_t>(this->size()));
+    if(!m_records.empty())
+      memcpy(buffer + 4, &m_records[0], m_records.size());
+    done = true;
+  }
+
+  /**
+   * Replaces the results with those serialized in buffer. done is set to
+   * true if buffer held a complete serial representation.
+   */
   void TripcodeSearchResult::deserialize(const unsigned char *buffer, size_t size, bool &done)
   {
+    done = false;
+    if(size < 4)
+      return;
+    size_t recordBytes = static_cast<size_t>(readUint32(buffer)) * RECORD_SIZE;
+    if(size - 4 < recordBytes)
+      return;
+    m_records.assign(buffer + 4, buffer + 4 + recordBytes);
+    done = true;
+  }
+
+  /**
+   * Appends the results of source to these results.
+   */
+  void TripcodeSearchResult::merge(const TripcodeSearchResult &source)
+  {
+    m_records.insert(m_records.end(), source.m_records.begin(), source.m_records.end());
   }
 }
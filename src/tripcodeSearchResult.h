@@ -23,8 +23,10 @@
 #ifndef TRIPCODE_SEARCH_RESULT_H_
 #define TRIPCODE_SEARCH_RESULT_H_
 
+#include "common.h"
+
+#include <string>
 #include <vector>
-#include <utility>
 
 namespace TripRipper
 {
@@ -41,14 +43,49 @@ namespace TripRipper
    *
    * TripcodeSearchResult provides a verify() method for verifying the
    * tripcodes with a known-working tripcode algorithm.
+   *
+   * Results are stored as fixed size records of RECORD_SIZE bytes: the key,
+   * padded with zero bytes to KEY_SIZE bytes, followed by the TRIPCODE_SIZE
+   * characters of the tripcode. The serial representation is the number of
+   * records in network byte order followed by the records themselves, so
+   * serializing and merging results is a matter of copying memory.
    */
   class TripcodeSearchResult
   {
     public:
+      static const size_t KEY_SIZE = 8;
+      static const size_t TRIPCODE_SIZE = 10;
+      static const size_t RECORD_SIZE = KEY_SIZE + TRIPCODE_SIZE;
+
       TripcodeSearchResult();
       ~TripcodeSearchResult();
 
-      void serialize(unsigned char *buffer, size_t size, bool &done);
+      void insert(const std::string &key, const std::string &tripcode);
+      void insert(const char *key, const char *tripcode);
+
+      /**
+       * Returns the number of results.
+       */
+      size_t size() const { return m_records.size() / RECORD_SIZE; }
+      bool empty() const { return m_records.empty(); }
+      void clear() { m_records.clear(); }
+
+      /**
+       * Makes room for the given number of results, so that inserting up to
+       * that many results does not allocate. clear() keeps the room.
+       */
+      void reserve(size_t results) { m_records.reserve(results * RECORD_SIZE); }
+
+      /**
+       * Returns a pointer to the record of the result with the given index.
+       */
+      const uint8_t *record(size_t index) const { return &m_records[index * RECORD_SIZE]; }
+      std::string key(size_t index) const;
+      std::string tripcode(size_t index) const;
+
+      size_t serialSize() const;
+      size_t serialCapacity() const;
+      void serialize(unsigned char *buffer, size_t size, bool &done) const;
       void deserialize(const unsigned char *buffer, size_t size, bool &done);
 
       void merge(const TripcodeSearchResult &source);
@@ -56,7 +93,7 @@ namespace TripRipper
       bool verify();
 
     private:
-      std::vector<std::pair<std::string, std::string>> m_tripcodes;
+      std::vector<uint8_t> m_records;
   };
 }
 
@@ -0,0 +1,461 @@
+/*******************************************************************************
+ * Copyright 2012 Jonathan Glines <auntieNeo@gmail.com>                        *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ ******************************************************************************/
+
+#include "wordlistKeyspace.h"
+#include "logger.h"
+#include "serialization.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <mpi.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace TripRipper
+{
+  const char WordlistKeyspace::INDEX_MAGIC[8] = { 'T', 'R', 'I', 'P', 'W', 'I', 'D', 'X' };
+
+  WordlistKeyspace::WordlistKeyspace() :
+    m_fileSize(0), m_modified(0),
+    m_tracker(0)
+  {
+  }
+
+  WordlistKeyspace::~WordlistKeyspace()
+  {
+  }
+
+  /**
+   * Sets the wordlist, which starts the search of the keyspace over. The
+   * index of the wordlist is loaded, or built if it is missing or stale.
+   * Returns false if the wordlist cannot be read.
+   */
+  bool WordlistKeyspace::setPath(const std::string &path)
+  {
+    assert(m_tracker.poolsCheckedOut() == 0);
+    m_path = path;
+    struct stat status;
+    if(stat(m_path.c_str(), &status) != 0)
+    {
+      Logger::error("Could not open wordlist %s: %s", m_path.c_str(), strerror(errno));
+      return false;
+    }
+    m_fileSize = status.st_size;
+    m_modified = status.st_mtime;
+    if(!loadIndex(m_fileSize, m_modified) && !buildIndex(m_fileSize, m_modified))
+      return false;
+    m_tracker = PoolTracker(m_offsets.size() - 1);
+    return true;
+  }
+
+  /**
+   * Reads the index of the wordlist. Returns false if there is no index, or
+   * if it does not match the given size and modification time of the
+   * wordlist.
+   */
+  bool WordlistKeyspace::loadIndex(uint64_t fileSize, uint64_t modified)
+  {
+    std::string indexPath = m_path + ".idx";
+    FILE *file = fopen(indexPath.c_str(), "rb");
+    if(file == NULL)
+      return false;
+    uint8_t header[INDEX_HEADER_SIZE];
+    bool valid = fread(header, 1, INDEX_HEADER_SIZE, file) == INDEX_HEADER_SIZE &&
+      memcmp(header, INDEX_MAGIC, sizeof(INDEX_MAGIC)) == 0 &&
+      readUint32(header + 8) == INDEX_VERSION &&
+      readUint64(header + 16) == fileSize &&
+      readUint64(header + 24) == modified &&
+      readUint64(header + 32) == POOL_LINES;
+    if(valid)
+    {
+      uint64_t pools = readUint64(header + 40);
+      m_offsets.resize(pools + 1);
+      uint8_t offset[8];
+      for(uint64_t i = 0; valid && i <= pools; ++i)
+      {
+        valid = fread(offset, 1, sizeof(offset), file) == sizeof(offset);
+        m_offsets[i] = readUint64(offset);
+      }
+      valid = valid && m_offsets.back() == fileSize;
+    }
+    fclose(file);
+    return valid;
+  }
+
+  /**
+   * Scans the wordlist for the offset of every POOL_LINES-th line, and
+   * writes the index. The scan reads the wordlist through a sequential
+   * memory mapping, so it runs at the bandwidth of the disk. Returns false if
+   * the wordlist cannot be read; failing to write the index only costs a
+   * scan the next time.
+   */
+  bool WordlistKeyspace::buildIndex(uint64_t fileSize, uint64_t modified)
+  {
+    m_offsets.clear();
+    if(fileSize > 0)
+    {
+      int file = open(m_path.c_str(), O_RDONLY);
+      void *map = MAP_FAILED;
+      if(file >= 0)
+      {
+        map = mmap(NULL, fileSize, PROT_READ, MAP_PRIVATE, file, 0);
+        close(file);
+      }
+      if(map == MAP_FAILED)
+      {
+        Logger::error("Could not map wordlist %s: %s", m_path.c_str(), strerror(errno));
+        return false;
+      }
+      madvise(map, fileSize, MADV_SEQUENTIAL);
+
+      const char *data = static_cast<const char*>(map);
+      const char *end = data + fileSize;
+      const char *line = data;
+      uint64_t lines = 0;
+      while(line < end)
+      {
+        if(lines++ % POOL_LINES == 0)
+          m_offsets.push_back(line - data);
+        const char *newline = static_cast<const char*>(memchr(line, '\n', end - line));
+        line = newline != NULL ? newline + 1 : end;
+      }
+      munmap(map, fileSize);
+    }
+    m_offsets.push_back(fileSize);
+
+    std::string indexPath = m_path + ".idx";
+    // several ranks may build the index at once in ATOMIC_DISPATCH mode,
+    // on several hosts if the wordlist is on a shared filesystem
+    char host[256] = "";
+    gethostname(host, sizeof(host) - 1);
+    char suffix[32];
+    snprintf(suffix, sizeof(suffix), ".%d", static_cast<int>(getpid()));
+    std::string tempPath = indexPath + ".tmp." + host + suffix;
+    FILE *file = fopen(tempPath.c_str(), "wb");
+    if(file == NULL)
+      return true;
+    uint8_t header[INDEX_HEADER_SIZE];
+    memcpy(header, INDEX_MAGIC, sizeof(INDEX_MAGIC));
+    writeUint32(header + 8, INDEX_VERSION);
+    writeUint32(header + 12, 0);
+    writeUint64(header + 16, fileSize);
+    writeUint64(header + 24, modified);
+    writeUint64(header + 32, POOL_LINES);
+    writeUint64(header + 40, m_offsets.size() - 1);
+    bool written = fwrite(header, 1, INDEX_HEADER_SIZE, file) == INDEX_HEADER_SIZE;
+    uint8_t offset[8];
+    for(size_t i = 0; written && i < m_offsets.size(); ++i)
+    {
+      writeUint64(offset, m_offsets[i]);
+      written = fwrite(offset, 1, sizeof(offset), file) == sizeof(offset);
+    }
+    written = fclose(file) == 0 && written;
+    if(!written || rename(tempPath.c_str(), indexPath.c_str()) != 0)
+    {
+      Logger::warning("Could not write wordlist index %s", indexPath.c_str());
+      remove(tempPath.c_str());
+    }
+    return true;
+  }
+
+  uint64_t WordlistKeyspace::totalPools()
+  {
+    return m_tracker.totalPools();
+  }
+
+  uint64_t WordlistKeyspace::poolsLeft()
+  {
+    return m_tracker.poolsLeft();
+  }
+
+  size_t WordlistKeyspace::poolSize()
+  {
+    return POOL_LINES;
+  }
+
+  KeyspacePool *WordlistKeyspace::checkoutNextPool()
+  {
+    return checkoutPools(1);
+  }
+
+  /**
+   * Pools are handed out in the order of the wordlist. Abandoned pools are
+   * handed out again before any pools after them.
+   */
+  KeyspacePool *WordlistKeyspace::checkoutPools(uint64_t poolCount)
+  {
+    uint64_t firstPool, count;
+    if(!m_tracker.checkout(poolCount, &firstPool, &count))
+      return NULL;
+    return createPool(firstPool, count);
+  }
+
+  KeyspacePool *WordlistKeyspace::createPool(uint64_t firstPool, uint64_t poolCount)
+  {
+    assert(poolCount > 0);
+    assert(firstPool < totalPools() && poolCount <= totalPools() - firstPool);
+    WordlistKeyspacePool *pool = new WordlistKeyspacePool(m_path, firstPool, &m_offsets[firstPool], poolCount);
+    pool->setOutputAlignment(outputAlignment());
+    pool->setOutputStride(outputStride());
+    return pool;
+  }
+
+  void WordlistKeyspace::checkinPool(KeyspacePool *pool)
+  {
+    WordlistKeyspacePool *wordlistPool = dynamic_cast<WordlistKeyspacePool*>(pool);
+    assert(wordlistPool != NULL);
+    m_tracker.checkin(wordlistPool->firstPool(), wordlistPool->poolCount());
+  }
+
+  void WordlistKeyspace::abandonPool(KeyspacePool *pool)
+  {
+    WordlistKeyspacePool *wordlistPool = dynamic_cast<WordlistKeyspacePool*>(pool);
+    assert(wordlistPool != NULL);
+    m_tracker.abandon(wordlistPool->firstPool(), wordlistPool->poolCount());
+  }
+
+  size_t WordlistKeyspace::serialSize() const
+  {
+    return 4 + 4 + m_path.size() + 8 + 8 + m_tracker.serialSize();
+  }
+
+  /**
+   * The serial representation of a WordlistKeyspace is the
+   * KeyspaceMapping::WORDLIST type, followed by the length of the path of the
+   * wordlist, the path itself, the size and modification time of the
+   * wordlist, and the serialized PoolTracker. The index is not part of the
+   * representation.
+   */
+  void WordlistKeyspace::serialize(unsigned char *buffer, size_t size, bool &done) const
+  {
+    done = false;
+    if(size < serialSize())
+      return;
+    writeUint32(buffer, KeyspaceMapping::WORDLIST);
+    writeUint32(buffer + 4, static_cast<uint32_t>(m_path.size()));
+    memcpy(buffer + 8, m_path.data(), m_path.size());
+    writeUint64(buffer + 8 + m_path.size(), m_fileSize);
+    writeUint64(buffer + 16 + m_path.size(), m_modified);
+    m_tracker.serialize(buffer + 24 + m_path.size());
+    done = true;
+  }
+
+  void WordlistKeyspace::deserialize(const unsigned char *buffer, size_t size, bool &done)
+  {
+    done = false;
+    if(size < 8 || readUint32(buffer) != KeyspaceMapping::WORDLIST)
+      return;
+    size_t pathSize = readUint32(buffer + 4);
+    if(size - 8 < pathSize || size - 8 - pathSize < 8 + 8 + 8)
+      return;
+    if(!setPath(std::string(reinterpret_cast<const char*>(buffer + 8), pathSize)))
+      return;
+    // the progress of a wordlist that changed since it was serialized is
+    // meaningless, since lines may have moved between pools
+    if(readUint64(buffer + 8 + pathSize) != m_fileSize || readUint64(buffer + 16 + pathSize) != m_modified)
+    {
+      Logger::error("The wordlist %s has changed since the search was saved", m_path.c_str());
+      return;
+    }
+    uint64_t totalPools = m_tracker.totalPools();
+    if(m_tracker.deserialize(buffer + 24 + pathSize, size - 24 - pathSize) == 0)
+      return;
+    if(m_tracker.totalPools() != totalPools)
+      m_tracker = PoolTracker(totalPools);
+    done = true;
+  }
+
+  WordlistKeyspacePool::WordlistKeyspacePool() :
+    m_firstPool(0),
+    m_blockKeys(BLOCK_KEYS),
+    m_outputAlignment(1), m_outputStride(0),
+    m_outputPackHighBit(false),
+    m_map(NULL), m_mapSize(0),
+    m_next(NULL), m_end(NULL)
+  {
+  }
+
+  /**
+   * Constructs a pool covering poolCount pools starting at firstPool, where
+   * offsets holds the poolCount + 1 offsets of the pool boundaries.
+   */
+  WordlistKeyspacePool::WordlistKeyspacePool(const std::string &path, uint64_t firstPool, const uint64_t *offsets, uint64_t poolCount) :
+    m_path(path),
+    m_firstPool(firstPool),
+    m_offsets(offsets, offsets + poolCount + 1),
+    m_blockKeys(BLOCK_KEYS),
+    m_outputAlignment(1), m_outputStride(0),
+    m_outputPackHighBit(false),
+    m_map(NULL), m_mapSize(0),
+    m_next(NULL), m_end(NULL)
+  {
+  }
+
+  WordlistKeyspacePool::~WordlistKeyspacePool()
+  {
+    unmap();
+  }
+
+  /**
+   * Pools can only be split before any blocks have been taken from them.
+   */
+  KeyspacePool *WordlistKeyspacePool::splitPool(uint64_t poolCount)
+  {
+    if(poolCount == 0 || poolCount >= this->poolCount() || m_next != NULL)
+      return NULL;
+    WordlistKeyspacePool *pool = new WordlistKeyspacePool(m_path, m_firstPool, &m_offsets[0], poolCount);
+    pool->setBlockKeys(m_blockKeys);
+    pool->setOutputAlignment(m_outputAlignment);
+    pool->setOutputStride(m_outputStride);
+    pool->setOutputPackHighBit(m_outputPackHighBit);
+    m_offsets.erase(m_offsets.begin(), m_offsets.begin() + poolCount);
+    m_firstPool += poolCount;
+    return pool;
+  }
+
+  size_t WordlistKeyspacePool::blockSize()
+  {
+    return m_blockKeys * (KeyBlock::KEY_SIZE + m_outputStride);
+  }
+
+  /**
+   * Fills the next KeyBlock straight from the mapping of the wordlist.
+   *
+   * \todo Pack the high bits of the keys when outputPackHighBit() is set.
+   */
+  KeyBlock *WordlistKeyspacePool::getNextBlock()
+  {
+    if(m_next == NULL && !map())
+      return NULL;
+
+    m_block.resize(m_blockKeys, m_outputStride);
+    size_t numKeys = 0;
+    while(numKeys < m_blockKeys && m_next < m_end)
+    {
+      const char *newline = static_cast<const char*>(memchr(m_next, '\n', m_end - m_next));
+      const char *lineEnd = newline != NULL ? newline : m_end;
+      size_t length = lineEnd - m_next;
+      if(length > 0 && m_next[length - 1] == '\r')
+        --length;
+      if(length > 0)
+      {
+        uint8_t *key = m_block.key(numKeys++);
+        length = std::min(length, KeyBlock::KEY_SIZE);
+        memcpy(key, m_next, length);
+        memset(key + length, 0, KeyBlock::KEY_SIZE - length);
+      }
+      m_next = newline != NULL ? newline + 1 : m_end;
+    }
+    if(numKeys == 0)
+      return NULL;
+    m_block.resize(numKeys, m_outputStride);
+    return &m_block;
+  }
+
+  /**
+   * Maps the byte range of the lines of the pool. Failing to read the
+   * wordlist is fatal, since the pool would otherwise be checked in without
+   * having been searched.
+   */
+  bool WordlistKeyspacePool::map()
+  {
+    uint64_t begin = m_offsets.front(), end = m_offsets.back();
+    if(begin == end)
+      return false;
+    uint64_t pageSize = sysconf(_SC_PAGESIZE);
+    uint64_t mapOffset = begin / pageSize * pageSize;
+    m_mapSize = end - mapOffset;
+    int file = open(m_path.c_str(), O_RDONLY);
+    if(file >= 0)
+    {
+      m_map = mmap(NULL, m_mapSize, PROT_READ, MAP_PRIVATE, file, mapOffset);
+      close(file);
+    }
+    if(file < 0 || m_map == MAP_FAILED)
+    {
+      Logger::error("Could not map wordlist %s: %s", m_path.c_str(), strerror(errno));
+      MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+    madvise(m_map, m_mapSize, MADV_SEQUENTIAL);
+    m_next = static_cast<const char*>(m_map) + (begin - mapOffset);
+    m_end = static_cast<const char*>(m_map) + m_mapSize;
+    return true;
+  }
+
+  void WordlistKeyspacePool::unmap()
+  {
+    if(m_map == NULL)
+      return;
+    munmap(m_map, m_mapSize);
+    m_map = NULL;
+  }
+
+  /**
+   * The serial representation of a WordlistKeyspacePool is the
+   * KeyspacePool::WORDLIST type, followed by the length of the path of the
+   * wordlist, the path itself, the first pool index, the number of pools and
+   * the offsets of the pool boundaries, all in network byte order.
+   */
+  uint8_t *WordlistKeyspacePool::serialize(size_t *size) const
+  {
+    *size = 4 + 4 + m_path.size() + 8 + 8 + 8 * m_offsets.size();
+    uint8_t *buffer = new uint8_t[*size];
+    writeUint32(buffer, KeyspacePool::WORDLIST);
+    writeUint32(buffer + 4, static_cast<uint32_t>(m_path.size()));
+    memcpy(buffer + 8, m_path.data(), m_path.size());
+    uint8_t *position = buffer + 8 + m_path.size();
+    writeUint64(position, m_firstPool);
+    writeUint64(position + 8, m_offsets.size() - 1);
+    position += 16;
+    for(size_t i = 0; i < m_offsets.size(); ++i, position += 8)
+      writeUint64(position, m_offsets[i]);
+    return buffer;
+  }
+
+  void WordlistKeyspacePool::deserialize(const uint8_t *buffer, size_t size, bool &done)
+  {
+    done = false;
+    if(size < 8 || readUint32(buffer) != KeyspacePool::WORDLIST)
+      return;
+    size_t pathSize = readUint32(buffer + 4);
+    if(size - 8 < pathSize + 16)
+      return;
+    m_path.assign(reinterpret_cast<const char*>(buffer + 8), pathSize);
+    const uint8_t *position = buffer + 8 + pathSize;
+    m_firstPool = readUint64(position);
+    uint64_t poolCount = readUint64(position + 8);
+    position += 16;
+    if(poolCount >= (size - (position - buffer)) / 8)
+      return;
+    m_offsets.resize(poolCount + 1);
+    for(size_t i = 0; i < m_offsets.size(); ++i, position += 8)
+      m_offsets[i] = readUint64(position);
+    // a recycled pool starts over
+    unmap();
+    m_next = m_end = NULL;
+    done = true;
+  }
+}
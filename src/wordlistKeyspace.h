@@ -0,0 +1,159 @@
+/*******************************************************************************
+ * Copyright 2012 Jonathan Glines <auntieNeo@gmail.com>                        *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ ******************************************************************************/
+
+#ifndef WORDLIST_KEYSPACE_H_
+#define WORDLIST_KEYSPACE_H_
+
+#include "keyspace.h"
+#include "poolTracker.h"
+
+namespace TripRipper
+{
+  /**
+   * The WordlistKeyspace class describes a mapping onto the lines of a
+   * wordlist file, one key per line. Each pool is a range of POOL_LINES
+   * consecutive lines.
+   *
+   * The byte offset at which each pool starts is kept in an index file next
+   * to the wordlist, with ".idx" appended to its name. The index is built
+   * with a single pass over the wordlist the first time it is used, and is
+   * rebuilt whenever the size or modification time of the wordlist changes.
+   * Since the index only holds one offset per pool, it stays small even for
+   * wordlists of tens of gigabytes. The size and modification time are also
+   * serialized along with the progress of the search, which cannot be
+   * resumed once the wordlist has changed.
+   *
+   * Pools carry the offsets of their own pool boundaries, so ranks only need
+   * to be able to read the wordlist itself, at the same path, e.g. from a
+   * shared filesystem. Ranks map the byte range of their pool and fill
+   * KeyBlock objects straight from the mapping.
+   *
+   * Lines are separated by "\n", and a trailing "\r" is ignored. Keys are
+   * truncated to KeyBlock::KEY_SIZE bytes, since crypt(3) ignores everything
+   * past that, and empty lines are skipped.
+   */
+  class WordlistKeyspace : public KeyspaceMapping
+  {
+    public:
+      /**
+       * The number of lines in each pool. The last pool may be smaller.
+       */
+      static const uint64_t POOL_LINES = 1 << 16;
+
+      WordlistKeyspace();
+      ~WordlistKeyspace();
+
+      bool setPath(const std::string &path);
+      const std::string &path() const { return m_path; }
+
+      uint64_t totalPools();
+      uint64_t poolsLeft();
+      size_t poolSize();
+      KeyspacePool *checkoutNextPool();
+      KeyspacePool *checkoutPools(uint64_t poolCount);
+      KeyspacePool *createPool(uint64_t firstPool, uint64_t poolCount);
+      void checkinPool(KeyspacePool *pool);
+      void abandonPool(KeyspacePool *pool);
+      PoolTracker *poolTracker() { return &m_tracker; }
+
+      size_t serialSize() const;
+      void serialize(unsigned char *buffer, size_t size, bool &done) const;
+      void deserialize(const unsigned char *buffer, size_t size, bool &done);
+
+    private:
+      static const char INDEX_MAGIC[8];
+      static const uint32_t INDEX_VERSION = 1;
+      static const size_t INDEX_HEADER_SIZE = 8 + 4 + 4 + 8 + 8 + 8 + 8;
+
+      bool loadIndex(uint64_t fileSize, uint64_t modified);
+      bool buildIndex(uint64_t fileSize, uint64_t modified);
+
+      std::string m_path;
+      uint64_t m_fileSize, m_modified;
+      // the offset of the first line of each pool, followed by the file size
+      std::vector<uint64_t> m_offsets;
+      PoolTracker m_tracker;
+  };
+
+  /**
+   * The WordlistKeyspacePool implements a KeyspacePool for
+   * WordlistKeyspace.
+   */
+  class WordlistKeyspacePool : public KeyspacePool
+  {
+    friend class WordlistKeyspace;
+
+    public:
+      /**
+       * The maximum number of keys in each KeyBlock, unless set otherwise
+       * with setBlockKeys().
+       */
+      static const size_t BLOCK_KEYS = 4096;
+
+      WordlistKeyspacePool();
+      WordlistKeyspacePool(const std::string &path, uint64_t firstPool, const uint64_t *offsets, uint64_t poolCount);
+      ~WordlistKeyspacePool();
+
+      /**
+       * Returns the index of the first pool covered by this object.
+       */
+      uint64_t firstPool() const { return m_firstPool; }
+      uint64_t poolCount() { return m_offsets.size() - 1; }
+      KeyspacePool *splitPool(uint64_t poolCount);
+
+      size_t blockSize();
+      void setBlockKeys(size_t blockKeys) { m_blockKeys = blockKeys > 0 ? blockKeys : BLOCK_KEYS; }
+      size_t outputAlignment() { return m_outputAlignment; }
+      void setOutputAlignment(size_t alignment) { m_outputAlignment = alignment; }
+      size_t outputStride() { return m_outputStride; }
+      void setOutputStride(size_t stride) { m_outputStride = stride; }
+      bool outputPackHighBit() { return m_outputPackHighBit; }
+      void setOutputPackHighBit(bool packHighBit) { m_outputPackHighBit = packHighBit; }
+
+      KeyBlock *getNextBlock();
+
+      uint8_t *serialize(size_t *size) const;
+
+    protected:
+      void deserialize(const uint8_t *buffer, size_t size, bool &done);
+
+    private:
+      bool map();
+      void unmap();
+
+      std::string m_path;
+      uint64_t m_firstPool;
+      // the offsets of the pool boundaries, poolCount() + 1 of them
+      std::vector<uint64_t> m_offsets;
+      size_t m_blockKeys;
+      size_t m_outputAlignment, m_outputStride;
+      bool m_outputPackHighBit;
+
+      // the mapping of the lines of the pool, and the position within it
+      KeyBlock m_block;
+      void *m_map;
+      size_t m_mapSize;
+      const char *m_next, *m_end;
+  };
+}
+
+#endif